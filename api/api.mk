@@ -17,7 +17,12 @@ $(shell [ ! -d $(OBJ_DIR) ] && mkdir $(OBJ_DIR) )
 #											#
 #############################################
 
-API_SRCS = 	filesystem.S	\
+API_SRCS = 	event.S			\
+			filesystem.S	\
+			message_queue.S	\
+			mutex.S			\
+			semaphore.S		\
+			syscall_ring.S	\
 			task.S			
 
 
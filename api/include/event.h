@@ -0,0 +1,58 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+
+#include "task.h"
+
+
+/*
+ * Group of 32 event flags kept by the kernel. Tasks wait for any
+ * or all of a set of flags, and interrupt handlers may set them
+ * too. Must match the layout of event_flags_t in the kernel, and
+ * be initialized with EVENT_FLAGS_INITIALIZER.
+ */
+typedef struct EVENT_FLAGS
+{
+    unsigned int flags;
+    void *waiters_head;
+    void *waiters_tail;
+
+} event_flags_t;
+
+
+#define EVENT_FLAGS_INITIALIZER     { 0, 0, 0 }
+
+#define EVENT_WAIT_ANY      0x0     // wake when any flag in the mask is set
+#define EVENT_WAIT_ALL      0x1     // wake when every flag in the mask is set
+#define EVENT_CLEAR         0x2     // clear the flags that woke the task
+
+
+/*
+ * What to wait for, with a timeout in ticks, or WAIT_POLL or
+ * WAIT_FOREVER. Once the wait is satisfied, the flags from the
+ * mask that were set are stored in flags. Must match the layout
+ * of event_wait_t in the kernel.
+ *
+ *     event_wait_t wait = { RX_READY | TX_DONE, EVENT_WAIT_ANY | EVENT_CLEAR, 100 };
+ *
+ *     if(event_wait(&uart_events, &wait) == 0 && (wait.flags & RX_READY))
+ *         ...
+ */
+typedef struct EVENT_WAIT
+{
+    unsigned int mask;
+    unsigned int options;
+    unsigned int timeout;
+    unsigned int flags;
+
+} event_wait_t;
+
+
+// returns 0 once the wait is satisfied, or a negative error code if it timed out
+int event_wait(event_flags_t *group, event_wait_t *wait);
+
+void event_set(event_flags_t *group, unsigned int flags);
+void event_clear(event_flags_t *group, unsigned int flags);
+
+
+#endif
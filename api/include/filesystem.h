@@ -7,6 +7,26 @@
  * Need to implement file mode flags.
  */
 int open(char *filename);
+int close(int file_descriptor);
+int read(int file_descriptor, void *buffer, int size);
+int write(int file_descriptor, void *buffer, int size);
+
+
+#define ERROR_PIPE_TABLE_FULL   -14
+#define ERROR_PIPE_CLOSED       -15
+#define ERROR_PIPE_WRONG_END    -19
+
+/*
+ * Creates a pipe and stores the file descriptor of its read end
+ * in file_descriptors[0] and of its write end in
+ * file_descriptors[1]. Reads block while the pipe is empty and
+ * return 0 once it is empty and the write end is closed. Writes
+ * block until all their data is in the pipe, and fail with
+ * ERROR_PIPE_CLOSED once the read end is closed. Reading the
+ * write end or writing the read end fails with
+ * ERROR_PIPE_WRONG_END.
+ */
+int pipe(int file_descriptors[2]);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#ifndef KERNEL_DATA_H
+#define KERNEL_DATA_H
+
+
+#include <stdint.h>
+
+
+/*
+ * Kernel data page. The kernel keeps the time, the tick count,
+ * the running task and scheduler statistics in a page at the
+ * bottom of user data RAM, and these functions read it with
+ * plain loads instead of system calls. Must match the layout of
+ * kernel_data_page_t in the kernel.
+ *
+ * The kernel bumps sequence to an odd value before changing the
+ * page and to an even one after, so a copy is only kept if
+ * sequence was even and unchanged across it. The page must not
+ * be written.
+ */
+
+
+#define KERNEL_DATA_VERSION         1
+
+// current_task_id while the idle task runs
+#define KERNEL_DATA_IDLE_TASK       -1
+
+
+typedef struct KERNEL_DATA_PAGE
+{
+    uint32_t sequence;
+    uint32_t version;
+
+    // rate of the cycle counter in Hz, and of system ticks
+    uint32_t counter_frequency;
+    uint32_t tick_rate;
+
+    // cycle counter counts since boot, as of the counter reading time_base_count
+    uint64_t time_base;
+    uint32_t time_base_count;
+
+    uint32_t ticks;
+    int32_t current_task_id;
+
+    // times a different task was switched onto the CPU
+    uint32_t num_switches;
+
+    // time spent in the idle task up to its last switch out, in cycle counter counts
+    uint64_t idle_cycles;
+
+} kernel_data_page_t;
+
+
+extern kernel_data_page_t kernel_data_page;
+
+
+#define KERNEL_DATA_BARRIER()       __asm__ volatile("" ::: "memory")
+
+
+// the core timer Count register, which the kernel lets user mode read
+static inline uint32_t read_user_cycle_counter()
+{
+    uint32_t count;
+
+    __asm__ volatile("rdhwr %0, $2" : "=r" (count));
+
+    return count;
+}
+
+
+// copies a consistent snapshot of the whole page
+static inline void read_kernel_data(kernel_data_page_t *snapshot)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = kernel_data_page.sequence;
+        KERNEL_DATA_BARRIER();
+
+        *snapshot = kernel_data_page;
+
+        KERNEL_DATA_BARRIER();
+    }
+    while((sequence & 1) || kernel_data_page.sequence != sequence);
+}
+
+
+/*
+ * Cycle counter counts since boot, at the full resolution of the
+ * counter. Divide by counter_frequency for seconds.
+ */
+static inline uint64_t get_time_base()
+{
+    uint32_t sequence, count;
+    uint64_t time_base;
+
+    do
+    {
+        sequence = kernel_data_page.sequence;
+        KERNEL_DATA_BARRIER();
+
+        time_base = kernel_data_page.time_base;
+        count = kernel_data_page.time_base_count;
+
+        KERNEL_DATA_BARRIER();
+    }
+    while((sequence & 1) || kernel_data_page.sequence != sequence);
+
+    return time_base + (uint32_t)(read_user_cycle_counter() - count);
+}
+
+
+// system ticks since boot, as sleep_ticks(0) returns without the trap
+static inline unsigned int get_ticks()
+{
+    return kernel_data_page.ticks;
+}
+
+
+// ID of the calling task, which is always the one running
+static inline int get_task_id()
+{
+    return kernel_data_page.current_task_id;
+}
+
+
+#endif
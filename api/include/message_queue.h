@@ -0,0 +1,64 @@
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H
+
+
+#include "task.h"
+
+
+/*
+ * Queue of up to depth messages of a fixed size, kept by the
+ * kernel in a buffer given by its creator. In copy mode the
+ * buffer holds depth*message_size bytes and messages are copied
+ * in and out. In pointer mode it holds depth pointers, and only
+ * the pointer to each message is passed along, so the sender
+ * must leave the message alone until the receiver is done with
+ * it. A receiver already waiting gets the message stored
+ * straight into its buffer. Must match the layout of
+ * message_queue_t in the kernel.
+ *
+ *     static frame_t frames[8];
+ *     static message_queue_t frame_queue = MESSAGE_QUEUE_INITIALIZER(frames, 8, sizeof(frame_t));
+ *
+ *     message_send(&frame_queue, &frame, WAIT_FOREVER);
+ *     message_receive(&frame_queue, &frame, 10);
+ */
+typedef struct MESSAGE_QUEUE
+{
+    void *buffer;
+    unsigned int message_size;
+    unsigned int depth;
+    unsigned int options;
+    unsigned int count;
+    unsigned int head;
+    void *receivers_head;
+    void *receivers_tail;
+    void *senders_head;
+    void *senders_tail;
+
+} message_queue_t;
+
+
+#define MESSAGE_QUEUE_POINTERS  0x1
+
+#define MESSAGE_QUEUE_INITIALIZER(_buffer, _depth, _message_size)  \
+    { (_buffer), (_message_size), (_depth), 0, 0, 0, 0, 0, 0, 0 }
+
+#define MESSAGE_QUEUE_POINTER_INITIALIZER(_buffer, _depth)  \
+    { (_buffer), sizeof(void*), (_depth), MESSAGE_QUEUE_POINTERS, 0, 0, 0, 0, 0, 0 }
+
+
+/*
+ * Blocking send and receive wait up to timeout ticks, or
+ * WAIT_POLL or WAIT_FOREVER, and return 0 or ERROR_TIMED_OUT.
+ * In pointer mode, message is the pointer to send and buffer
+ * points to where the received pointer is stored.
+ */
+int message_send(message_queue_t *queue, void *message, unsigned int timeout);
+int message_receive(message_queue_t *queue, void *buffer, unsigned int timeout);
+
+// never block, and fail with ERROR_TIMED_OUT if the queue is full or empty
+int message_try_send(message_queue_t *queue, void *message);
+int message_try_receive(message_queue_t *queue, void *buffer);
+
+
+#endif
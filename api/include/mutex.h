@@ -0,0 +1,40 @@
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+
+/*
+ * Mutex with priority inheritance: while a higher priority task
+ * waits for the mutex, the owner runs at the waiter's priority.
+ * Locking a free mutex and unlocking one nobody waits for do
+ * not enter the kernel. Must match the layout of mutex_t in the
+ * kernel, and be initialized with MUTEX_INITIALIZER.
+ */
+typedef struct MUTEX
+{
+    volatile unsigned int lock;
+    void *owner;
+    void *waiters_head;
+    void *waiters_tail;
+    struct MUTEX *next_held;
+
+} mutex_t;
+
+
+#define MUTEX_INITIALIZER   { 0, 0, 0, 0, 0 }
+
+// returned by mutex_lock if the previous owner exited holding the mutex
+#define MUTEX_OWNER_DIED    1
+
+
+/*
+ * Blocks until the mutex is free and takes it. Fails with a
+ * negative value if the task already owns it.
+ */
+int mutex_lock(mutex_t *mutex);
+
+// fails with a negative value if the task does not own the mutex
+int mutex_unlock(mutex_t *mutex);
+
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+
+#include "task.h"
+
+
+/*
+ * Counting semaphore kept by the kernel. A post wakes the highest
+ * priority waiting task, and interrupt handlers may post too.
+ * Must match the layout of semaphore_t in the kernel, and be
+ * initialized with SEMAPHORE_INITIALIZER.
+ */
+typedef struct SEMAPHORE
+{
+    unsigned int count;
+    void *waiters_head;
+    void *waiters_tail;
+
+} semaphore_t;
+
+
+#define SEMAPHORE_INITIALIZER(_count)   { (_count), 0, 0 }
+
+
+/*
+ * Waits up to timeout ticks, or WAIT_POLL or WAIT_FOREVER, for
+ * the count to be above 0 and takes one from it. Returns 0 or
+ * ERROR_TIMED_OUT.
+ */
+int semaphore_wait(semaphore_t *semaphore, unsigned int timeout);
+
+// fails with a negative value if the count would overflow
+int semaphore_post(semaphore_t *semaphore);
+
+
+#endif
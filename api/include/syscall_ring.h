@@ -0,0 +1,128 @@
+#ifndef SYSCALL_RING_H
+#define SYSCALL_RING_H
+
+
+#include <stdint.h>
+
+
+/*
+ * Batched file operations. Open, close, read, write and seek are
+ * queued in the submission ring with syscall_ring_submit, and one
+ * syscall_ring_enter runs all of them in order and posts their
+ * results, the values the system calls would have returned, in
+ * the completion ring. Must match the layout of syscall_ring_t in
+ * the kernel, and start zeroed.
+ *
+ *     static syscall_ring_t ring;
+ *     syscall_completion_t completion;
+ *
+ *     for(int i = 0; i < count; i++)
+ *         syscall_ring_submit(&ring, SYSCALL_RING_WRITE, log_fd, (uintptr_t) records[i], sizeof(record_t), i);
+ *
+ *     syscall_ring_enter(&ring);
+ *
+ *     while(syscall_ring_complete(&ring, &completion))
+ *         if(completion.result < 0) ...
+ *
+ * Reads and writes of pipes complete with ERROR_RING_WOULD_BLOCK,
+ * and other operations with ERROR_INVALID_SYSCALL. An enter stops
+ * early once the completion ring is full, so completions should
+ * be taken before queueing more than SYSCALL_RING_SIZE at a time.
+ */
+
+
+#define SYSCALL_RING_SIZE           32
+
+#define SYSCALL_RING_OPEN           6
+#define SYSCALL_RING_CLOSE          7
+#define SYSCALL_RING_READ           8
+#define SYSCALL_RING_WRITE          9
+#define SYSCALL_RING_SEEK           14
+
+#define ERROR_INVALID_SYSCALL       -17
+#define ERROR_RING_WOULD_BLOCK      -18
+
+
+typedef struct SYSCALL_SUBMISSION
+{
+    uint32_t code;
+    uint32_t args[3];
+    uint32_t user_data;
+
+} syscall_submission_t;
+
+
+typedef struct SYSCALL_COMPLETION
+{
+    uint32_t user_data;
+    int32_t result;
+
+} syscall_completion_t;
+
+
+typedef struct SYSCALL_RING
+{
+    uint32_t submission_head;
+    uint32_t submission_tail;
+    uint32_t completion_head;
+    uint32_t completion_tail;
+
+    syscall_submission_t submissions[SYSCALL_RING_SIZE];
+    syscall_completion_t completions[SYSCALL_RING_SIZE];
+
+} syscall_ring_t;
+
+
+/*
+ * Runs every queued operation, up to the space left in the
+ * completion ring, and returns how many it ran.
+ */
+unsigned int syscall_ring_enter(syscall_ring_t *ring);
+
+
+/*
+ * Queues an operation with its arguments in the order the system
+ * call takes them. Returns 0, or -1 if the submission ring is
+ * full.
+ */
+static inline int syscall_ring_submit(syscall_ring_t *ring, uint32_t code, uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t user_data)
+{
+    syscall_submission_t *submission;
+
+    if(ring->submission_tail - ring->submission_head >= SYSCALL_RING_SIZE)
+    {
+        return -1;
+    }
+
+    submission = &ring->submissions[ring->submission_tail & (SYSCALL_RING_SIZE - 1)];
+    submission->code = code;
+    submission->args[0] = arg0;
+    submission->args[1] = arg1;
+    submission->args[2] = arg2;
+    submission->user_data = user_data;
+
+    ring->submission_tail++;
+
+    return 0;
+}
+
+
+/*
+ * Takes the oldest completion into completion and returns 1, or
+ * returns 0 if there are none.
+ */
+static inline int syscall_ring_complete(syscall_ring_t *ring, syscall_completion_t *completion)
+{
+    if(ring->completion_head == ring->completion_tail)
+    {
+        return 0;
+    }
+
+    *completion = ring->completions[ring->completion_head & (SYSCALL_RING_SIZE - 1)];
+    ring->completion_head++;
+
+    return 1;
+}
+
+
+#endif
@@ -0,0 +1,108 @@
+
+#ifndef TASK_H
+#define TASK_H
+
+
+/*
+ * Creates a task with a stack of stack_size bytes, or a
+ * default size stack if stack_size is 0.
+ */
+int create_task(void (*function)(void), unsigned int stack_size);
+
+// ends the current task; its parent can collect the status by waiting
+void exit_task(int status);
+
+/*
+ * Block until a child task exits, or until the given child
+ * exits, and return its task id. The exit status is stored
+ * through status unless it is 0. Fails with a negative value
+ * if there is no such child.
+ */
+int wait_for_child(int *status);
+int wait_for_task(int task_id, int *status);
+
+/*
+ * Block for the given number of system ticks, or until the
+ * tick count reaches wake_tick, and return the tick the task
+ * woke at. Neither blocks if the wakeup is not in the future,
+ * so sleep_ticks(0) just returns the current tick. A periodic
+ * loop that adds its period to the previous wakeup tick and
+ * calls sleep_until does not drift, however long each
+ * iteration takes:
+ *
+ *     unsigned int next = sleep_ticks(0);
+ *
+ *     while(1)
+ *     {
+ *         do_work();
+ *         next += PERIOD;
+ *         sleep_until(next);
+ *     }
+ */
+unsigned int sleep_ticks(unsigned int ticks);
+unsigned int sleep_until(unsigned int wake_tick);
+
+/*
+ * Timeouts in ticks for calls that may block. WAIT_POLL fails
+ * at once instead of blocking and WAIT_FOREVER never times out.
+ */
+#define WAIT_POLL           0
+#define WAIT_FOREVER        0xFFFFFFFF
+
+// returned by a call whose timeout ran out
+#define ERROR_TIMED_OUT     -10
+
+// largest number of bytes of its stack the task has used
+int get_stack_high_water_mark(int task_id);
+
+
+/*
+ * Timing of a real-time task in system ticks. Must match
+ * the layout of realtime_params_t in the kernel.
+ */
+typedef struct REALTIME_PARAMS
+{
+    unsigned int period;
+    unsigned int wcet;
+    unsigned int deadline;
+
+} realtime_params_t;
+
+
+/*
+ * Creates a task that runs one job per period and is
+ * scheduled earliest-deadline-first. Fails with a negative
+ * value if the task would overload the CPU.
+ */
+int create_realtime_task(void (*function)(void), realtime_params_t *params);
+
+// ends the current job and sleeps until the next period
+int wait_next_period();
+
+int get_deadline_misses(int task_id);
+
+
+
+#define WAIT_HISTOGRAM_BUCKETS      16
+#define WAIT_HISTOGRAM_SHIFT        6
+
+/*
+ * CPU accounting of a task, in cycle counter counts. Bucket i
+ * of the wait histogram counts waits from ready to running of
+ * at least 2^i << WAIT_HISTOGRAM_SHIFT cycles. Must match the
+ * layout of task_stats_t in the kernel.
+ */
+typedef struct TASK_STATS
+{
+    unsigned long long run_cycles;
+    unsigned int num_switches;
+    unsigned int ready_timestamp;
+    unsigned int wait_histogram[WAIT_HISTOGRAM_BUCKETS];
+
+} task_stats_t;
+
+
+int get_task_stats(int task_id, task_stats_t *stats);
+
+
+#endif
@@ -0,0 +1,746 @@
+/*
+ * Kernel benchmarks for the hosted port. They run in the root
+ * task and go through the real system call and context switch
+ * paths, so they can be profiled with perf or valgrind.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#include "deferred_work.h"
+#include "event.h"
+#include "hardware.h"
+#include "host.h"
+#include "kernel_data.h"
+#include "message_queue.h"
+#include "pipe.h"
+#include "protothread.h"
+#include "semaphore.h"
+#include "syscall.h"
+#include "task.h"
+#include "timers.h"
+
+
+
+static double get_seconds()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec*1e-9;
+}
+
+
+static void exiting_task()
+{
+}
+
+
+// yields once so that its parent is already blocked in wait when it exits
+static void yielding_task()
+{
+    host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+}
+
+
+static void run_round_trips(char *name, void (*function)(), unsigned int iterations)
+{
+    int status;
+    double start = get_seconds();
+    double elapsed;
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        if(host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) function, 0, 0, 0) < 0 ||
+           host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0) < 0)
+        {
+            printf("%s: failed after %u round trips\r\n", name, i);
+            return;
+        }
+    }
+
+    elapsed = get_seconds() - start;
+
+    printf("%s: %u round trips in %.3f s, %.0f per second\r\n", name, iterations, elapsed, iterations/elapsed);
+}
+
+
+void benchmark_spawn_exit_wait(unsigned int iterations)
+{
+    // the child runs first and is reaped as a zombie
+    run_round_trips("spawn/exit/wait", exiting_task, iterations);
+
+    // the parent blocks in wait and is woken by the exiting child
+    run_round_trips("spawn/wait/exit", yielding_task, iterations);
+}
+
+
+#define SWITCH_BENCHMARK_JOBS   16
+
+static unsigned int switch_benchmark_yields;
+
+
+static void switching_task()
+{
+    for(unsigned int i = 0; i < switch_benchmark_yields; i++)
+    {
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+    }
+}
+
+
+typedef struct
+{
+    pt_job_t job;
+    unsigned int yields;
+
+} switching_job_t;
+
+
+static int switching_job(pt_job_t *job)
+{
+    switching_job_t *state = (switching_job_t*) job;
+
+    PT_BEGIN(job);
+
+    for(state->yields = 0; state->yields < switch_benchmark_yields; state->yields++)
+    {
+        PT_YIELD(job);
+    }
+
+    PT_END(job);
+}
+
+
+void benchmark_protothreads(unsigned int yields)
+{
+    switching_job_t jobs[SWITCH_BENCHMARK_JOBS];
+    pt_scheduler_t scheduler;
+    unsigned int switches = SWITCH_BENCHMARK_JOBS*yields;
+    int status;
+    double start, task_seconds, job_seconds;
+
+    switch_benchmark_yields = yields;
+
+    // one task per job, each yielding to the next through the scheduler
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < SWITCH_BENCHMARK_JOBS; i++)
+    {
+        if(host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) switching_task, 0, 0, 0) < 0)
+        {
+            printf("task switches: failed to create task %u\r\n", i);
+            return;
+        }
+    }
+
+    for(unsigned int i = 0; i < SWITCH_BENCHMARK_JOBS; i++)
+    {
+        host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+    }
+
+    task_seconds = get_seconds() - start;
+
+    // the same jobs as protothreads inside this task
+    start = get_seconds();
+
+    pt_scheduler_init(&scheduler);
+
+    for(unsigned int i = 0; i < SWITCH_BENCHMARK_JOBS; i++)
+    {
+        pt_job_start(&scheduler, &jobs[i].job, switching_job);
+    }
+
+    while(pt_scheduler_run(&scheduler) > 0);
+
+    job_seconds = get_seconds() - start;
+
+    printf("task switches: %u jobs, %.1f ns per switch, %u bytes per job\r\n",
+           SWITCH_BENCHMARK_JOBS, task_seconds*1e9/switches,
+           (unsigned int) (sizeof(task_control_block_t) + DEFAULT_STACK_SIZE));
+
+    printf("protothread switches: %u jobs, %.1f ns per switch, %u bytes per job\r\n",
+           SWITCH_BENCHMARK_JOBS, job_seconds*1e9/switches, (unsigned int) sizeof(switching_job_t));
+}
+
+
+void benchmark_sleep(unsigned int periods, unsigned int period_ticks)
+{
+    unsigned int next = host_syscall(SYSCALL_CODE_SLEEP, 0, 0, 0, 0);
+    unsigned int first = next;
+    unsigned int late = 0;
+    double start = get_seconds();
+    double elapsed;
+
+    for(unsigned int i = 0; i < periods; i++)
+    {
+        next += period_ticks;
+
+        // the tick woken at is never before the one asked for
+        if((unsigned int) host_syscall(SYSCALL_CODE_SLEEP_UNTIL, next, 0, 0, 0) != next)
+        {
+            late++;
+        }
+    }
+
+    elapsed = get_seconds() - start;
+
+    printf("sleep_until: %u periods of %u ticks in %.3f s (expected %.3f s), %u woke late, %u ticks elapsed\r\n",
+           periods, period_ticks, elapsed, (double) periods*period_ticks/TICK_RATE_HZ, late,
+           (unsigned int) host_syscall(SYSCALL_CODE_SLEEP, 0, 0, 0, 0) - first);
+}
+
+
+static mutex_t benchmark_mutex = MUTEX_INITIALIZER;
+static unsigned int contended_iterations;
+
+
+// blocks on the mutex held by its parent every iteration
+static void contending_task()
+{
+    for(unsigned int i = 0; i < contended_iterations; i++)
+    {
+        host_mutex_lock(&benchmark_mutex);
+        host_mutex_unlock(&benchmark_mutex);
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+    }
+}
+
+
+void benchmark_mutexes(unsigned int iterations)
+{
+    int status;
+    double start, uncontended_seconds, contended_seconds, yield_seconds;
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_mutex_lock(&benchmark_mutex);
+        host_mutex_unlock(&benchmark_mutex);
+    }
+
+    uncontended_seconds = get_seconds() - start;
+
+    /*
+     * Each iteration the parent locks and yields, the child blocks
+     * in the kernel, and the parent's unlock hands the mutex over
+     * in the kernel: one contended lock, one contended unlock and
+     * four switches. The same switches without the mutex are timed
+     * separately, to be subtracted.
+     */
+    contended_iterations = iterations;
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) contending_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_mutex_lock(&benchmark_mutex);
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+        host_mutex_unlock(&benchmark_mutex);
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+    }
+
+    contended_seconds = get_seconds() - start;
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+
+    switch_benchmark_yields = 2*iterations;
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) switching_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < 2*iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+    }
+
+    yield_seconds = get_seconds() - start;
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+
+    printf("mutex uncontended: %.1f ns per lock/unlock\r\n", uncontended_seconds*1e9/iterations);
+    printf("mutex contended: %.1f ns per lock/unlock handoff, %.1f ns of it for the 4 switches\r\n",
+           contended_seconds*1e9/iterations, yield_seconds*1e9/iterations);
+}
+
+
+static semaphore_t ping = SEMAPHORE_INITIALIZER(0);
+static semaphore_t pong = SEMAPHORE_INITIALIZER(0);
+static event_flags_t ping_pong_events = EVENT_FLAGS_INITIALIZER;
+static unsigned int handoff_iterations;
+
+#define PING_EVENT  0x1
+#define PONG_EVENT  0x2
+
+
+static void semaphore_pong_task()
+{
+    for(unsigned int i = 0; i < handoff_iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_SEMAPHORE_WAIT, (uintptr_t) &ping, WAIT_FOREVER, 0, 0);
+        host_syscall(SYSCALL_CODE_SEMAPHORE_POST, (uintptr_t) &pong, 0, 0, 0);
+    }
+}
+
+
+static void event_pong_task()
+{
+    event_wait_t wait = { PING_EVENT, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER, 0 };
+
+    for(unsigned int i = 0; i < handoff_iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_EVENT_WAIT, (uintptr_t) &ping_pong_events, (uintptr_t) &wait, 0, 0);
+        host_syscall(SYSCALL_CODE_EVENT_SET, (uintptr_t) &ping_pong_events, PONG_EVENT, 0, 0);
+    }
+}
+
+
+/*
+ * Each iteration the parent wakes the child and blocks, then the
+ * child wakes the parent and blocks: two wakeups, two blocking
+ * waits and two switches. Both tasks have the same priority, so
+ * the wakeups never preempt.
+ */
+void benchmark_semaphores(unsigned int iterations)
+{
+    event_wait_t wait = { PONG_EVENT, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER, 0 };
+    int status, result;
+    unsigned int before, after;
+    double start, semaphore_seconds, event_seconds;
+
+    handoff_iterations = iterations;
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) semaphore_pong_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_SEMAPHORE_POST, (uintptr_t) &ping, 0, 0, 0);
+        host_syscall(SYSCALL_CODE_SEMAPHORE_WAIT, (uintptr_t) &pong, WAIT_FOREVER, 0, 0);
+    }
+
+    semaphore_seconds = get_seconds() - start;
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) event_pong_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_EVENT_SET, (uintptr_t) &ping_pong_events, PING_EVENT, 0, 0);
+        host_syscall(SYSCALL_CODE_EVENT_WAIT, (uintptr_t) &ping_pong_events, (uintptr_t) &wait, 0, 0);
+    }
+
+    event_seconds = get_seconds() - start;
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+
+    // nothing posts, so the wait runs out
+    before = host_syscall(SYSCALL_CODE_SLEEP, 0, 0, 0, 0);
+    result = host_syscall(SYSCALL_CODE_SEMAPHORE_WAIT, (uintptr_t) &ping, 5, 0, 0);
+    after = host_syscall(SYSCALL_CODE_SLEEP, 0, 0, 0, 0);
+
+    printf("semaphore: %.1f ns per post/wait round trip\r\n", semaphore_seconds*1e9/iterations);
+    printf("event flags: %.1f ns per set/wait round trip\r\n", event_seconds*1e9/iterations);
+    printf("semaphore timeout: returned %d after %u ticks, asked for 5\r\n", result, after - before);
+}
+
+
+#define MESSAGE_QUEUE_DEPTH     16
+#define MAX_MESSAGE_SIZE        256
+
+static uint8_t message_buffer[MESSAGE_QUEUE_DEPTH*MAX_MESSAGE_SIZE] __attribute__((aligned(8)));
+static message_queue_t benchmark_queue;
+static unsigned int consumer_messages;
+
+
+static void consuming_task()
+{
+    uint8_t message[MAX_MESSAGE_SIZE];
+
+    for(unsigned int i = 0; i < consumer_messages; i++)
+    {
+        host_syscall(SYSCALL_CODE_MESSAGE_RECEIVE, (uintptr_t) &benchmark_queue, (uintptr_t) message, WAIT_FOREVER, 0);
+    }
+}
+
+
+// messages per second sent by this task and received by a consumer task
+static double time_producer_consumer(unsigned int message_size, unsigned int options, unsigned int iterations)
+{
+    uint8_t message[MAX_MESSAGE_SIZE] = {0};
+    int status;
+    double start, elapsed;
+
+    message_queue_init(&benchmark_queue, message_buffer, MESSAGE_QUEUE_DEPTH, message_size, options);
+    consumer_messages = iterations;
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) consuming_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_MESSAGE_SEND, (uintptr_t) &benchmark_queue, (uintptr_t) message, WAIT_FOREVER, 0);
+    }
+
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+    elapsed = get_seconds() - start;
+
+    return iterations/elapsed;
+}
+
+
+// messages per second sent and received by this task, without any switches
+static double time_send_receive(unsigned int message_size, unsigned int iterations)
+{
+    uint8_t message[MAX_MESSAGE_SIZE] = {0};
+    double start = get_seconds();
+
+    message_queue_init(&benchmark_queue, message_buffer, MESSAGE_QUEUE_DEPTH, message_size, 0);
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_MESSAGE_SEND, (uintptr_t) &benchmark_queue, (uintptr_t) message, WAIT_POLL, 0);
+        host_syscall(SYSCALL_CODE_MESSAGE_RECEIVE, (uintptr_t) &benchmark_queue, (uintptr_t) message, WAIT_POLL, 0);
+    }
+
+    return iterations/(get_seconds() - start);
+}
+
+
+void benchmark_message_queues(unsigned int iterations)
+{
+    unsigned int sizes[] = {4, 32, 256};
+
+    for(unsigned int i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        printf("message queue, %u bytes: %.0f msgs/s in one task, %.0f msgs/s producer to consumer\r\n",
+               sizes[i], time_send_receive(sizes[i], iterations), time_producer_consumer(sizes[i], 0, iterations));
+    }
+
+    printf("message queue, pointers: %.0f msgs/s producer to consumer\r\n",
+           time_producer_consumer(sizeof(void*), MESSAGE_QUEUE_POINTERS, iterations));
+}
+
+
+#define MAX_PIPE_WRITE_SIZE     1024
+
+static int benchmark_pipe[2];
+static unsigned int reader_bytes;
+
+
+static void pipe_reading_task()
+{
+    uint8_t buffer[MAX_PIPE_WRITE_SIZE];
+    unsigned int total = 0;
+    int bytes_read;
+
+    while(total < reader_bytes)
+    {
+        bytes_read = host_syscall(SYSCALL_CODE_READ, benchmark_pipe[PIPE_READ_END], (uintptr_t) buffer, sizeof(buffer), 0);
+
+        if(bytes_read <= 0)
+        {
+            break;
+        }
+
+        total += bytes_read;
+    }
+}
+
+
+// bytes per second written by this task and read by a reader task
+static double time_pipe(unsigned int write_size, unsigned int iterations)
+{
+    uint8_t buffer[MAX_PIPE_WRITE_SIZE] = {0};
+    int status;
+    double start, elapsed;
+
+    if(host_syscall(SYSCALL_CODE_PIPE, (uintptr_t) benchmark_pipe, 0, 0, 0) < 0)
+    {
+        return 0;
+    }
+
+    reader_bytes = write_size*iterations;
+    host_syscall(SYSCALL_CODE_CREATE_TASK, (uintptr_t) pipe_reading_task, 0, 0, 0);
+
+    start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        host_syscall(SYSCALL_CODE_WRITE, benchmark_pipe[PIPE_WRITE_END], (uintptr_t) buffer, write_size, 0);
+    }
+
+    host_syscall(SYSCALL_CODE_WAIT, (uintptr_t) &status, 0, 0, 0);
+    elapsed = get_seconds() - start;
+
+    host_syscall(SYSCALL_CODE_CLOSE, benchmark_pipe[PIPE_WRITE_END], 0, 0, 0);
+    host_syscall(SYSCALL_CODE_CLOSE, benchmark_pipe[PIPE_READ_END], 0, 0, 0);
+
+    return reader_bytes/elapsed;
+}
+
+
+void benchmark_pipes(unsigned int iterations)
+{
+    unsigned int sizes[] = {16, PIPE_BUFFER_SIZE, MAX_PIPE_WRITE_SIZE};
+
+    for(unsigned int i = 0; i < sizeof(sizes)/sizeof(sizes[0]); i++)
+    {
+        printf("pipe, %u byte writes: %.1f MB/s writer to reader\r\n", sizes[i], time_pipe(sizes[i], iterations)/1e6);
+    }
+}
+
+
+
+#define FILE_BENCHMARK_ACCESS_SIZE  16
+
+static int benchmark_file;
+static uint8_t file_buffer[FILE_BENCHMARK_ACCESS_SIZE];
+
+
+/*
+ * Nanoseconds per iteration of one of the file access loops. The
+ * accesses seek back to the start each time, so the file stays
+ * within its first block.
+ */
+static double time_file_syscalls(int code, unsigned int iterations)
+{
+    double start = get_seconds();
+
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        switch(code)
+        {
+        case SYSCALL_CODE_OPEN:
+            host_syscall(SYSCALL_CODE_CLOSE, host_syscall(SYSCALL_CODE_OPEN, (uintptr_t) "/benchmark", 0, 0, 0), 0, 0, 0);
+            break;
+
+        case SYSCALL_CODE_SEEK:
+            host_syscall(SYSCALL_CODE_SEEK, benchmark_file, 0, 0, 0);
+            break;
+
+        default:
+            host_syscall(SYSCALL_CODE_SEEK, benchmark_file, 0, 0, 0);
+            host_syscall(code, benchmark_file, (uintptr_t) file_buffer, sizeof(file_buffer), 0);
+            break;
+        }
+    }
+
+    return (get_seconds() - start)*1e9/iterations;
+}
+
+
+void benchmark_file_syscalls(unsigned int iterations)
+{
+    host_syscall(SYSCALL_CODE_MKFILE, (uintptr_t) "/benchmark", 0, 0, 0);
+    benchmark_file = host_syscall(SYSCALL_CODE_OPEN, (uintptr_t) "/benchmark", 0, 0, 0);
+
+    printf("file syscalls: %.1f ns per open/close, %.1f ns per seek, %.1f ns per seek/read, %.1f ns per seek/write\r\n",
+           time_file_syscalls(SYSCALL_CODE_OPEN, iterations),
+           time_file_syscalls(SYSCALL_CODE_SEEK, iterations),
+           time_file_syscalls(SYSCALL_CODE_READ, iterations),
+           time_file_syscalls(SYSCALL_CODE_WRITE, iterations));
+
+    host_syscall(SYSCALL_CODE_CLOSE, benchmark_file, 0, 0, 0);
+}
+
+
+
+#define LOG_RECORDS         100
+#define LOG_RECORD_SIZE     16
+
+static syscall_ring_t log_ring;
+
+
+static void queue_operation(syscall_ring_t *ring, uint32_t code, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    syscall_submission_t *submission = &ring->submissions[ring->submission_tail & (SYSCALL_RING_SIZE - 1)];
+
+    submission->code = code;
+    submission->args[0] = arg0;
+    submission->args[1] = arg1;
+    submission->args[2] = arg2;
+    submission->user_data = ring->submission_tail;
+
+    ring->submission_tail++;
+}
+
+
+/*
+ * Writes LOG_RECORDS records to the start of a file, either with
+ * one system call each or queued in a syscall ring, and returns
+ * how many traps it took.
+ */
+static unsigned int write_log(int file_descriptor, uint8_t records[][LOG_RECORD_SIZE], int batched)
+{
+    unsigned int traps = 0;
+
+    if(!batched)
+    {
+        host_syscall(SYSCALL_CODE_SEEK, file_descriptor, 0, 0, 0);
+
+        for(unsigned int i = 0; i < LOG_RECORDS; i++)
+        {
+            host_syscall(SYSCALL_CODE_WRITE, file_descriptor, (uintptr_t) records[i], LOG_RECORD_SIZE, 0);
+        }
+
+        return LOG_RECORDS + 1;
+    }
+
+    queue_operation(&log_ring, SYSCALL_CODE_SEEK, file_descriptor, 0, 0);
+
+    for(unsigned int i = 0; i < LOG_RECORDS; i++)
+    {
+        // enter once the ring is full, and take the completions
+        if(log_ring.submission_tail - log_ring.submission_head == SYSCALL_RING_SIZE)
+        {
+            host_syscall(SYSCALL_CODE_RING_ENTER, (uintptr_t) &log_ring, 0, 0, 0);
+            log_ring.completion_head = log_ring.completion_tail;
+            traps++;
+        }
+
+        queue_operation(&log_ring, SYSCALL_CODE_WRITE, file_descriptor, (uintptr_t) records[i], LOG_RECORD_SIZE);
+    }
+
+    host_syscall(SYSCALL_CODE_RING_ENTER, (uintptr_t) &log_ring, 0, 0, 0);
+    log_ring.completion_head = log_ring.completion_tail;
+
+    return traps + 1;
+}
+
+
+void benchmark_syscall_ring(unsigned int iterations)
+{
+    static uint8_t records[LOG_RECORDS][LOG_RECORD_SIZE];
+    unsigned int traps[2];
+    double start, rate[2];
+    int file_descriptor;
+
+    host_syscall(SYSCALL_CODE_MKFILE, (uintptr_t) "/log", 0, 0, 0);
+    file_descriptor = host_syscall(SYSCALL_CODE_OPEN, (uintptr_t) "/log", 0, 0, 0);
+
+    for(int batched = 0; batched <= 1; batched++)
+    {
+        start = get_seconds();
+
+        for(unsigned int i = 0; i < iterations/LOG_RECORDS; i++)
+        {
+            traps[batched] = write_log(file_descriptor, records, batched);
+        }
+
+        rate[batched] = (iterations/LOG_RECORDS)*LOG_RECORDS/(get_seconds() - start);
+    }
+
+    printf("logging %u records of %u bytes: %u traps and %.0f records/s one call each, %u traps and %.0f records/s through a syscall ring\r\n",
+           LOG_RECORDS, LOG_RECORD_SIZE, traps[0], rate[0], traps[1], rate[1]);
+
+    host_syscall(SYSCALL_CODE_CLOSE, file_descriptor, 0, 0, 0);
+}
+
+
+extern task_table_t task_table;
+extern deferred_work_queue_t deferred_work_queue;
+
+#define DEFERRED_WORK_BURST     8
+
+static volatile uint32_t deferred_work_checksum;
+
+
+// stands in for a receive callback, such as a line discipline redrawing the terminal
+static void checksum_work(void *data, uint32_t value)
+{
+    uint32_t checksum = value;
+
+    for(unsigned int i = 0; i < 2000; i++)
+    {
+        checksum = checksum*31 + i;
+    }
+
+    deferred_work_checksum = checksum;
+}
+
+
+void benchmark_deferred_work(unsigned int iterations)
+{
+    unsigned int start, inline_cycles = 0, post_cycles = 0, posted = 0;
+    unsigned int completed = deferred_work_queue.completed;
+    unsigned int total_latency = deferred_work_queue.total_latency;
+
+    deferred_work_queue.max_latency = 0;
+
+    for(unsigned int i = 0; i < iterations/DEFERRED_WORK_BURST; i++)
+    {
+        // time spent with interrupts disabled, as the handler of a burst of interrupts would spend it
+        for(unsigned int j = 0; j < DEFERRED_WORK_BURST; j++)
+        {
+            disable_interrupts();
+            start = read_cycle_counter();
+            checksum_work(NULL, j);
+            inline_cycles += read_cycle_counter() - start;
+            enable_interrupts();
+        }
+
+        for(unsigned int j = 0; j < DEFERRED_WORK_BURST; j++)
+        {
+            disable_interrupts();
+            start = read_cycle_counter();
+            defer_work(&task_table, &deferred_work_queue, checksum_work, NULL, j);
+            post_cycles += read_cycle_counter() - start;
+            enable_interrupts();
+            posted++;
+        }
+
+        // the next scheduling point hands the CPU to the worker
+        host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+    }
+
+    completed = deferred_work_queue.completed - completed;
+    total_latency = deferred_work_queue.total_latency - total_latency;
+
+    printf("deferred work: %.0f ns in the handler run inline, %.0f ns to post\r\n",
+           (double) inline_cycles/posted, (double) post_cycles/posted);
+    printf("deferred work: %u of %u items run, %.0f ns average and %u ns worst from post to start\r\n",
+           completed, posted, (double) total_latency/(completed ? completed : 1), deferred_work_queue.max_latency);
+}
+
+
+
+extern kernel_data_page_t kernel_data_page;
+
+static volatile uint64_t kernel_data_sink;
+
+
+void benchmark_kernel_data(unsigned int iterations)
+{
+    kernel_data_page_t snapshot;
+    double start, trap_seconds, page_seconds, time_seconds;
+
+    // sleep_ticks(0) is how a task read the tick count before the page
+    start = get_seconds();
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        kernel_data_sink += host_syscall(SYSCALL_CODE_SLEEP, 0, 0, 0, 0);
+    }
+    trap_seconds = get_seconds() - start;
+
+    start = get_seconds();
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        kernel_data_sink += *(volatile uint32_t *) &kernel_data_page.ticks;
+    }
+    page_seconds = get_seconds() - start;
+
+    // a full time base read, as the API does it with rdhwr in place of read_cycle_counter
+    start = get_seconds();
+    for(unsigned int i = 0; i < iterations; i++)
+    {
+        read_kernel_data(&kernel_data_page, &snapshot);
+        kernel_data_sink += snapshot.time_base + (uint32_t)(read_cycle_counter() - snapshot.time_base_count);
+    }
+    time_seconds = get_seconds() - start;
+
+    printf("kernel data: %.1f ns per tick count by system call, %.1f ns from the page, %.1f ns per time base read\r\n",
+           trap_seconds*1e9/iterations, page_seconds*1e9/iterations, time_seconds*1e9/iterations);
+}
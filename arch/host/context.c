@@ -0,0 +1,214 @@
+/*
+ * Task context switching for the hosted port, in place of
+ * context_switch.S. Every task slot has a ucontext that holds
+ * the task's host registers while it is switched out. The
+ * register array in the task control block is still kept up to
+ * date for the fields the kernel reads, namely the entry point
+ * in PC and the return value in V0.
+ *
+ * A context belongs to the task whose ID it was made for, so a
+ * slot that has been reused by a newer task is given a fresh
+ * context the first time that task is switched to.
+ */
+
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "host.h"
+#include "hardware.h"
+#include "syscall.h"
+#include "task.h"
+#include "trace.h"
+#include "syscall_stats.h"
+#include "kernel_data.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+extern unsigned int need_resched;
+
+/*
+ * Defined in syscall.c
+ */
+extern void *syscall_table[];
+
+
+typedef int (*host_syscall_handler_t)(uintptr_t, uintptr_t, uintptr_t, uintptr_t);
+
+
+typedef struct
+{
+    ucontext_t context;
+
+    // task the context was made for
+    taskid_t task_id;
+
+} host_context_t;
+
+
+/*
+ * Zeroed contexts are owned by task ID 0, which is the root task.
+ * The root context is made explicitly by host_start_tasks, and
+ * the idle task's ID is TASK_ID_NONE, so its context is made on
+ * the first switch to it.
+ */
+static host_context_t task_contexts[MAX_TASKS];
+static host_context_t idle_context;
+
+// context of main, which the root task returns to when it exits
+static ucontext_t kernel_context;
+
+
+
+static host_context_t *get_host_context(task_control_block_t *task)
+{
+    if(task == &task_table.idle_task)
+    {
+        return &idle_context;
+    }
+
+    return &task_contexts[task - task_table.tasks];
+}
+
+
+/*
+ * First code run by every task. The entry point comes from the
+ * PC slot, like eret would take it from EPC on MIPS, and the
+ * task falls into the RA slot's exit routine if it returns.
+ */
+static void task_entry()
+{
+    task_control_block_t *task = task_table.current_task;
+    void (*function)() = (void (*)()) (uintptr_t) task->regs[REGISTER_PC];
+    void (*exit_function)(int) = (void (*)(int)) (uintptr_t) task->regs[REGISTER_RA];
+
+    // tasks start with interrupts enabled, as after eret
+    enable_interrupts();
+
+    function();
+    exit_function(0);
+}
+
+
+static void make_task_context(host_context_t *host_context, task_control_block_t *task)
+{
+    getcontext(&host_context->context);
+
+    host_context->context.uc_stack.ss_sp = (char*) task->stack.top - task->stack.size;
+    host_context->context.uc_stack.ss_size = task->stack.size;
+    host_context->context.uc_link = NULL;
+
+    makecontext(&host_context->context, task_entry, 0);
+    host_context->task_id = task->task_id;
+}
+
+
+/*
+ * Switches from the given task to whichever task is now current
+ * in the task table. Must be called with interrupts disabled.
+ */
+static void switch_to_current_task(task_control_block_t *previous)
+{
+    task_control_block_t *next = task_table.current_task;
+    host_context_t *from = get_host_context(previous);
+    host_context_t *to = get_host_context(next);
+
+    if(next == previous)
+    {
+        return;
+    }
+
+    // a context still owned by an older task in the slot cannot be resumed
+    if(to->task_id != next->task_id)
+    {
+        make_task_context(to, next);
+    }
+
+    swapcontext(&from->context, &to->context);
+}
+
+
+int host_syscall(int code, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3)
+{
+    task_control_block_t *caller = task_table.current_task;
+    host_syscall_handler_t handler;
+    int result;
+
+    if(code < 0 || code >= NUM_SYSCALLS || syscall_table[code] == NULL)
+    {
+        return ERROR_INVALID_SYSCALL;
+    }
+
+    handler = (host_syscall_handler_t) syscall_table[code];
+
+    // system calls run with interrupts disabled, as they do with EXL set
+    disable_interrupts();
+
+    TRACE(TRACE_EVENT_SYSCALL_ENTER, code);
+    SYSCALL_STATS_ENTER(code, a0, a1, a2);
+    result = handler(a0, a1, a2, a3);
+    SYSCALL_STATS_EXIT(result);
+    TRACE(TRACE_EVENT_SYSCALL_EXIT, 0);
+
+    if(need_resched)
+    {
+        need_resched = 0;
+        schedule_next_task(&task_table);
+        update_kernel_data();
+    }
+
+    // the return value goes into the caller's frame, as _syscall_context_switch does
+    caller->regs[REGISTER_V0] = result;
+
+    switch_to_current_task(caller);
+
+    enable_interrupts();
+
+    return (int) caller->regs[REGISTER_V0];
+}
+
+
+void request_reschedule()
+{
+    host_syscall(SYSCALL_CODE_YIELD, 0, 0, 0, 0);
+}
+
+
+void kernel_semaphore_wait(struct SEMAPHORE *semaphore)
+{
+    host_syscall(SYSCALL_CODE_SEMAPHORE_WAIT, (uintptr_t) semaphore, WAIT_FOREVER, 0, 0);
+}
+
+
+void host_start_tasks()
+{
+    host_context_t *root = get_host_context(task_table.current_task);
+
+    disable_interrupts();
+    make_task_context(root, task_table.current_task);
+    swapcontext(&kernel_context, &root->context);
+    enable_interrupts();
+}
+
+
+/*
+ * Return address of the root task. Ends the run by going back
+ * to the kernel context that host_start_tasks saved.
+ */
+void _exit_main(int status)
+{
+    disable_interrupts();
+    setcontext(&kernel_context);
+}
+
+
+/*
+ * Return address of every other task. The exit system call
+ * never returns, since the task is not run again.
+ */
+void _exit_task(int status)
+{
+    host_syscall(SYSCALL_CODE_EXIT, status, 0, 0, 0);
+}
@@ -0,0 +1,93 @@
+
+# BUILD_DIR, CC, INCLUDE_PATHS are exported to this
+# file from the top-level Makefile
+#
+# Builds the kernel core into a Linux executable. The
+# hardware-specific kernel files (init.c, stdlib.c and
+# the device driver subsystem) are replaced by the files
+# in this directory.
+
+OBJ_DIR = $(BUILD_DIR)/host
+
+KERNEL_DIR = $(BASEDIR)/kernel
+
+EXECUTABLE_TARGET = $(BUILD_DIR)/miniOS_host
+
+
+
+#############################################
+#											#
+#		ADD NEW SOURCE FILES HERE			#
+#											#
+#############################################
+
+HOST_SOURCES =	benchmarks.c	\
+				context.c		\
+				interrupts.c	\
+				lib.c			\
+				main.c			\
+				mutex.c			\
+				posix_timer.c
+
+KERNEL_SOURCES =	deferred_work.c		\
+					event.c				\
+					filesystem.c		\
+					fs_archive.c		\
+					global_structs.c	\
+					idle.c				\
+					kernel_data.c		\
+					kheap.c				\
+					message_queue.c		\
+					mutex.c				\
+					pipe.c				\
+					protothread.c		\
+					realtime.c			\
+					semaphore.c			\
+					syscall.c			\
+					syscall_ring.c		\
+					syscall_stats.c		\
+					task.c				\
+					timers.c			\
+					trace.c				\
+					shell/line_discipline.c		\
+					shell/scrollback_buffer.c	\
+					shell/terminal_control.c
+
+
+HOST_OBJS = $(patsubst %.c, $(OBJ_DIR)/%.o, $(HOST_SOURCES))
+KERNEL_OBJS = $(patsubst %.c, $(OBJ_DIR)/kernel/%.o, $(KERNEL_SOURCES))
+
+
+# Registers are 32 bits wide in the task control block, so
+# the executable is not position independent and everything
+# the kernel takes the address of lies below 4 GiB. Frames
+# are larger than on MIPS, so the stack sizes are raised.
+CFLAGS = -g -O2 -fno-pie -fno-common
+CFLAGS += -DMAIN_STACK_SIZE=65536 -DDEFAULT_STACK_SIZE=16384 -DMIN_STACK_SIZE=8192
+CFLAGS += -DIDLE_STACK_WORDS=4096
+
+# kernel headers are included with quotes, and include/stdlib.h
+# must not hide the C library's from <stdlib.h>. The MIPS arch
+# headers are swapped for this directory's.
+HOST_INCLUDE_PATHS = $(subst -I,-iquote ,$(filter-out -I$(BASEDIR)/arch/%, $(INCLUDE_PATHS))) -iquote include
+
+LINK_FLAGS = -no-pie
+LIBS = -lrt
+
+
+.PHONY: all setup
+
+all: setup $(EXECUTABLE_TARGET)
+
+setup:
+	if [ ! -d $(OBJ_DIR)/kernel/shell ]; then mkdir -p $(OBJ_DIR)/kernel/shell; fi
+
+
+$(EXECUTABLE_TARGET): $(HOST_OBJS) $(KERNEL_OBJS)
+	$(CC) $(LINK_FLAGS) $^ $(LIBS) -o $@
+
+$(HOST_OBJS): $(OBJ_DIR)/%.o: %.c
+	$(CC) $(HOST_INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
+
+$(KERNEL_OBJS): $(OBJ_DIR)/kernel/%.o: $(KERNEL_DIR)/%.c
+	$(CC) $(HOST_INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
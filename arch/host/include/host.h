@@ -0,0 +1,135 @@
+#ifndef HOST_H
+#define HOST_H
+
+/**
+ * @file host.h
+ *
+ * Interface of the hosted Linux port. The kernel core runs as
+ * an ordinary process: tasks are ucontext contexts running on
+ * the stacks handed out by the task stack allocator, the tick
+ * timer is a POSIX timer delivering SIGALRM, and the terminal
+ * is stdin/stdout. Blocking SIGALRM stands in for disabling
+ * interrupts.
+ *
+ * The kernel stores addresses in 32-bit register slots, so the
+ * port must be linked as a non-PIE executable to keep code and
+ * static data below 4 GiB.
+ */
+
+#include <stdint.h>
+
+#include "mutex.h"
+
+
+/*
+ * Enters the kernel with the given system call code and up to
+ * four arguments, the same as the syscall wrappers do on MIPS
+ * with v0 and a0-a3. If the handler picked another task to run,
+ * the caller is switched out and this returns once it runs again.
+ */
+int host_syscall(int code, uintptr_t a0, uintptr_t a1, uintptr_t a2, uintptr_t a3);
+
+/*
+ * Lock and unlock a mutex_t the way the API wrappers do on MIPS,
+ * entering the kernel only when the mutex is contended.
+ */
+int host_mutex_lock(mutex_t *mutex);
+int host_mutex_unlock(mutex_t *mutex);
+
+/*
+ * Saves the kernel context and starts running the current task
+ * from the task table. Returns only once no task can run.
+ */
+void host_start_tasks();
+
+/*
+ * Starts the POSIX timer standing in for the core timer and
+ * installs its signal handler on a dedicated interrupt stack.
+ */
+void init_host_timer();
+
+/*
+ * Puts the terminal into raw mode so that the line discipline
+ * sees every byte, and restores it when the process exits.
+ */
+void init_host_console();
+
+
+/*
+ * Benchmarks run from the root task, printing their results.
+ * Each spawns a child, lets it exit and reaps it, iterations
+ * times, and reports round trips per second.
+ */
+void benchmark_spawn_exit_wait(unsigned int iterations);
+
+/*
+ * Runs the same number of jobs, each yielding the given number
+ * of times, first as one task per job and then as protothreads
+ * inside the calling task, and reports the cost of a switch and
+ * the memory taken per job for each.
+ */
+void benchmark_protothreads(unsigned int yields);
+
+/*
+ * Runs a periodic sleep_until loop in the calling task and
+ * reports how far the wall clock time is from the number of
+ * periods asked for, and how many wakeups were late.
+ */
+void benchmark_sleep(unsigned int periods, unsigned int period_ticks);
+
+/*
+ * Times mutex lock/unlock pairs that stay on the fast path, and
+ * lock/unlock pairs where another task is blocked on the mutex
+ * so both go through the kernel.
+ */
+void benchmark_mutexes(unsigned int iterations);
+
+/*
+ * Times semaphore and event flag handoffs between the calling
+ * task and a child, each of which blocks the waiter, and checks
+ * that a wait on an empty semaphore times out on time.
+ */
+void benchmark_semaphores(unsigned int iterations);
+
+/*
+ * Reports messages per second through a message queue for a few
+ * message sizes, sent and received by the calling task itself,
+ * and passed from a producer to a consumer task.
+ */
+void benchmark_message_queues(unsigned int iterations);
+
+/*
+ * Reports bytes per second through a pipe from a writer task to
+ * a reader task, for a few write sizes.
+ */
+void benchmark_pipes(unsigned int iterations);
+
+/*
+ * Reports the time taken by open and close, seek, and reads and
+ * writes of a ramdisk file, none of which block or wake a task.
+ */
+void benchmark_file_syscalls(unsigned int iterations);
+
+/*
+ * Reports the traps taken and records per second for a burst of
+ * small log writes, made one system call at a time and queued in
+ * a syscall ring.
+ */
+void benchmark_syscall_ring(unsigned int iterations);
+
+/*
+ * Compares the time an interrupt handler spends running a
+ * callback inline against posting it as deferred work, and
+ * reports how long posted work waits for the worker task.
+ */
+void benchmark_deferred_work(unsigned int iterations);
+
+/*
+ * Compares reading the tick count through a system call against
+ * reading it from the kernel data page, and times a consistent
+ * read of the page's time base.
+ */
+void benchmark_kernel_data(unsigned int iterations);
+
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Interrupt control for the hosted port. The only interrupt
+ * source is the tick timer's SIGALRM, so blocking that signal
+ * is the equivalent of disabling interrupts.
+ */
+
+#include <signal.h>
+#include <stddef.h>
+
+#include "hardware.h"
+
+
+
+void disable_interrupts()
+{
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigprocmask(SIG_BLOCK, &mask, NULL);
+}
+
+
+void enable_interrupts()
+{
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+
+
+unsigned int save_and_disable_interrupts()
+{
+    sigset_t mask, previous;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGALRM);
+    sigprocmask(SIG_BLOCK, &mask, &previous);
+
+    // SIGALRM is already blocked inside its own handler
+    return !sigismember(&previous, SIGALRM);
+}
+
+
+void restore_interrupts(unsigned int were_enabled)
+{
+    if(were_enabled)
+    {
+        enable_interrupts();
+    }
+}
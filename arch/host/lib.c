@@ -0,0 +1,23 @@
+/*
+ * Kernel library routines for the hosted port. kernel/stdlib.c
+ * defines a memset that would replace the C library's for the
+ * whole process, so the port supplies the routines the kernel
+ * uses on top of the C library instead.
+ */
+
+#include <string.h>
+
+#include "stdlib.h"
+
+
+
+void memcopy(void *dest, void *source, unsigned int num_bytes)
+{
+    memcpy(dest, source, num_bytes);
+}
+
+
+int string_compare(char *str1, char *str2, int max_string_len)
+{
+    return strncmp(str1, str2, max_string_len);
+}
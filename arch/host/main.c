@@ -0,0 +1,338 @@
+/*
+ * Entry point of the hosted port. Sets up the kernel the same
+ * way init_kernel does on the PIC32, with static arrays in place
+ * of the regions the linker script reserves, and then runs the
+ * root task. The root task drives the line discipline from
+ * stdin, so the shell runs in a terminal instead of over UART2.
+ *
+ * There is no preemption, as on the hardware, so other tasks
+ * only run when the root task makes a system call that lets
+ * them, and not while it is blocked reading stdin.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "host.h"
+#include "task.h"
+#include "syscall.h"
+#include "kheap.h"
+#include "filesystem.h"
+#include "timers.h"
+#include "idle.h"
+#include "deferred_work.h"
+#include "trace.h"
+#include "kernel_data.h"
+#include "syscall_stats.h"
+#include "line_discipline.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+extern uint32_t *current_task_register_base;
+extern uint32_t *kernel_register_base;
+extern heap_cb_t kernel_heap_cb;
+extern void *kernel_heap_base;
+extern superblock_t *ramdisk_superblock;
+extern kernel_data_page_t kernel_data_page;
+
+#ifdef CONFIG_TRACE
+extern trace_buffer_t trace_buffer;
+#endif
+
+#ifdef CONFIG_SYSCALL_STATS
+extern syscall_stats_t syscall_stats;
+#endif
+
+
+#define USER_STACK_SPACE_SIZE   (1024*1024)
+#define BENCHMARK_ITERATIONS    100000
+
+#define BENCHMARK_SLEEP_PERIODS         200
+#define BENCHMARK_SLEEP_PERIOD_TICKS    5
+#define STRINGIFY(_x)           #_x
+#define TO_STRING(_x)           STRINGIFY(_x)
+
+
+
+/*
+ * Task stacks are carved out of this array. The stack allocator
+ * finds it through the same symbols the linker script defines on
+ * the PIC32, with the bottom of the array standing in for the end
+ * of the user heap.
+ */
+static char user_stack_space[USER_STACK_SPACE_SIZE] __attribute__((aligned(8), used));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+        ".globl _user_stack\n.set _user_stack, user_stack_space + " TO_STRING(USER_STACK_SPACE_SIZE));
+
+static char kernel_heap[CONFIG_KERNEL_HEAP_SIZE] __attribute__((aligned(8)));
+static char ramdisk[RAMDISK_SIZE] __attribute__((aligned(8)));
+
+
+static struct termios saved_terminal_settings;
+
+static line_discipline_t discipline;
+static char shell_buffer[MAX_LINE_SIZE];
+static int shell_exit_requested;
+static int run_benchmarks;
+
+#ifdef CONFIG_TRACE
+// file given with --trace, which the trace buffer is dumped to at the end of the run
+static FILE *trace_file;
+#endif
+
+int process_next_byte(line_discipline_t *discipline, void *buffer, uint32_t size);
+
+
+
+int terminal_send_byte(uint8_t byte_to_send)
+{
+    putchar(byte_to_send);
+
+    return 0;
+}
+
+
+#ifdef CONFIG_SYSCALL_STATS
+static void write_terminal(const void *data, unsigned int size)
+{
+    fwrite(data, 1, size, stdout);
+}
+#endif
+
+
+static void restore_terminal()
+{
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal_settings);
+}
+
+
+void init_host_console()
+{
+    struct termios raw;
+
+    if(!isatty(STDIN_FILENO))
+    {
+        return;
+    }
+
+    tcgetattr(STDIN_FILENO, &saved_terminal_settings);
+    atexit(restore_terminal);
+
+    // the line discipline does its own echoing and line editing
+    raw = saved_terminal_settings;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+}
+
+
+/*
+ * Prints the CPU accounting of every task. Run times are in
+ * cycle counter counts, which are nanoseconds on the host, and
+ * each wait histogram bucket is shown as its lower bound.
+ */
+static void print_task_stats()
+{
+    task_stats_t stats;
+    taskid_t task_id;
+
+    printf("%6s %14s %9s  wait histogram\r\n", "id", "run cycles", "switches");
+
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        task_id = task_table.tasks[i].task_id;
+
+        if(task_id == TASK_ID_NONE || host_syscall(SYSCALL_CODE_TASK_STATS, task_id, (uintptr_t) &stats, 0, 0) < 0)
+        {
+            continue;
+        }
+
+        printf("%6d %14llu %9u ", task_id, stats.run_cycles, stats.num_switches);
+
+        for(int bucket = 0; bucket < WAIT_HISTOGRAM_BUCKETS; bucket++)
+        {
+            if(stats.wait_histogram[bucket] != 0)
+            {
+                printf(" %u:%u", bucket ? (1u << bucket) << WAIT_HISTOGRAM_SHIFT : 0, stats.wait_histogram[bucket]);
+            }
+        }
+
+        printf("\r\n");
+    }
+}
+
+
+static int invoke_shell(void)
+{
+    if(!strcmp(shell_buffer, "ticks"))
+    {
+        printf("system ticks: %u, idle ticks: %u\r\n", get_system_ticks(), get_idle_ticks());
+    }
+    else if(!strcmp(shell_buffer, "tasks"))
+    {
+        print_task_stats();
+    }
+    else if(!strcmp(shell_buffer, "bench"))
+    {
+        benchmark_spawn_exit_wait(BENCHMARK_ITERATIONS);
+        benchmark_protothreads(BENCHMARK_ITERATIONS);
+        benchmark_sleep(BENCHMARK_SLEEP_PERIODS, BENCHMARK_SLEEP_PERIOD_TICKS);
+        benchmark_mutexes(BENCHMARK_ITERATIONS);
+        benchmark_semaphores(BENCHMARK_ITERATIONS);
+        benchmark_message_queues(BENCHMARK_ITERATIONS);
+        benchmark_pipes(BENCHMARK_ITERATIONS);
+        benchmark_file_syscalls(BENCHMARK_ITERATIONS);
+        benchmark_syscall_ring(BENCHMARK_ITERATIONS);
+        benchmark_deferred_work(BENCHMARK_ITERATIONS);
+        benchmark_kernel_data(BENCHMARK_ITERATIONS);
+    }
+#ifdef CONFIG_SYSCALL_STATS
+    else if(!strcmp(shell_buffer, "syscalls"))
+    {
+        syscall_stats_dump(&syscall_stats, write_terminal);
+    }
+#endif
+    else if(!strcmp(shell_buffer, "exit"))
+    {
+        shell_exit_requested = 1;
+    }
+    else if(shell_buffer[0] != '\0')
+    {
+        printf("unknown command: %s\r\n", shell_buffer);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Body of the root task. Returning from it ends the run.
+ */
+static void root_task()
+{
+    unsigned char byte;
+
+    // with --benchmark, run the benchmarks without the shell
+    if(run_benchmarks)
+    {
+        benchmark_spawn_exit_wait(BENCHMARK_ITERATIONS);
+        benchmark_protothreads(BENCHMARK_ITERATIONS);
+        benchmark_sleep(BENCHMARK_SLEEP_PERIODS, BENCHMARK_SLEEP_PERIOD_TICKS);
+        benchmark_mutexes(BENCHMARK_ITERATIONS);
+        benchmark_semaphores(BENCHMARK_ITERATIONS);
+        benchmark_message_queues(BENCHMARK_ITERATIONS);
+        benchmark_pipes(BENCHMARK_ITERATIONS);
+        benchmark_file_syscalls(BENCHMARK_ITERATIONS);
+        benchmark_syscall_ring(BENCHMARK_ITERATIONS);
+        benchmark_deferred_work(BENCHMARK_ITERATIONS);
+        benchmark_kernel_data(BENCHMARK_ITERATIONS);
+#ifdef CONFIG_SYSCALL_STATS
+        syscall_stats_dump(&syscall_stats, write_terminal);
+#endif
+        return;
+    }
+
+    line_discipline_init(&discipline, process_next_byte, invoke_shell, "miniOS % ", shell_buffer);
+    fflush(stdout);
+
+    while(!shell_exit_requested && read(STDIN_FILENO, &byte, 1) == 1)
+    {
+        discipline.process_next_byte(&discipline, &byte, 1);
+        fflush(stdout);
+    }
+
+    printf("\r\n");
+}
+
+
+#ifdef CONFIG_TRACE
+static void write_trace_file(const void *data, unsigned int size)
+{
+    fwrite(data, 1, size, trace_file);
+}
+#endif
+
+
+int main(int argc, char **argv)
+{
+    const char *trace_path = NULL;
+
+    // task registers hold addresses in 32 bits
+    if((uintptr_t) &user_stack_space[USER_STACK_SPACE_SIZE] > UINT32_MAX)
+    {
+        fprintf(stderr, "miniOS must be linked as a non-PIE executable\n");
+        return 1;
+    }
+
+    for(int arg = 1; arg < argc; arg++)
+    {
+        if(!strcmp(argv[arg], "--benchmark"))
+        {
+            run_benchmarks = 1;
+        }
+        else if(!strcmp(argv[arg], "--trace") && arg + 1 < argc)
+        {
+            trace_path = argv[++arg];
+        }
+    }
+
+#ifdef CONFIG_SYSCALL_STATS
+    syscall_stats_init(&syscall_stats);
+#endif
+
+#ifdef CONFIG_TRACE
+    trace_init(&trace_buffer);
+#else
+    if(trace_path != NULL)
+    {
+        fprintf(stderr, "miniOS was built without CONFIG_TRACE\n");
+        return 1;
+    }
+#endif
+
+    kernel_data_init(&kernel_data_page);
+
+    task_table_init(&task_table);
+    init_idle_task(&task_table);
+    update_kernel_data();
+    set_task_register_value(&task_table, get_current_task(&task_table), REGISTER_PC, (uintptr_t) root_task);
+
+    current_task_register_base = &task_table.current_task->regs[0];
+    kernel_register_base = &task_table.kernel_regs[0];
+
+    kernel_heap_base = kernel_heap;
+    init_heap(&kernel_heap_cb);
+
+    ramdisk_superblock = (superblock_t*) ramdisk;
+    init_filesystem();
+    init_timer_system();
+    init_deferred_work(&task_table);
+
+    init_host_console();
+    init_host_timer();
+
+    host_start_tasks();
+
+#ifdef CONFIG_TRACE
+    if(trace_path != NULL)
+    {
+        if((trace_file = fopen(trace_path, "wb")) == NULL)
+        {
+            perror(trace_path);
+            return 1;
+        }
+
+        trace_dump(&trace_buffer, write_trace_file);
+        fclose(trace_file);
+    }
+#endif
+
+    return 0;
+}
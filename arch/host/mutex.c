@@ -0,0 +1,48 @@
+/*
+ * Mutex fast paths for the hosted port, doing what the LL/SC
+ * sequences in api/mutex.S do with compare-and-swap. Tasks on
+ * the host call these in place of the API wrappers.
+ */
+
+#include <stdint.h>
+
+#include "host.h"
+#include "syscall.h"
+#include "mutex.h"
+
+
+
+// an address in the calling task's stack names it as the owner
+static inline uint32_t get_stack_address()
+{
+    return (uint32_t)(uintptr_t) __builtin_frame_address(0);
+}
+
+
+int host_mutex_lock(mutex_t *mutex)
+{
+    uint32_t expected = MUTEX_UNLOCKED;
+
+    if(__atomic_compare_exchange_n(&mutex->lock, &expected, get_stack_address(), 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        return 0;
+    }
+
+    return host_syscall(SYSCALL_CODE_MUTEX_LOCK, (uintptr_t) mutex, 0, 0, 0);
+}
+
+
+int host_mutex_unlock(mutex_t *mutex)
+{
+    uint32_t lock = __atomic_load_n(&mutex->lock, __ATOMIC_RELAXED);
+
+    while(!(lock & MUTEX_CONTENDED))
+    {
+        if(__atomic_compare_exchange_n(&mutex->lock, &lock, MUTEX_UNLOCKED, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        {
+            return 0;
+        }
+    }
+
+    return host_syscall(SYSCALL_CODE_MUTEX_UNLOCK, (uintptr_t) mutex, 0, 0, 0);
+}
@@ -0,0 +1,201 @@
+/*
+ * Tick timer implementation for the hosted port, in place of
+ * the MIPS core timer. CLOCK_MONOTONIC plays the part of the
+ * Count register and a one-shot POSIX timer armed for an
+ * absolute time plays the part of Compare, so ticks are counted
+ * the same way as in core_timer.c and the idle task can sleep
+ * through several of them.
+ */
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host.h"
+#include "hardware.h"
+#include "timers.h"
+#include "realtime.h"
+#include "trace.h"
+#include "kernel_data.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+
+
+#define NANOSECONDS_PER_SECOND      1000000000ULL
+#define HOST_TIMER_NS_PER_TICK      (NANOSECONDS_PER_SECOND/TICK_RATE_HZ)
+
+// traced as the core timer's vector, whose part the signal plays
+#define HOST_TIMER_VECTOR           0
+
+/*
+ * Smallest distance into the future the timer is armed for, so
+ * that a wakeup in the past still produces a signal.
+ */
+#define HOST_TIMER_MIN_DELTA        1000
+
+// the signal handler gets its own stack, as task stacks are sized for the kernel
+#define INTERRUPT_STACK_SIZE        (64*1024)
+
+
+static timer_t tick_timer;
+
+// monotonic time of the most recent tick that was counted
+static uint64_t last_tick_time;
+
+static char interrupt_stack[INTERRUPT_STACK_SIZE];
+
+
+
+static uint64_t get_monotonic_time()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec*NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+
+/*
+ * The cycle counter counts nanoseconds, truncated to 32 bits
+ * like the Count register.
+ */
+unsigned int read_cycle_counter()
+{
+    return (unsigned int) get_monotonic_time();
+}
+
+
+unsigned int get_cycle_counter_frequency()
+{
+    return NANOSECONDS_PER_SECOND;
+}
+
+
+void set_tick_wakeup(unsigned int ticks)
+{
+    uint64_t target = last_tick_time + ticks*HOST_TIMER_NS_PER_TICK;
+    uint64_t now = get_monotonic_time();
+    struct itimerspec wakeup = {0};
+
+    // if the target has already passed, fire as soon as possible
+    if((int64_t)(target - now) < HOST_TIMER_MIN_DELTA)
+    {
+        target = now + HOST_TIMER_MIN_DELTA;
+    }
+
+    wakeup.it_value.tv_sec = target/NANOSECONDS_PER_SECOND;
+    wakeup.it_value.tv_nsec = target%NANOSECONDS_PER_SECOND;
+
+    timer_settime(tick_timer, TIMER_ABSTIME, &wakeup, NULL);
+}
+
+
+/*
+ * Counts whole ticks since the last counted tick. Must be
+ * called with the timer signal unable to preempt it.
+ */
+static unsigned int count_elapsed_ticks()
+{
+    unsigned int elapsed = (get_monotonic_time() - last_tick_time)/HOST_TIMER_NS_PER_TICK;
+    last_tick_time += elapsed*HOST_TIMER_NS_PER_TICK;
+
+    return elapsed;
+}
+
+
+static void process_ticks(unsigned int elapsed)
+{
+    timer_tick(elapsed);
+    realtime_tick(&task_table, get_system_ticks());
+    wake_sleeping_tasks(&task_table, get_system_ticks());
+}
+
+
+void update_tick_count()
+{
+    unsigned int were_enabled;
+    unsigned int elapsed;
+
+    // the tick handler also processes ticks, and must not change the lists while they are
+    were_enabled = save_and_disable_interrupts();
+
+    elapsed = count_elapsed_ticks();
+
+    if(elapsed > 0)
+    {
+        process_ticks(elapsed);
+    }
+
+    restore_interrupts(were_enabled);
+}
+
+
+void wait_for_interrupt()
+{
+    sigset_t mask;
+
+    // sigsuspend unblocks the timer signal and sleeps in one step
+    sigprocmask(SIG_SETMASK, NULL, &mask);
+    sigdelset(&mask, SIGALRM);
+    sigsuspend(&mask);
+
+    enable_interrupts();
+}
+
+
+static void tick_timer_handler(int signal)
+{
+    unsigned int elapsed;
+
+    TRACE(TRACE_EVENT_ISR_ENTER, HOST_TIMER_VECTOR);
+
+    elapsed = count_elapsed_ticks();
+
+    // back to one signal per tick; the idle task reprograms this if it sleeps again
+    set_tick_wakeup(1);
+
+    if(elapsed > 0)
+    {
+        process_ticks(elapsed);
+    }
+
+    update_kernel_data();
+
+    TRACE(TRACE_EVENT_ISR_EXIT, HOST_TIMER_VECTOR);
+}
+
+
+void init_host_timer()
+{
+    struct sigevent event = {0};
+    struct sigaction action = {0};
+    stack_t stack;
+
+    stack.ss_sp = interrupt_stack;
+    stack.ss_size = sizeof(interrupt_stack);
+    stack.ss_flags = 0;
+    sigaltstack(&stack, NULL);
+
+    // the handler runs with the signal blocked, like an ISR at its own priority
+    action.sa_handler = tick_timer_handler;
+    action.sa_flags = SA_ONSTACK | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, NULL);
+
+    event.sigev_notify = SIGEV_SIGNAL;
+    event.sigev_signo = SIGALRM;
+
+    if(timer_create(CLOCK_MONOTONIC, &event, &tick_timer) < 0)
+    {
+        abort();
+    }
+
+    last_tick_time = get_monotonic_time();
+    set_tick_wakeup(1);
+}
@@ -0,0 +1,156 @@
+/*
+ * Tick timer implementation for the MIPS M4K core timer.
+ * The Count register increments at half the system clock,
+ * and an interrupt is raised when it equals Compare. Rather
+ * than reloading a period, Compare is always set relative to
+ * the Count value of the last tick that was counted, so ticks
+ * do not drift and the idle task can program a wakeup several
+ * ticks ahead.
+ */
+
+#include <xc.h>
+#include <sys/attribs.h>
+
+#include "hardware.h"
+#include "timers.h"
+#include "realtime.h"
+#include "trace.h"
+#include "kernel_data.h"
+#include "shadow_set.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+
+
+#define SYSTEM_CLOCK_FREQ           80000000
+#define CORE_TIMER_FREQ             (SYSTEM_CLOCK_FREQ/2)
+#define CORE_TIMER_COUNTS_PER_TICK  (CORE_TIMER_FREQ/TICK_RATE_HZ)
+
+/*
+ * Smallest distance into the future Compare can be set to
+ * and still be guaranteed to match before Count passes it.
+ */
+#define CORE_TIMER_MIN_DELTA        100
+
+// HWREna bit that enables rdhwr of hardware register 2, the cycle counter
+#define HWRENA_CC                   (1 << 2)
+
+
+// Count value at the most recent tick that was counted
+static unsigned int last_tick_count;
+
+
+
+void init_core_timer()
+{
+    last_tick_count = _CP0_GET_COUNT();
+    _CP0_SET_COMPARE(last_tick_count + CORE_TIMER_COUNTS_PER_TICK);
+
+    IFS0bits.CTIF = 0;
+    // in the shadow register set, along with the terminal UART
+    IPC0bits.CTIP = SHADOW_SET_PRIORITY;
+    IEC0bits.CTIE = 1;
+
+    // let user mode read Count with rdhwr, for the kernel data page time base
+    __asm__ volatile("mtc0 %0, $7" : : "r" (HWRENA_CC));
+}
+
+
+unsigned int get_cycle_counter_frequency()
+{
+    return CORE_TIMER_FREQ;
+}
+
+
+void set_tick_wakeup(unsigned int ticks)
+{
+    unsigned int target = last_tick_count + ticks*CORE_TIMER_COUNTS_PER_TICK;
+    unsigned int now = _CP0_GET_COUNT();
+
+    // if the target has already passed, fire as soon as possible
+    if((int)(target - now) < CORE_TIMER_MIN_DELTA)
+    {
+        target = now + CORE_TIMER_MIN_DELTA;
+    }
+
+    _CP0_SET_COMPARE(target);
+}
+
+
+/*
+ * Counts whole ticks since the last counted tick. Must be
+ * called with the core timer interrupt unable to preempt it.
+ */
+static unsigned int count_elapsed_ticks()
+{
+    unsigned int elapsed = (_CP0_GET_COUNT() - last_tick_count)/CORE_TIMER_COUNTS_PER_TICK;
+    last_tick_count += elapsed*CORE_TIMER_COUNTS_PER_TICK;
+
+    return elapsed;
+}
+
+
+/*
+ * Advances the system tick count, then releases any real-time
+ * jobs and wakes any sleeping tasks that became due during
+ * those ticks.
+ */
+static void process_ticks(unsigned int elapsed)
+{
+    timer_tick(elapsed);
+    realtime_tick(&task_table, get_system_ticks());
+    wake_sleeping_tasks(&task_table, get_system_ticks());
+}
+
+
+void update_tick_count()
+{
+    unsigned int were_enabled;
+    unsigned int elapsed;
+
+    // the tick handler also processes ticks, and must not change the lists while they are
+    were_enabled = save_and_disable_interrupts();
+
+    elapsed = count_elapsed_ticks();
+
+    if(elapsed > 0)
+    {
+        process_ticks(elapsed);
+    }
+
+    restore_interrupts(were_enabled);
+}
+
+
+void wait_for_interrupt()
+{
+    // WAIT is privileged, which is fine since the idle task runs in kernel mode
+    __builtin_enable_interrupts();
+    __asm__ volatile("wait");
+}
+
+
+void __ISR(_CORE_TIMER_VECTOR, SHADOW_SET_IPL) core_timer_ISR(void)
+{
+    unsigned int elapsed;
+
+    TRACE(TRACE_EVENT_ISR_ENTER, _CORE_TIMER_VECTOR);
+
+    elapsed = count_elapsed_ticks();
+
+    // back to one interrupt per tick; the idle task reprograms this if it sleeps again
+    set_tick_wakeup(1);
+    IFS0bits.CTIF = 0;
+
+    if(elapsed > 0)
+    {
+        process_ticks(elapsed);
+    }
+
+    update_kernel_data();
+
+    TRACE(TRACE_EVENT_ISR_EXIT, _CORE_TIMER_VECTOR);
+}
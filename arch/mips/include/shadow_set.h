@@ -0,0 +1,42 @@
+#ifndef SHADOW_SET_H
+#define SHADOW_SET_H
+
+
+/**
+ * @file shadow_set.h
+ *
+ * Interrupt priority that runs in the shadow register set. The
+ * M4K core in the PIC32MX795F512L has one shadow set besides the
+ * normal GPRs. In EIC mode the interrupt controller picks the set
+ * for each interrupt, and it picks the shadow set only for the
+ * priority level in the FSRSSEL field of DEVCFG3. On entry to
+ * such an interrupt the core switches SRSCtl<CSS> to the shadow
+ * set, so the handler gets its own GPRs and does not have to save
+ * the ones the interrupted code is using. crt0.S initializes $gp
+ * in the shadow set, and the handler prologue copies $sp from the
+ * previous set with rdpgpr.
+ *
+ * Every handler at this priority shares the one shadow set, which
+ * is only safe because handlers at the same priority never nest.
+ * The priority is also the highest there is, since a handler that
+ * preempted one of these would save the normal set's registers on
+ * the stack below the interrupted handler's frame, as it does not
+ * know about the frame the shadow set's $sp made.
+ *
+ * The core timer and the UART2 vector, which the terminal receives
+ * through, run at this priority.
+ */
+
+
+#define SHADOW_SET_PRIORITY         7
+
+// __ISR priority argument of handlers at SHADOW_SET_PRIORITY
+#define SHADOW_SET_IPL              IPL7SRS
+
+// DEVCFG3 with FSRSSEL, bits 18:16, mapping SHADOW_SET_PRIORITY to the shadow set
+#define DEVCFG3_FSRSSEL_SHIFT       16
+#define DEVCFG3_FSRSSEL_MASK        (0x7 << DEVCFG3_FSRSSEL_SHIFT)
+#define DEVCFG3_VALUE               ((0xffffffff & ~DEVCFG3_FSRSSEL_MASK) | (SHADOW_SET_PRIORITY << DEVCFG3_FSRSSEL_SHIFT))
+
+
+#endif
@@ -1,6 +1,82 @@
 
 #include <xc.h>
 
+#include "hardware.h"
+#include "syscall.h"
+#include "trace.h"
+
+
+/*
+ * Registers a system call made from kernel code can change. The
+ * voluntary frame _syscall_context_switch saves only keeps v0,
+ * s0-s7, gp, sp, fp and ra, so if another task runs before the
+ * call returns, every other register the calling convention
+ * leaves to the caller comes back changed, as it would across a
+ * function call.
+ */
+#define KERNEL_SYSCALL_CLOBBERS                                         \
+    "at", "v0", "v1", "a0", "a1", "a2", "a3",                           \
+    "t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7", "t8", "t9",         \
+    "hi", "lo", "memory"
+
+
+void disable_interrupts()
+{
+    __builtin_disable_interrupts();
+}
+
+
+void enable_interrupts()
+{
+    __builtin_enable_interrupts();
+}
+
+
+unsigned int save_and_disable_interrupts()
+{
+    // DI returns the previous Status register, in which IE is bit 0
+    return __builtin_disable_interrupts() & 0x1;
+}
+
+
+void restore_interrupts(unsigned int were_enabled)
+{
+    if(were_enabled)
+    {
+        __builtin_enable_interrupts();
+    }
+}
+
+
+/*
+ * Traps into the kernel with a yield system call so that the
+ * scheduler runs through the normal exception path.
+ */
+void request_reschedule()
+{
+    __asm__ volatile(
+        "li $v0, %0\n\t"
+        "syscall\n\t"
+        "nop"
+        :
+        : "i" (SYSCALL_CODE_YIELD)
+        : KERNEL_SYSCALL_CLOBBERS);
+}
+
+
+void kernel_semaphore_wait(struct SEMAPHORE *semaphore)
+{
+    __asm__ volatile(
+        "move $a0, %0\n\t"
+        "li $a1, %1\n\t"
+        "li $v0, %2\n\t"
+        "syscall\n\t"
+        "nop"
+        :
+        : "r" (semaphore), "i" (WAIT_FOREVER), "i" (SYSCALL_CODE_SEMAPHORE_WAIT)
+        : KERNEL_SYSCALL_CLOBBERS);
+}
+
 
 
 
@@ -9,6 +85,8 @@ void __ISR(24, IPL3SOFT) uart1_spi3_i2c3_shared_vector_ISR(void)
     int major = driver_table.isr_vector_to_major_minor[_UART_1_VECTOR] >> 3;
     int minor = driver_table.isr_vector_to_major_minor[_UART_1_VECTOR] & 0x7;
 
+    TRACE(TRACE_EVENT_ISR_ENTER, _UART_1_VECTOR);
+
     if(IFS0bits.U1EIF)
     {
         driver_table.driver_isrs[major].u.char_isr_callbacks.error(minor);
@@ -25,5 +103,6 @@ void __ISR(24, IPL3SOFT) uart1_spi3_i2c3_shared_vector_ISR(void)
         driver_table.driver_isrs[major].u.char_isr_callbacks.transmit(minor);
         IFS0bits.U1TXIF = 0;
     }
-    
+
+    TRACE(TRACE_EVENT_ISR_EXIT, _UART_1_VECTOR);
 }
\ No newline at end of file
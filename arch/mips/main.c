@@ -5,6 +5,7 @@
 
 
 #include "UART_HAL.h"
+#include "shadow_set.h"
 #include "UART_Driver.h"
 #include "NT7603_Driver.h"
 #include "line_discipline.h"
@@ -44,6 +45,9 @@
 uint32_t __attribute__((section(".config_BFC02FF8"))) __dev_config_1_BFC02FF8 = 0xffffdefb;
 uint32_t __attribute__((section(".config_BFC02FF4"))) __dev_config_2_BFC02FF4 = 0xfff8ffd9;
 
+// maps the shadow set priority to the shadow register set
+uint32_t __attribute__((section(".config_BFC02FF0"))) __dev_config_3_BFC02FF0 = DEVCFG3_VALUE;
+
 
 
 
@@ -51,6 +55,13 @@ static line_discipline_t discipline;
 static uint8_t received_byte;
 
 int process_next_byte(line_discipline_t *discipline, void *buffer, uint32_t size);
+unsigned int sleep_ticks(unsigned int ticks);
+
+// the display controller needs 40 ms after power-on before it takes instructions
+#define DISPLAY_POWER_ON_TICKS  40
+
+// ticks the root task sleeps at a time once it is done setting up
+#define ROOT_TASK_SLEEP_TICKS   1000
 
 
 static void handle_UART_receive(void *buf, uint32_t size)
@@ -84,7 +95,7 @@ void main(void)
 
     __builtin_disable_interrupts();
     IFS1bits.U2RXIF = 0;
-    IPC8bits.U2IP = 3;
+    IPC8bits.U2IP = SHADOW_SET_PRIORITY;
     IEC1bits.U2RXIE = 1;
 
 
@@ -104,7 +115,7 @@ void main(void)
 
     __builtin_enable_interrupts();
 
-    for(int i = 0; i < 50000; i++);
+    sleep_ticks(DISPLAY_POWER_ON_TICKS);
 
     NT7603_function_set(true, true, 1);
     NT7603_turn_display_on(true, false, true);
@@ -112,9 +123,16 @@ void main(void)
     NT7603_set_entry_mode(true, false);
 
     
+    /*
+     * Terminal input is delivered by the deferred work task, and
+     * with no preemption it only runs when this task blocks, so
+     * the loop sleeps rather than spins.
+     */
     char buf[32];
     while(1)
     {
+        sleep_ticks(ROOT_TASK_SLEEP_TICKS);
+
         //NT7603_clear_display();
         //snprintf(buf, sizeof(buf), "x: %d, y: %d", get_cursor_x(), get_cursor_y());
         //NT7603_write_string(buf);
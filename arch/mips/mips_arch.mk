@@ -46,7 +46,7 @@ MIPS_OBJS = $(patsubst %.c, $(BUILD_DIR)/%.o, $(MIPS_SOURCES))
 all: $(MIPS_OBJS)
 
 $(MIPS_OBJS): $(BUILD_DIR)/%.o: %.c
-	$(CC) $(INCLUDE_PATHS) $(CFLAGS) -c $< -o $@
+	$(CC) $(INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
 
 
 #all: mips.a boot.a
@@ -59,7 +59,7 @@ $(MIPS_OBJS): $(BUILD_DIR)/%.o: %.c
 
 
 #$(ASM_OBJS): $(OBJ_DIR)/%.o: %.S
-#	$(CC) $(ASM_FLAGS) -c $< -o $@
+#	$(CC) $(INCLUDE_PATHS) $(CONFIG_FLAGS) $(ASM_FLAGS) -c $< -o $@
 
 #$(BOOT_OBJS): $(OBJ_DIR)/%.o: $(BOOT_DIR)/%.S
 #	$(CC) $(BOOT_FLAGS) -c $< -o $@
@@ -1,6 +1,9 @@
 #include "UART_Driver.h"
 #include "UART_HAL.h"
+#include "shadow_set.h"
 #include "NT7603_Driver.h"
+#include "deferred_work.h"
+#include "trace.h"
 
 #include <stdbool.h>
 #include <stddef.h>
@@ -126,7 +129,26 @@ typedef struct
 
 
 
-//ring_buffer_t uart_receive_buffers[NUM_UART_DEVS];
+/**
+ * Bytes received by the receive interrupts and not yet handed
+ * to the callback. The interrupt only moves write_ptr and the
+ * deferred work only moves read_ptr.
+ */
+static volatile ring_buffer_t uart_receive_buffers[NUM_UART_DEVS];
+
+/**
+ * Whether a deferred delivery of received bytes is posted and
+ * has not started yet, so that each burst posts only one.
+ */
+static volatile bool receive_work_pending[NUM_UART_DEVS];
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+extern deferred_work_queue_t deferred_work_queue;
+extern unsigned int need_resched;
 
 
 /**
@@ -807,6 +829,10 @@ void UART_initialize_driver()
         callback_table[i].receive_buffer = NULL;
         callback_table[i].is_enabled = false;
         callback_table[i].is_repeated = false;
+
+        uart_receive_buffers[i].read_ptr = 0;
+        uart_receive_buffers[i].write_ptr = 0;
+        receive_work_pending[i] = false;
     }
     
     UART_enable(UART2);
@@ -818,33 +844,80 @@ void UART_initialize_driver()
 
 
 
+/**
+ * Runs in the deferred work task rather than in the interrupt.
+ * Copies the bytes the receive interrupt left in the ring buffer
+ * into the registered receive buffer, and invokes the callback
+ * each time bytes_to_trigger of them are in it. Bytes received
+ * while no callback is enabled are discarded.
+ */
+static void UART_deliver_received_bytes(void *unused, uint32_t device_number)
+{
+    uart_callback_table_entry_t *entry = &callback_table[device_number-1];
+    volatile ring_buffer_t *ring = &uart_receive_buffers[device_number-1];
+    uint8_t *receive_buffer = (uint8_t*) entry->receive_buffer;
+
+    // cleared first, so that bytes received from here on post the delivery again
+    receive_work_pending[device_number-1] = false;
+
+    while(NUM_BYTES(ring) > 0)
+    {
+        if(entry->is_enabled && entry->callback_function && receive_buffer)
+        {
+            receive_buffer[entry->current_bytes] = ring->data[READ_INDEX(ring)];
+            entry->current_bytes++;
+        }
+
+        ring->read_ptr++;
+
+        if(entry->current_bytes > 0 && entry->current_bytes >= entry->bytes_to_trigger)
+        {
+            entry->callback_function(entry->receive_buffer, entry->current_bytes);
+            entry->current_bytes = 0;
+        }
+    }
+}
+
+
+
 /**********************************
  * ISR definitions for UART Driver
  **********************************/
 
 void UART_2_handle_receive(void)
 {
-    uint8_t received_byte, bytes_received = 0;
-    uint8_t *receive_buffer = (uint8_t*) callback_table[UART2_TABLE_INDEX].receive_buffer;
-    uint8_t current_index = callback_table[UART2_TABLE_INDEX].current_bytes;
+    volatile ring_buffer_t *ring = &uart_receive_buffers[UART2_TABLE_INDEX];
+    uint8_t received_byte;
     
+    // only empty the FIFO here, and leave the callback to the deferred work task
     while(UART_RX_BUFFER_HAS_DATA(UART2))
     {
         UART_READ_FROM_RX_FIFO(UART2, received_byte);
-        receive_buffer[current_index] = received_byte;
-        current_index++;
-        bytes_received++;
-        callback_table[UART2_TABLE_INDEX].current_bytes++;
-        
-        
-        if(bytes_received >= callback_table[UART2_TABLE_INDEX].bytes_to_trigger && 
-            callback_table[UART2_TABLE_INDEX].is_enabled && callback_table[UART2_TABLE_INDEX].callback_function)
+
+        // a full ring drops the byte, the same as an overrun of the FIFO would
+        if(NUM_BYTES(ring) < UART_RECEIVE_BUFFER_SIZE)
         {
-            callback_table[UART2_TABLE_INDEX].callback_function(
-                            callback_table[UART2_TABLE_INDEX].receive_buffer,
-                            callback_table[UART2_TABLE_INDEX].current_bytes);
-            
-            callback_table[UART2_TABLE_INDEX].current_bytes = 0;
+            ring->data[WRITE_INDEX(ring)] = received_byte;
+            ring->write_ptr++;
+        }
+    }
+
+    if(!receive_work_pending[UART2_TABLE_INDEX] && NUM_BYTES(ring) > 0)
+    {
+        int result;
+
+        receive_work_pending[UART2_TABLE_INDEX] = true;
+        result = defer_work(&task_table, &deferred_work_queue, UART_deliver_received_bytes, NULL, UART2);
+
+        // if the queue is full, the next receive interrupt tries again
+        if(result < 0)
+        {
+            receive_work_pending[UART2_TABLE_INDEX] = false;
+        }
+        // the worker outranks the interrupted task, so it runs at the next scheduling point
+        else if(result > 0)
+        {
+            need_resched = 1;
         }
     }
 
@@ -882,8 +955,10 @@ void UART_2_handle_error(void)
 
 
 
-void __ISR(_UART_2_VECTOR, IPL5SOFT) UART_2_general_ISR(void)
+void __ISR(_UART_2_VECTOR, SHADOW_SET_IPL) UART_2_general_ISR(void)
 {
+    TRACE(TRACE_EVENT_ISR_ENTER, _UART_2_VECTOR);
+
     if(IFS1bits.U2RXIF == 1)
     {
         UART_2_handle_receive();
@@ -896,5 +971,7 @@ void __ISR(_UART_2_VECTOR, IPL5SOFT) UART_2_general_ISR(void)
     {
         UART_2_handle_error();
     }
+
+    TRACE(TRACE_EVENT_ISR_EXIT, _UART_2_VECTOR);
 }
 
@@ -17,7 +17,7 @@ DRIVER_OBJS = $(patsubst %.c, $(OBJ_DIR)/%.o, $(DRIVER_SOURCES))
 all: setup $(DRIVER_OBJS)
 
 $(DRIVER_OBJS): $(OBJ_DIR)/%.o: %.c
-	$(CC) $(INCLUDE_PATHS) $(CFLAGS) -c $< -o $@
+	$(CC) $(INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
 
 
 setup:
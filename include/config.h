@@ -0,0 +1,119 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+/*
+ * Compile time configuration of the kernel's tables. The build
+ * generates build/kernel_config.h from kernel.cfg and includes it
+ * ahead of every source file, so the values set there take the
+ * place of the defaults below. Builds that do not go through
+ * kernel.cfg, such as the unit tests, get the defaults.
+ *
+ * Every table and bitmap is sized from these at compile time, so
+ * the bitmap arithmetic folds into constants.
+ */
+
+
+// filesystem
+#ifndef CONFIG_RAMDISK_SIZE
+#define CONFIG_RAMDISK_SIZE             16384
+#endif
+
+#ifndef CONFIG_FILESYSTEM_BLOCK_SIZE
+#define CONFIG_FILESYSTEM_BLOCK_SIZE    64
+#endif
+
+#ifndef CONFIG_NUM_INODES
+#define CONFIG_NUM_INODES               64
+#endif
+
+#ifndef CONFIG_MAX_OPEN_FILES
+#define CONFIG_MAX_OPEN_FILES           64
+#endif
+
+#ifndef CONFIG_MAX_PIPES
+#define CONFIG_MAX_PIPES                8
+#endif
+
+
+// kernel heap, in blocks of each size class
+#ifndef CONFIG_KERNEL_HEAP_SIZE
+#define CONFIG_KERNEL_HEAP_SIZE         8192
+#endif
+
+#ifndef CONFIG_HEAP_32B_BLOCKS
+#define CONFIG_HEAP_32B_BLOCKS          32
+#endif
+
+#ifndef CONFIG_HEAP_128B_BLOCKS
+#define CONFIG_HEAP_128B_BLOCKS         24
+#endif
+
+#ifndef CONFIG_HEAP_512B_BLOCKS
+#define CONFIG_HEAP_512B_BLOCKS         8
+#endif
+
+
+// tasks and timers
+#ifndef CONFIG_MAX_TASKS
+#define CONFIG_MAX_TASKS                32
+#endif
+
+#ifndef CONFIG_MAX_TIMERS
+#define CONFIG_MAX_TIMERS               256
+#endif
+
+
+// event trace, recorded only when CONFIG_TRACE is defined
+#ifndef CONFIG_TRACE_BUFFER_SIZE
+#define CONFIG_TRACE_BUFFER_SIZE        256
+#endif
+
+
+// system call statistics, kept only when CONFIG_SYSCALL_STATS is defined
+#if defined(CONFIG_SYSCALL_STRACE) && !defined(CONFIG_SYSCALL_STATS)
+#define CONFIG_SYSCALL_STATS            1
+#endif
+
+#ifndef CONFIG_STRACE_BUFFER_SIZE
+#define CONFIG_STRACE_BUFFER_SIZE       32
+#endif
+
+
+
+/*
+ * Limits set by the width of the bitmaps that track each table.
+ */
+#if CONFIG_MAX_TASKS > 32
+#error "CONFIG_MAX_TASKS must fit in the 32-bit task bitmaps"
+#endif
+
+#if CONFIG_MAX_PIPES > 32
+#error "CONFIG_MAX_PIPES must fit in the 32-bit pipe bitmap"
+#endif
+
+#if (CONFIG_NUM_INODES % 8) || (CONFIG_MAX_OPEN_FILES % 8) || (CONFIG_MAX_TIMERS % 8)
+#error "CONFIG_NUM_INODES, CONFIG_MAX_OPEN_FILES and CONFIG_MAX_TIMERS must be multiples of 8"
+#endif
+
+#if (CONFIG_RAMDISK_SIZE % (CONFIG_FILESYSTEM_BLOCK_SIZE*8))
+#error "CONFIG_RAMDISK_SIZE must be a whole number of bytes of the block bitmap"
+#endif
+
+#if CONFIG_HEAP_32B_BLOCKS > 32 || CONFIG_HEAP_128B_BLOCKS > 32 || CONFIG_HEAP_512B_BLOCKS > 32
+#error "each kernel heap size class must fit in a 32-bit bitmap"
+#endif
+
+#if 32*CONFIG_HEAP_32B_BLOCKS + 128*CONFIG_HEAP_128B_BLOCKS + 512*CONFIG_HEAP_512B_BLOCKS > CONFIG_KERNEL_HEAP_SIZE
+#error "the kernel heap size classes do not fit in CONFIG_KERNEL_HEAP_SIZE"
+#endif
+
+#if CONFIG_TRACE_BUFFER_SIZE & (CONFIG_TRACE_BUFFER_SIZE - 1)
+#error "CONFIG_TRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+#if CONFIG_STRACE_BUFFER_SIZE & (CONFIG_STRACE_BUFFER_SIZE - 1)
+#error "CONFIG_STRACE_BUFFER_SIZE must be a power of two"
+#endif
+
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef DEFERRED_WORK_H
+#define DEFERRED_WORK_H
+
+
+#include "task.h"
+#include "semaphore.h"
+
+
+/*
+ * Deferred work, for interrupt handlers that have more to do
+ * than fits in an interrupt. The handler does only what cannot
+ * wait, such as emptying a hardware FIFO, and posts the rest as
+ * a work item: a function with a pointer and a word to pass it.
+ * A kernel worker task at the highest priority runs the items
+ * in the order they were posted, with interrupts enabled.
+ *
+ * Posting takes a few stores with interrupts disabled, and wakes
+ * the worker only when the queue goes from empty to not empty.
+ * Like a semaphore post, it never switches tasks itself, so the
+ * worker runs at the next scheduling point. The queue keeps the
+ * longest time an item waited to be run, which bounds how late
+ * deferred work can be.
+ */
+
+
+// must be a power of two
+#define DEFERRED_WORK_QUEUE_SIZE    32
+
+#define DEFERRED_WORK_PRIORITY      0
+
+#ifndef DEFERRED_WORK_STACK_SIZE
+#define DEFERRED_WORK_STACK_SIZE    DEFAULT_STACK_SIZE
+#endif
+
+#define ERROR_DEFERRED_WORK_FULL    -16
+
+
+typedef void (*deferred_work_function_t)(void *data, uint32_t value);
+
+
+typedef struct DEFERRED_WORK
+{
+    deferred_work_function_t function;
+    void *data;
+    uint32_t value;
+
+    // read_cycle_counter when the item was posted
+    unsigned int post_timestamp;
+
+} deferred_work_t;
+
+
+typedef struct DEFERRED_WORK_QUEUE
+{
+    deferred_work_t items[DEFERRED_WORK_QUEUE_SIZE];
+
+    /*
+     * Free-running counts of items taken and posted. Only the
+     * worker moves head, and posting moves tail with interrupts
+     * disabled.
+     */
+    unsigned int head;
+    unsigned int tail;
+
+    // posted to when the queue stops being empty
+    semaphore_t pending;
+
+    // items run and items lost to a full queue
+    unsigned int completed;
+    unsigned int dropped;
+
+    // cycles between posting an item and starting to run it
+    unsigned int max_latency;
+    unsigned int total_latency;
+
+    // task that runs the items, or TASK_ID_NONE before it is created
+    taskid_t worker;
+
+} deferred_work_queue_t;
+
+
+void deferred_work_queue_init(deferred_work_queue_t *queue);
+
+/*
+ * Sets up the kernel's queue and creates the worker task as a
+ * child of the root task. Returns the worker's task ID or the
+ * error from create_task.
+ */
+taskid_t init_deferred_work(task_table_t *table);
+
+/*
+ * Posts a work item that runs function(data, value) in the
+ * worker. Safe to call from an interrupt handler, or with
+ * interrupts disabled. Returns 1 if the worker was woken and
+ * should preempt the current task, 0 otherwise, or
+ * ERROR_DEFERRED_WORK_FULL if the item was dropped.
+ */
+int defer_work(task_table_t *table, deferred_work_queue_t *queue, deferred_work_function_t function, void *data, uint32_t value);
+
+/*
+ * Runs every item in the queue, including any posted while it
+ * runs, and returns how many it ran.
+ */
+unsigned int run_deferred_work(deferred_work_queue_t *queue);
+
+/*
+ * Entry point of the worker task. Runs the kernel's queue and
+ * blocks until more work is posted. Never returns.
+ */
+void deferred_work_task();
+
+
+#endif
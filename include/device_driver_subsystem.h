@@ -2,6 +2,9 @@
 #define DEVICE_DRIVER_SUBSYSTEM_H
 
 
+#include "kdefs.h"
+
+
 #define DRIVER_TYPE_UART             0
 #define DRIVER_TYPE_SPI              1
 #define DRIVER_TYPE_I2C              2
@@ -20,21 +23,8 @@
 
 
 
-char *dev_file_names[] = {
-    [DRIVER_TYPE_UART] = "uart",
-    [DRIVER_TYPE_SPI] = "spi",
-    [DRIVER_TYPE_I2C] = "i2c",
-    [DRIVER_TYPE_CAN] = "can",
-    [DRIVER_TYPE_TIMER] = "timer",
-    [DRIVER_TYPE_ADC] = "adc",
-    [DRIVER_TYPE_PWM] = "pwm",
-    [DRIVER_TYPE_DAC] = "dac",
-    [DRIVER_TYPE_HDD] = "hdd",
-    [DRIVER_TYPE_SSD] = "ssd",
-    [DRIVER_TYPE_ETHERNET] "eth",
-    [DRIVER_TYPE_WIFI] = "wifi",
-    [DRIVER_TYPE_BLUETOOTH] = "bluetooth"
-};
+// names of the device files for each driver type, defined in device_driver_subsystem.c
+extern char *dev_file_names[];
 
 
 
@@ -82,6 +72,28 @@ typedef struct UART_OPTIONS
 } uart_options_t;
 
 
+// TODO: fill in the options for the remaining driver types
+typedef struct SPI_OPTIONS
+{
+    unsigned int clock_rate;
+
+} spi_options_t;
+
+
+typedef struct I2C_OPTIONS
+{
+    unsigned int clock_rate;
+
+} i2c_options_t;
+
+
+typedef struct CAN_OPTIONS
+{
+    unsigned int bit_rate;
+
+} can_options_t;
+
+
 typedef struct DRIVER_OPTIONS
 {
     unsigned short driver_type;
@@ -98,24 +110,6 @@ typedef struct DRIVER_OPTIONS
 } driver_options_t;
 
 
-typedef struct DRIVER
-{
-    int file_type;
-    int driver_type;
-    union 
-    {
-        char_driver_t chardev;
-        block_driver_t blockdev;
-        net_driver_t netdev;
-        timer_driver_t timerdev;
-        gpio_driver_t gpiodev;
-        adc_driver_t adcdev;
-        pwm_driver_t pwmdev;
-    } u;
-    
-} driver_t;
-
-
 
 typedef struct CHARDEV
 {
@@ -125,7 +119,8 @@ typedef struct CHARDEV
      * device whenever the user invokes the
      * open syscall on that device's file.
      */
-    int (*open)(int, driver_options_t*);
+    // pass in the device number
+    int (*open)(int);
 
 
     /*
@@ -252,6 +247,25 @@ typedef struct PWMDEV
 
 
 
+typedef struct DRIVER
+{
+    int file_type;
+    int driver_type;
+    union 
+    {
+        char_driver_t chardev;
+        block_driver_t blockdev;
+        net_driver_t netdev;
+        timer_driver_t timerdev;
+        gpio_driver_t gpiodev;
+        adc_driver_t adcdev;
+        pwm_driver_t pwmdev;
+    } u;
+    
+} driver_t;
+
+
+
 /*
  * Callback functions for Interrupt Service
  * Routines (ISRs) for various types of device
@@ -262,9 +276,9 @@ typedef struct CHAR_ISR
 {
     void (*error)(int device_number);
     void (*receive)(int device_number);
-    void (transmit)(int device_number);
+    void (*transmit)(int device_number);
 
-} char_isr_callbacks_t
+} char_isr_callbacks_t;
 
 typedef struct DRIVER_ISRS
 {
@@ -344,14 +358,14 @@ typedef struct DRIVER_TABLE
     int byte_index = _driver_number/8;                          \
     unsigned char bit_index = _driver_number%8;                 \
     unsigned char mask = 0x1 << bit_index;                      \
-    (_driver_table)->drivers[byte_index] |= mask;
+    (_driver_table)->drivers_bitmap[byte_index] |= mask;
 
 
 #define SET_DRIVER_FREE(_driver_table, _driver_number)          \
     int byte_index = _driver_number/8;                          \
     unsigned char bit_index = _driver_number%8;                 \
     unsigned char mask = ~(0x1 << bit_index);                   \
-    (_driver_table)->drivers[byte_index] &= mask;
+    (_driver_table)->drivers_bitmap[byte_index] &= mask;
 
 
 
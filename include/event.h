@@ -0,0 +1,91 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+
+#include "task.h"
+
+
+/*
+ * Event flag groups. A group holds 32 flags that are set and
+ * cleared independently, and a task waits for any or all of a
+ * set of them. Like semaphores, groups live in the memory of the
+ * tasks that share them and are only changed by the kernel.
+ *
+ * Setting flags walks the waiters in priority order and wakes
+ * every one whose wait is now satisfied, so when a waiter clears
+ * the flags it woke for, the flags go to the highest priority
+ * waiter first. Setting flags never switches tasks itself, so
+ * interrupt handlers call event_flags_set directly.
+ */
+
+
+#define ERROR_EVENT_INVALID_MASK    -12
+
+// wake when any of the flags in the mask are set
+#define EVENT_WAIT_ANY      0x0
+
+// wake only when all of the flags in the mask are set
+#define EVENT_WAIT_ALL      0x1
+
+// clear the flags that satisfied the wait before returning
+#define EVENT_CLEAR         0x2
+
+
+/*
+ * Must match the layout of event_flags_t in the API. Tasks do
+ * not touch any of it.
+ */
+typedef struct EVENT_FLAGS
+{
+    uint32_t flags;
+    wait_queue_t waiters;
+
+} event_flags_t;
+
+
+#define EVENT_FLAGS_INITIALIZER     { 0, { NULL_POINTER, NULL_POINTER } }
+
+
+/*
+ * What a task waits for, passed in by the caller. Kept by the
+ * kernel while the task waits, and the flags from the mask that
+ * were set when the wait was satisfied are stored in flags. Must
+ * match the layout of event_wait_t in the API.
+ */
+typedef struct EVENT_WAIT
+{
+    uint32_t mask;
+    unsigned int options;
+    unsigned int timeout;
+    uint32_t flags;
+
+} event_wait_t;
+
+
+void event_flags_init(event_flags_t *group);
+
+/*
+ * Waits on behalf of task for the flags in wait->mask, as set out
+ * by wait->options. If the wait is already satisfied, returns 0
+ * at once. Otherwise task blocks in priority order for up to
+ * wait->timeout ticks (see set_task_timeout), and the caller
+ * reschedules; task runs again with 0 as its return value once
+ * the flags are set, or with ERROR_TIMED_OUT. Returns
+ * ERROR_TIMED_OUT at once if the timeout is WAIT_POLL, or
+ * ERROR_EVENT_INVALID_MASK if the mask is empty.
+ */
+int event_flags_wait(task_table_t *table, task_control_block_t *task, event_flags_t *group, event_wait_t *wait, unsigned int now);
+
+/*
+ * Sets the flags and wakes every waiter they satisfy. Returns 1
+ * if a woken task should preempt the current task, in which case
+ * a syscall caller reschedules, or 0. Safe to call from an
+ * interrupt handler.
+ */
+int event_flags_set(task_table_t *table, event_flags_t *group, uint32_t flags);
+
+// clears the flags, and never wakes anything
+void event_flags_clear(event_flags_t *group, uint32_t flags);
+
+
+#endif
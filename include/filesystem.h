@@ -5,6 +5,8 @@
 #define FILESYSTEM_H
 
 
+#include "config.h"
+
 
 #define FILE_PATH_TOO_LONG_ERROR    -1
 #define FILE_NOT_FOUND_ERROR        -2
@@ -20,7 +22,7 @@
 //  size of block list in inode
 #define INODE_BLOCK_LIST_SIZE 8
 
-#define MAX_OPEN_FILES 64
+#define MAX_OPEN_FILES CONFIG_MAX_OPEN_FILES
 #define OPEN_FILE_TABLE_FULL -1
 
 #define SUPERBLOCK_NUMBER 0
@@ -45,11 +47,11 @@
 #define MINOR_NUMBER_BITS 3
 
 
-// will make fully configurable later
-#define BLOCK_SIZE 64
-#define RAMDISK_SIZE 16384
+// set in kernel.cfg, see config.h
+#define BLOCK_SIZE CONFIG_FILESYSTEM_BLOCK_SIZE
+#define RAMDISK_SIZE CONFIG_RAMDISK_SIZE
 
-#define NUM_INODES 64
+#define NUM_INODES CONFIG_NUM_INODES
 #define INODE_TABLE_BLOCK_NUMBER 1      // starts at second block
 
 /*
@@ -64,6 +66,7 @@
 #define FILE_TYPE_GPIO              6
 #define FILE_TYPE_ADC               7
 #define FILE_TYPE_PWM               8
+#define FILE_TYPE_PIPE              9
 #define FILE_TYPE_NONE              255
 
 
@@ -147,6 +150,14 @@ typedef struct INODE
 #define GET_DRIVER_TYPE(_inode) ( (inode)->major_and_minor >> MINOR_NUMBER_BITS)
 #define GET_DEVICE_NUMBER(_inode) ( (inode)->major_and_minor & MINOR_NUMBER_MASK)
 
+/*
+ * Pipe inodes use the same field for the index of the pipe in
+ * the pipe table and which end of it the inode is for.
+ */
+#define PIPE_MAJOR_AND_MINOR(_pipe_index, _end)     (((_pipe_index) << 1) | (_end))
+#define GET_PIPE_INDEX(_inode)  ( (_inode)->major_and_minor >> 1)
+#define GET_PIPE_END(_inode)    ( (_inode)->major_and_minor & 0x1)
+
 
 
  
@@ -209,12 +220,36 @@ void init_filesystem();
 void add_directory_entry(superblock_t *superblock, inode_number_t directory_inode, dir_entry_t *entry);
 
 int open_file(superblock_t *superblock, inode_number_t current_dir, open_file_table_t *open_file_table, char *path);
+
+/*
+ * Returns 1 if closing the end of a pipe woke a task that should
+ * preempt the current task, in which case a syscall caller
+ * reschedules, and 0 otherwise.
+ */
 int close_file(superblock_t *superblock, open_file_table_t *open_file_table, int file_descriptor);
 
 int read_file(inode_t *inode, void *buffer, unsigned short offset, unsigned short size);
 int write_file(superblock_t *superblock, inode_t *inode, void *buffer, unsigned short offset, unsigned short size);
 
+/*
+ * Reads or writes the pipe end an inode of type FILE_TYPE_PIPE
+ * is for, on behalf of the current task, as read_file and
+ * write_file do for one. Fails with ERROR_PIPE_WRONG_END if the
+ * inode is for the other end. Sets preempt as pipe_read and
+ * pipe_write do, for callers that reschedule.
+ */
+int read_pipe_file(inode_t *inode, void *buffer, unsigned short size, int *preempt);
+int write_pipe_file(inode_t *inode, void *buffer, unsigned short size, int *preempt);
+
 int create_file(superblock_t *superblock, inode_number_t current_dir, int type, char *file_path, short major, short minor);
+
+/*
+ * Creates a pipe and opens its read end in file_descriptors[0]
+ * and its write end in file_descriptors[1]. Each end gets an
+ * inode with no directory entry and no blocks, which is freed
+ * when the end is closed. Returns 0 or a negative error code.
+ */
+int create_pipe(superblock_t *superblock, open_file_table_t *open_file_table, int *file_descriptors);
 int delete_file(superblock_t *superblock, inode_number_t current_dir, open_file_table_t *open_file_table, char *file_path);
 
 void create_root();
@@ -17,4 +17,84 @@ int get_peripheral_bus_frequency();
 int get_usb_clock_frequency();
 
 
+void disable_interrupts();
+void enable_interrupts();
+
+/*
+ * Disables interrupts and returns whether they were enabled, for
+ * code that may already run with interrupts disabled, such as an
+ * interrupt handler. restore_interrupts re-enables them only if
+ * they were enabled before.
+ */
+unsigned int save_and_disable_interrupts();
+void restore_interrupts(unsigned int were_enabled);
+
+
+/*
+ * Tick timer interface. The tick timer normally interrupts
+ * once per tick and calls timer_tick from its handler. The
+ * idle task may instead program it to interrupt several
+ * ticks in the future so that the processor is not woken
+ * on ticks where nothing happens.
+ */
+
+/*
+ * Programs the tick timer to interrupt the given number of
+ * ticks after the last tick that was counted. If that time
+ * has already passed, the interrupt occurs as soon as possible.
+ */
+void set_tick_wakeup(unsigned int ticks);
+
+/*
+ * Counts any whole ticks that have elapsed since the last
+ * tick was counted and passes them to timer_tick. Used when
+ * the processor is woken by some other interrupt.
+ */
+void update_tick_count();
+
+/*
+ * Enables interrupts and puts the processor into its low
+ * power state until the next interrupt occurs.
+ */
+void wait_for_interrupt();
+
+/*
+ * Asks the kernel to pick a new task to run. Used by the
+ * idle task to hand the CPU to a task that has become ready.
+ */
+void request_reschedule();
+
+/*
+ * Blocks the calling task on a semaphore through the semaphore
+ * wait system call, for kernel tasks that have to wait for work
+ * the way request_reschedule yields.
+ */
+struct SEMAPHORE;
+void kernel_semaphore_wait(struct SEMAPHORE *semaphore);
+
+
+
+/*
+ * Free-running counter used to time task execution. On MIPS
+ * it is the core timer Count register, and reading it is a
+ * single instruction, so the scheduler can sample it on every
+ * switch.
+ */
+#ifdef __mips__
+static inline unsigned int read_cycle_counter()
+{
+    unsigned int count;
+
+    __asm__ volatile("mfc0 %0, $9" : "=r" (count));
+
+    return count;
+}
+#else
+unsigned int read_cycle_counter();
+#endif
+
+// rate read_cycle_counter counts at, in Hz
+unsigned int get_cycle_counter_frequency();
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,63 @@
+#ifndef IDLE_H
+#define IDLE_H
+
+
+#include "task.h"
+
+
+/*
+ * Longest time the idle task will sleep when no timers
+ * are pending. Keeps the core timer compare well inside
+ * the range of the 32-bit Count register.
+ */
+#define IDLE_MAX_SLEEP_TICKS    1000
+
+/*
+ * Size of the idle task stack, which only needs room for ISR
+ * frames, unless it also formats strace records.
+ */
+#ifndef IDLE_STACK_WORDS
+#ifdef CONFIG_SYSCALL_STRACE
+#define IDLE_STACK_WORDS        512
+#else
+#define IDLE_STACK_WORDS        128
+#endif
+#endif
+
+
+/*
+ * Sets up the idle task control block in the task table.
+ * The idle task is not stored in the task array and has no
+ * task ID. The scheduler runs it whenever no other task is
+ * ready.
+ */
+void init_idle_task(task_table_t *table);
+
+
+/*
+ * Entry point of the idle task. Never returns.
+ */
+void idle_task_loop();
+
+
+/*
+ * A single pass of the idle loop. If a task has become
+ * ready, hands the CPU over to it. Otherwise sleeps until
+ * the earliest pending timer or another interrupt.
+ */
+void idle_task_iteration();
+
+
+/*
+ * Returns how many ticks the idle task may sleep from the
+ * given tick until it has to wake for a timer, a real-time
+ * job release or a sleeping task.
+ */
+unsigned int get_idle_sleep_ticks(unsigned int now);
+
+
+// number of ticks that have been spent in the idle task
+unsigned int get_idle_ticks();
+
+
+#endif
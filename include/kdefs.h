@@ -9,16 +9,35 @@
 #define KDEFS_H
 
 
+#include "config.h"
+
+
 // number of registers on a MIPS chip
 #define NUM_REGS 32
 
-// Defines the maximum number of children that a given task can have.
-// Must be less than the number of total tasks
-#define MAX_CHILDREN 32
-
 // Defines maximum number of tasks allowed on the system. Used to prevent
-// system overload
-#define MAX_TASKS 32
+// system overload. Set by CONFIG_MAX_TASKS in kernel.cfg
+#define MAX_TASKS CONFIG_MAX_TASKS
+
+// Defines the number of task priority levels. Priority 0 is the highest
+// priority. Must not exceed the number of bits in the ready bitmap (32)
+#define NUM_PRIORITIES 32
+
+// Priority given to the root task
+#define DEFAULT_TASK_PRIORITY 16
+
+// Stack sizes in bytes. The main stack is used by the root task,
+// and tasks that do not ask for a stack size get the default size.
+// Ports whose ABI needs bigger frames may override these
+#ifndef MAIN_STACK_SIZE
+#define MAIN_STACK_SIZE 2048
+#endif
+#ifndef DEFAULT_STACK_SIZE
+#define DEFAULT_STACK_SIZE 1024
+#endif
+#ifndef MIN_STACK_SIZE
+#define MIN_STACK_SIZE 256
+#endif
 
 
 // TODO: make configurable
@@ -32,6 +51,9 @@
 
 // define register offsets into register array
 
+// register 0 is a constant, so its slot holds the frame type instead
+#define REGISTER_FRAME       0
+
 #define REGISTER_AT          1
 
 #define REGISTER_V0          2
@@ -77,6 +99,7 @@
 // useful for assembly language files that need to access offset of
 // particular registers
 
+#define FRAME_BYTE_OFFSET       0
 #define AT_BYTE_OFFSET          4
 #define V0_BYTE_OFFSET          8
 #define V1_BYTE_OFFSET          12
@@ -110,4 +133,15 @@
 #define RA_BYTE_OFFSET          124
 #define PC_BYTE_OFFSET          128
 
+
+// Frame types, stored in the REGISTER_FRAME slot of a task's register
+// array. A full frame holds every register and is saved when a task is
+// interrupted. A voluntary frame is saved when a task enters the kernel
+// through a system call, and only holds the registers a function call
+// must preserve, plus v0 for the return value and the resume PC. The
+// restore path checks the frame type to know which registers to reload.
+// FRAME_TYPE_FULL must be 0 so that zeroed register arrays are full frames
+#define FRAME_TYPE_FULL         0
+#define FRAME_TYPE_VOLUNTARY    1
+
 #endif
\ No newline at end of file
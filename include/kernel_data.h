@@ -0,0 +1,118 @@
+#ifndef KERNEL_DATA_H
+#define KERNEL_DATA_H
+
+
+#include <stdint.h>
+
+#include "task.h"
+
+
+/*
+ * Kernel data page. A small block at the bottom of user data RAM
+ * (see docs/memory_organization.md) that the kernel keeps up to
+ * date and tasks read with plain loads, so reading the clock or
+ * asking which task is running does not need a system call.
+ *
+ * The kernel rewrites it after every scheduling decision and on
+ * every tick interrupt, both of which run with interrupts masked,
+ * so updates never nest. Each update makes sequence odd, changes
+ * the fields, then makes it even again. A reader copies the page
+ * and retries if sequence was odd or changed meanwhile, which
+ * only happens if the task was switched out or interrupted in the
+ * middle of the copy.
+ *
+ * time_base is a 64-bit count of cycle counter counts since boot
+ * as of the cycle counter reading time_base_count. Adding the
+ * counts since time_base_count gives the current time at the
+ * counter's resolution, and since ticks never stop for longer
+ * than IDLE_MAX_SLEEP_TICKS, the 32-bit difference never wraps.
+ *
+ * The PIC32 bus matrix cannot make part of the user data
+ * partition read-only, so nothing stops a task writing the page.
+ * Only the task itself would see the damage, until the next
+ * update rewrites every field.
+ */
+
+
+#define KERNEL_DATA_VERSION         1
+
+// current_task_id while the idle task runs, as it has no task ID
+#define KERNEL_DATA_IDLE_TASK       -1
+
+#ifdef __mips__
+#define KERNEL_DATA_PAGE_SECTION    __attribute__((section(".kernel_data_page")))
+#else
+#define KERNEL_DATA_PAGE_SECTION
+#endif
+
+// keeps the compiler from moving page accesses across the sequence count
+#define KERNEL_DATA_BARRIER()       __asm__ volatile("" ::: "memory")
+
+
+/*
+ * Layout shared with api/include/kernel_data.h. New fields go at
+ * the end, with KERNEL_DATA_VERSION bumped.
+ */
+typedef struct KERNEL_DATA_PAGE
+{
+    // odd while the kernel is updating the page
+    uint32_t sequence;
+    uint32_t version;
+
+    // rate of the cycle counter in Hz, and of system ticks
+    uint32_t counter_frequency;
+    uint32_t tick_rate;
+
+    uint64_t time_base;
+    uint32_t time_base_count;
+
+    // system ticks since boot
+    uint32_t ticks;
+
+    int32_t current_task_id;
+
+    // times a different task was switched onto the CPU
+    uint32_t num_switches;
+
+    // time spent in the idle task up to its last switch out, in cycle counter counts
+    uint64_t idle_cycles;
+
+} kernel_data_page_t;
+
+
+
+// clears the page and starts the time base at the current cycle count
+void kernel_data_init(kernel_data_page_t *page);
+
+/*
+ * Brings the page up to date with the time, the tick count and
+ * the current task. Must be called with interrupts masked.
+ */
+void update_kernel_data_page(kernel_data_page_t *page, task_table_t *table, unsigned int ticks);
+
+// update_kernel_data_page for the kernel's own page, for assembly and the tick handlers
+void update_kernel_data();
+
+
+/*
+ * Copies a consistent snapshot of the page, the way the API
+ * does from user mode.
+ */
+static inline void read_kernel_data(kernel_data_page_t *page, kernel_data_page_t *snapshot)
+{
+    uint32_t sequence;
+
+    do
+    {
+        sequence = page->sequence;
+        KERNEL_DATA_BARRIER();
+
+        *snapshot = *page;
+
+        KERNEL_DATA_BARRIER();
+    }
+    while((sequence & 1) || page->sequence != sequence);
+}
+
+
+#endif
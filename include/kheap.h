@@ -3,15 +3,21 @@
 #define KHEAP_H
 
 
+#include "config.h"
+
+
 /*
- * At some point in the future, I think
- * this should be changed to be more
- * configurable.
+ * The heap is split into blocks of three sizes. The number of
+ * blocks of each size is set in kernel.cfg, see config.h.
  */
 
-#define BLOCKSIZE_32_BYTES 32       // 32
-#define BLOCKSIZE_128_BYTES 128     // 24
-#define BLOCKSIZE_512_BYTES 512     // 8
+#define BLOCKSIZE_32_BYTES 32
+#define BLOCKSIZE_128_BYTES 128
+#define BLOCKSIZE_512_BYTES 512
+
+#define NUM_32B_BLOCKS  CONFIG_HEAP_32B_BLOCKS
+#define NUM_128B_BLOCKS CONFIG_HEAP_128B_BLOCKS
+#define NUM_512B_BLOCKS CONFIG_HEAP_512B_BLOCKS
 
 
 typedef struct HEAP_CONTROL_BLOCK
@@ -26,7 +32,7 @@ typedef struct HEAP_CONTROL_BLOCK
      */
     unsigned int in_use_32B;
     unsigned int in_use_128B;
-    unsigned char in_use_512B;
+    unsigned int in_use_512B;
 
     int num_32B_blocks;
     int num_128B_blocks;
@@ -58,7 +64,7 @@ typedef struct HEAP_CONTROL_BLOCK
 #define SET_512B_BLOCK_IN_USE(_heap_cb, _block_number)      \
         if(_block_number < (_heap_cb)->num_512B_blocks)     \
         {                                                   \
-            unsigned char mask = 0x1 << _block_number;      \
+            unsigned int mask = 0x1 << _block_number;       \
             (_heap_cb)->in_use_512B |= mask;                \
         }
 
@@ -86,7 +92,7 @@ typedef struct HEAP_CONTROL_BLOCK
 #define SET_512B_BLOCK_FREE(_heap_cb, _block_number)        \
         if(_block_number < (_heap_cb)->num_512B_blocks)     \
         {                                                   \
-            unsigned char mask = ~(0x1 << _block_number);   \
+            unsigned int mask = ~(0x1 << _block_number);    \
             (_heap_cb)->in_use_512B &= mask;                \
         }
 
@@ -0,0 +1,93 @@
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H
+
+
+#include "task.h"
+
+
+/*
+ * Fixed size message queues. A queue holds up to depth messages
+ * of message_size bytes in a buffer given by its creator, and
+ * lives in memory shared by the tasks that use it. Like
+ * semaphores, only the kernel changes it.
+ *
+ * In copy mode each message is copied into the queue by the
+ * sender and out of it by the receiver. In pointer mode
+ * (MESSAGE_QUEUE_POINTERS) the queue only passes the pointer the
+ * sender gives it, so the message itself is never copied and the
+ * sender must not touch it again until the receiver hands it
+ * back.
+ *
+ * A sender that finds a receiver waiting copies the message
+ * straight into the receiver's buffer and wakes it, without the
+ * message going through the queue. In the same way, a receiver
+ * that takes a message from a full queue moves the message of
+ * the first waiting sender into the freed slot and wakes it.
+ * Senders and receivers wait in priority order.
+ *
+ * Interrupt handlers may send with a timeout of WAIT_POLL, which
+ * never blocks or switches tasks.
+ */
+
+
+#define ERROR_MESSAGE_QUEUE_INVALID     -13
+
+// pass pointers to messages instead of copying the messages
+#define MESSAGE_QUEUE_POINTERS          0x1
+
+
+/*
+ * Must match the layout of message_queue_t in the API. Tasks do
+ * not touch any of it.
+ */
+typedef struct MESSAGE_QUEUE
+{
+    uint8_t *buffer;
+    unsigned int message_size;
+    unsigned int depth;
+    unsigned int options;
+
+    // messages in the queue, starting from the oldest at slot head
+    unsigned int count;
+    unsigned int head;
+
+    // at most one of these has waiters at a time
+    wait_queue_t receivers;
+    wait_queue_t senders;
+
+} message_queue_t;
+
+
+/*
+ * Sets up a queue of depth messages of message_size bytes in a
+ * buffer of depth*message_size bytes. In pointer mode messages
+ * are pointers, so message_size is ignored and the buffer holds
+ * depth pointers. Returns 0 or ERROR_MESSAGE_QUEUE_INVALID.
+ */
+int message_queue_init(message_queue_t *queue, void *buffer, unsigned int depth, unsigned int message_size, unsigned int options);
+
+/*
+ * Sends a message on behalf of task: in copy mode the
+ * message_size bytes at message, in pointer mode message itself.
+ * If the queue is full, task blocks for up to timeout ticks (see
+ * set_task_timeout), and the caller reschedules; task runs again
+ * with 0 as its return value once its message is in the queue,
+ * or with ERROR_TIMED_OUT. Returns 1 if a woken receiver should
+ * preempt the current task, in which case a syscall caller
+ * reschedules, 0 otherwise, or ERROR_TIMED_OUT at once if the
+ * queue is full and timeout is WAIT_POLL.
+ */
+int message_send(task_table_t *table, task_control_block_t *task, message_queue_t *queue, void *message, unsigned int timeout, unsigned int now);
+
+/*
+ * Receives the oldest message on behalf of task into buffer: in
+ * copy mode its message_size bytes, in pointer mode the pointer
+ * that was sent. If the queue is empty, task blocks like a full
+ * send, and runs again with 0 once a message was stored into
+ * buffer. Returns 1 if a woken sender should preempt the current
+ * task, 0 otherwise, or ERROR_TIMED_OUT.
+ */
+int message_receive(task_table_t *table, task_control_block_t *task, message_queue_t *queue, void *buffer, unsigned int timeout, unsigned int now);
+
+
+#endif
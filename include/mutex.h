@@ -0,0 +1,102 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+
+#include "task.h"
+
+
+/*
+ * Mutexes with priority inheritance. The mutex lives in the
+ * memory of the tasks that share it, and is only handed to the
+ * kernel when it is contended: an unlocked mutex is locked, and
+ * a mutex nobody waits for is unlocked, by the API wrappers with
+ * LL/SC on the lock word without a system call.
+ *
+ * The lock word is 0 while the mutex is unlocked. Otherwise it
+ * holds an address inside the owner's stack, which is how the
+ * kernel finds the owner the first time another task has to
+ * wait, with MUTEX_CONTENDED set while any task waits. Stack
+ * addresses are aligned, so the low bit is always free.
+ *
+ * While the mutex is contended the kernel keeps its owner, its
+ * waiters in priority order, and a link in the owner's list of
+ * held mutexes. The owner runs at the priority of its highest
+ * priority waiter, and if it is itself waiting for a mutex, the
+ * raised priority is passed on to that mutex's owner in turn.
+ * Unlocking a contended mutex hands it straight to the highest
+ * priority waiter.
+ */
+
+
+#define MUTEX_UNLOCKED      0
+#define MUTEX_CONTENDED     0x1
+
+#define MUTEX_OWNER_MASK    (~MUTEX_CONTENDED)
+
+
+#define ERROR_MUTEX_DEADLOCK        -8
+#define ERROR_MUTEX_NOT_OWNER       -9
+
+/*
+ * Returned by mutex_lock when no live task's stack holds the
+ * address in the lock word, meaning the owner exited with the
+ * mutex locked. The caller owns the mutex, but whatever it
+ * protects may be inconsistent.
+ */
+#define MUTEX_OWNER_DIED            1
+
+
+/*
+ * Must match the layout of mutex_t in the API. Tasks only
+ * touch the lock word; the rest is kept by the kernel.
+ */
+typedef struct MUTEX
+{
+    volatile uint32_t lock;
+
+    // only valid while MUTEX_CONTENDED is set
+    task_control_block_t *owner;
+    wait_queue_t waiters;
+
+    // next contended mutex held by the same owner
+    struct MUTEX *next_held;
+
+} mutex_t;
+
+
+#define MUTEX_INITIALIZER   { MUTEX_UNLOCKED, NULL_POINTER, { NULL_POINTER, NULL_POINTER }, NULL_POINTER }
+
+
+void mutex_init(mutex_t *mutex);
+
+/*
+ * Slow path of locking, run on behalf of task when it found the
+ * mutex locked. If the mutex was unlocked in the meantime, task
+ * gets it at once. Otherwise task blocks in priority order and
+ * the owner inherits its priority; the caller reschedules, and
+ * task runs again once the mutex has been handed to it.
+ *
+ * Kernel code locks and unlocks mutexes by calling these
+ * directly, since it cannot use the LL/SC fast path.
+ */
+int mutex_lock(task_table_t *table, task_control_block_t *task, mutex_t *mutex);
+
+/*
+ * Slow path of unlocking. Hands the mutex to the highest
+ * priority waiter and drops any priority task inherited
+ * through it. Returns 1 if the new owner should preempt task,
+ * in which case the caller reschedules, 0 otherwise, or
+ * ERROR_MUTEX_NOT_OWNER.
+ */
+int mutex_unlock(task_table_t *table, task_control_block_t *task, mutex_t *mutex);
+
+/*
+ * Called when a task leaves the scheduler for good. Removes it
+ * from the mutex it waits for, if any, and hands every contended
+ * mutex it holds to the next waiter, whose mutex_lock returns
+ * MUTEX_OWNER_DIED.
+ */
+void mutex_release_task(task_table_t *table, task_control_block_t *task);
+
+
+#endif
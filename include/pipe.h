@@ -0,0 +1,112 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+
+#include "task.h"
+#include "config.h"
+
+
+/*
+ * Anonymous pipes. A pipe is a ring buffer in the kernel with a
+ * read end and a write end, each opened as a file descriptor on
+ * an inode of type FILE_TYPE_PIPE, so reads and writes go
+ * through read_file and write_file like any other file. The data
+ * lives in the pipe table rather than in filesystem blocks.
+ *
+ * A read returns whatever is in the pipe, up to the size asked
+ * for, and blocks while the pipe is empty. A write blocks until
+ * all of its data is in the pipe. The task on the other end
+ * completes a blocked read or write on its behalf: a writer that
+ * finds a reader waiting copies straight into the reader's
+ * buffer, and a reader that frees up space pulls the rest of a
+ * waiting writer's data into the ring. Both ends wait in the
+ * order they arrived, so the data of one write is never split
+ * up by another.
+ *
+ * Once the write end is closed, reads of an empty pipe return
+ * 0. Once the read end is closed, writes fail with
+ * ERROR_PIPE_CLOSED.
+ */
+
+
+#define MAX_PIPES               CONFIG_MAX_PIPES
+#define PIPE_BUFFER_SIZE        256
+
+#define ERROR_PIPE_TABLE_FULL   -14
+#define ERROR_PIPE_CLOSED       -15
+
+// read of the write end, or write of the read end
+#define ERROR_PIPE_WRONG_END    -19
+
+#define PIPE_READ_END           0
+#define PIPE_WRITE_END          1
+
+
+typedef struct PIPE
+{
+    uint8_t data[PIPE_BUFFER_SIZE];
+
+    // bytes in the pipe, starting from the oldest at head
+    unsigned int head;
+    unsigned int count;
+
+    // whether each end is still open, indexed by PIPE_READ_END and PIPE_WRITE_END
+    unsigned char is_open[2];
+
+    // at most one of these has waiters at a time
+    wait_queue_t readers;
+    wait_queue_t writers;
+
+} pipe_t;
+
+
+typedef struct PIPE_TABLE
+{
+    // bitmap uses MAX_PIPES bits
+    uint32_t free_pipe_bitmap;
+
+    pipe_t pipes[MAX_PIPES];
+
+} pipe_table_t;
+
+
+void pipe_table_init(pipe_table_t *pipe_table);
+
+/*
+ * Takes a free pipe with both ends open and returns its index,
+ * or ERROR_PIPE_TABLE_FULL.
+ */
+int allocate_pipe(pipe_table_t *pipe_table);
+
+/*
+ * Reads up to size bytes on behalf of task and returns how many
+ * were read, or 0 if the pipe is empty and its write end closed.
+ * If the pipe is empty, task blocks and the caller reschedules;
+ * task runs again with the number of bytes the writer stored
+ * into buffer as its return value. Sets preempt to 1 if a writer
+ * the read made room for should preempt the current task, in
+ * which case a syscall caller reschedules, and 0 otherwise.
+ */
+int pipe_read(task_table_t *table, task_control_block_t *task, pipe_t *pipe, void *buffer, unsigned int size, int *preempt);
+
+/*
+ * Writes size bytes on behalf of task and returns size. If they
+ * do not all fit, task blocks and the caller reschedules; task
+ * runs again with size as its return value once the readers have
+ * taken enough for the rest to fit. Returns ERROR_PIPE_CLOSED if
+ * the read end is closed. Sets preempt to 1 if a reader the data
+ * went to should preempt the current task, and 0 otherwise.
+ */
+int pipe_write(task_table_t *table, task_control_block_t *task, pipe_t *pipe, void *buffer, unsigned int size, int *preempt);
+
+/*
+ * Closes one end of the pipe. Tasks waiting on the other end are
+ * woken: readers with 0, and writers with the number of bytes
+ * they got into the pipe, or ERROR_PIPE_CLOSED if none. The pipe
+ * is freed once both ends are closed. Returns 1 if a woken task
+ * should preempt the current task, 0 otherwise.
+ */
+int close_pipe_end(task_table_t *table, pipe_table_t *pipe_table, int pipe_index, int end);
+
+
+#endif
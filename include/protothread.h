@@ -0,0 +1,156 @@
+#ifndef PROTOTHREAD_H
+#define PROTOTHREAD_H
+
+
+#include "kdefs.h"
+#include "timers.h"
+
+
+/*
+ * Stackless coroutines (protothreads). Many small cooperative
+ * jobs are run by a scheduler inside a single task, so they do
+ * not each need a task slot and a stack. A job is a function
+ * that returns whenever it has to wait and is re-entered at the
+ * point where it left off. Since it has no stack of its own,
+ * local variables do not survive a wait; anything a job needs
+ * to keep goes in a structure that embeds its pt_job_t.
+ *
+ * A job is written as:
+ *
+ *     static int blink_led(pt_job_t *job)
+ *     {
+ *         PT_BEGIN(job);
+ *
+ *         while(1)
+ *         {
+ *             toggle_led();
+ *             PT_SLEEP(job, 500);
+ *         }
+ *
+ *         PT_END(job);
+ *     }
+ *
+ * The wait macros expand to case labels of a switch on the line
+ * the job is waiting at, so a job must not wait from inside a
+ * switch statement of its own, and at most one wait may be on
+ * any source line.
+ */
+
+
+// values returned by job functions
+#define PT_WAITING      0
+#define PT_ENDED        1
+
+
+struct PT_JOB;
+
+typedef int (*pt_function_t)(struct PT_JOB *job);
+
+
+/*
+ * State of a job. This is all a job costs, 16 bytes on MIPS32,
+ * compared to a task control block and a stack for a task.
+ */
+typedef struct PT_JOB
+{
+    pt_function_t function;
+
+    // next job in the scheduler's list
+    struct PT_JOB *next;
+
+    // tick a sleeping job becomes runnable again
+    unsigned int wake_tick;
+
+    // source line the job continues from, or 0 to start over
+    unsigned short resume_line;
+
+    unsigned short sleeping;
+
+} pt_job_t;
+
+
+typedef struct PT_SCHEDULER
+{
+    pt_job_t *jobs;
+    unsigned int num_jobs;
+
+} pt_scheduler_t;
+
+
+
+#define PT_BEGIN(_job)                                              \
+    switch((_job)->resume_line)                                     \
+    {                                                               \
+        case 0:
+
+
+#define PT_END(_job)                                                \
+    }                                                               \
+    (_job)->resume_line = 0;                                        \
+    return PT_ENDED;
+
+
+// ends the job early
+#define PT_EXIT(_job)                                               \
+    do                                                              \
+    {                                                               \
+        (_job)->resume_line = 0;                                    \
+        return PT_ENDED;                                            \
+    } while(0)
+
+
+/*
+ * Returns to the scheduler until the condition is true. The
+ * condition is tested again every time the scheduler runs the
+ * job, so it suits device status flags and similar readiness.
+ */
+#define PT_WAIT_UNTIL(_job, _condition)                             \
+    do                                                              \
+    {                                                               \
+        (_job)->resume_line = __LINE__;                             \
+        case __LINE__:                                              \
+        if(!(_condition)) return PT_WAITING;                        \
+    } while(0)
+
+
+// lets every other runnable job run once before continuing
+#define PT_YIELD(_job)                                              \
+    do                                                              \
+    {                                                               \
+        (_job)->resume_line = __LINE__;                             \
+        return PT_WAITING;                                          \
+        case __LINE__:;                                             \
+    } while(0)
+
+
+/*
+ * Waits for the given number of system ticks. The scheduler
+ * does not call a sleeping job at all until it is due.
+ */
+#define PT_SLEEP(_job, _ticks)                                      \
+    do                                                              \
+    {                                                               \
+        (_job)->wake_tick = get_system_ticks() + (_ticks);          \
+        (_job)->sleeping = 1;                                       \
+        PT_YIELD(_job);                                             \
+    } while(0)
+
+
+
+void pt_scheduler_init(pt_scheduler_t *scheduler);
+
+/*
+ * Adds the job to the scheduler, to start running function
+ * from the beginning on the next pass.
+ */
+void pt_job_start(pt_scheduler_t *scheduler, pt_job_t *job, pt_function_t function);
+
+/*
+ * Runs every job that is not sleeping once, in the order they
+ * were started, and drops the jobs that ended. Returns the
+ * number of jobs left.
+ */
+unsigned int pt_scheduler_run(pt_scheduler_t *scheduler);
+
+
+#endif
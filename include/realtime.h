@@ -0,0 +1,56 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+
+#include "task.h"
+
+
+/*
+ * Real-time scheduling class. Real-time tasks declare a
+ * period, worst case execution time (WCET) and relative
+ * deadline when they are created, and are scheduled
+ * earliest-deadline-first ahead of all best-effort tasks.
+ *
+ * A task is only admitted if the total density of all
+ * real-time tasks, the sum of wcet/min(deadline, period),
+ * stays within RT_UTILIZATION_BOUND. Under EDF this is
+ * sufficient for every deadline to be met as long as no
+ * task runs longer than its declared WCET.
+ */
+
+
+/*
+ * Creates a real-time task whose first job is released
+ * immediately. Returns the task ID, ERROR_INVALID_RT_PARAMS
+ * if the parameters are inconsistent, ERROR_ADMISSION_FAILED
+ * if the task does not fit in the remaining utilization, or
+ * any error returned by create_task.
+ */
+taskid_t create_realtime_task(task_table_t *table, int parent_task_id, void *function, realtime_params_t *params);
+
+
+/*
+ * Called from the tick handler after the system tick count has
+ * been advanced. Releases jobs whose period has started and
+ * counts jobs that are still running past their deadline.
+ * Returns immediately on ticks where no such event is due.
+ */
+void realtime_tick(task_table_t *table, unsigned int now);
+
+
+/*
+ * Ends the current job of a real-time task. The task blocks
+ * until its next release, unless that has already passed, in
+ * which case the next job starts right away.
+ */
+void complete_realtime_job(task_table_t *table, task_control_block_t *task, unsigned int now);
+
+
+/*
+ * Returns the number of deadlines the task has missed, or
+ * ERROR_TASK_NOT_FOUND if no such real-time task exists.
+ */
+int get_deadline_misses(task_table_t *table, int task_id);
+
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+
+#include "task.h"
+
+
+/*
+ * Counting semaphores. The semaphore lives in the memory of the
+ * tasks that share it, and all of it is kept by the kernel.
+ *
+ * Waiters are kept in priority order, so a post hands the count
+ * straight to the highest priority waiter in constant time, and
+ * only waiting costs a walk past the waiters of equal or higher
+ * priority. A post that wakes a task does not add to the count.
+ *
+ * Posting only makes the woken task ready and never switches
+ * tasks itself, so interrupt handlers post by calling
+ * semaphore_post directly. The woken task runs at the next
+ * scheduling point.
+ */
+
+
+#define ERROR_SEMAPHORE_OVERFLOW    -11
+
+#define SEMAPHORE_MAX_COUNT         0x7FFFFFFF
+
+
+/*
+ * Must match the layout of semaphore_t in the API. Tasks do not
+ * touch any of it.
+ */
+typedef struct SEMAPHORE
+{
+    unsigned int count;
+    wait_queue_t waiters;
+
+} semaphore_t;
+
+
+#define SEMAPHORE_INITIALIZER(_count)   { (_count), { NULL_POINTER, NULL_POINTER } }
+
+
+void semaphore_init(semaphore_t *semaphore, unsigned int count);
+
+/*
+ * Takes one from the count on behalf of task. If the count is 0,
+ * task blocks in priority order for up to timeout ticks (see
+ * set_task_timeout), and the caller reschedules; task runs again
+ * with 0 as its return value once a post hands it the count, or
+ * with ERROR_TIMED_OUT. Returns 0, or ERROR_TIMED_OUT at once if
+ * the count is 0 and timeout is WAIT_POLL.
+ */
+int semaphore_wait(task_table_t *table, task_control_block_t *task, semaphore_t *semaphore, unsigned int timeout, unsigned int now);
+
+/*
+ * Wakes the highest priority waiter, or adds one to the count if
+ * nothing waits. Returns 1 if the woken task should preempt the
+ * current task, in which case a syscall caller reschedules, 0
+ * otherwise, or ERROR_SEMAPHORE_OVERFLOW. Safe to call from an
+ * interrupt handler.
+ */
+int semaphore_post(task_table_t *table, semaphore_t *semaphore);
+
+
+#endif
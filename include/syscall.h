@@ -4,11 +4,10 @@
 #define SYSCALL_H
 
 
-#include "ktypes.h"
-
-
 /*
- * Macros defining the system call codes.
+ * Macros defining the system call codes. Codes with no handler
+ * in syscall_table, such as DUP and MOUNT, are reserved and fail
+ * with ERROR_INVALID_SYSCALL like codes past the end of it.
  */
 #define SYSCALL_CODE_CREATE_TASK        0
 #define SYSCALL_CODE_KILL_TASK          1
@@ -27,6 +26,42 @@
 #define SYSCALL_CODE_SEEK               14
 #define SYSCALL_CODE_DELETE_FILE        15
 #define SYSCALL_CODE_SLEEP              16
+#define SYSCALL_CODE_CREATE_RT_TASK     17
+#define SYSCALL_CODE_WAIT_NEXT_PERIOD   18
+#define SYSCALL_CODE_DEADLINE_MISSES    19
+#define SYSCALL_CODE_STACK_HIGH_WATER   20
+#define SYSCALL_CODE_TASK_STATS         21
+#define SYSCALL_CODE_SLEEP_UNTIL        22
+#define SYSCALL_CODE_MUTEX_LOCK         23
+#define SYSCALL_CODE_MUTEX_UNLOCK       24
+#define SYSCALL_CODE_SEMAPHORE_WAIT     25
+#define SYSCALL_CODE_SEMAPHORE_POST     26
+#define SYSCALL_CODE_EVENT_WAIT         27
+#define SYSCALL_CODE_EVENT_SET          28
+#define SYSCALL_CODE_EVENT_CLEAR        29
+#define SYSCALL_CODE_MESSAGE_SEND       30
+#define SYSCALL_CODE_MESSAGE_RECEIVE    31
+#define SYSCALL_CODE_PIPE               32
+#define SYSCALL_CODE_RING_ENTER         33
+
+// number of entries in the system call table
+#define NUM_SYSCALLS                    34
+
+#define ERROR_INVALID_SYSCALL           -17
+
+
+// the codes above are also used by syscall_dispatch.S
+#ifndef __ASSEMBLER__
+
+
+#include "ktypes.h"
+#include "task.h"
+#include "mutex.h"
+#include "semaphore.h"
+#include "event.h"
+#include "message_queue.h"
+#include "syscall_ring.h"
+
 
 
 
@@ -50,6 +85,47 @@
 
 
 
+/*
+ * System call handler functions, implemented in syscall.c.
+ */
+taskid_t do_syscall_create_task(void *function, unsigned int stack_size);
+taskid_t do_syscall_create_realtime_task(void *function, realtime_params_t *params);
+int do_syscall_wait_next_period();
+int do_syscall_deadline_misses(taskid_t task_id);
+int do_syscall_stack_high_water(taskid_t task_id);
+int do_syscall_task_stats(taskid_t task_id, task_stats_t *stats);
+int do_syscall_kill_task(taskid_t task_id);
+int do_syscall_yield();
+unsigned int do_syscall_sleep(unsigned int ticks);
+unsigned int do_syscall_sleep_until(unsigned int wake_tick);
+int do_syscall_mutex_lock(mutex_t *mutex);
+int do_syscall_mutex_unlock(mutex_t *mutex);
+int do_syscall_semaphore_wait(semaphore_t *semaphore, unsigned int timeout);
+int do_syscall_semaphore_post(semaphore_t *semaphore);
+int do_syscall_event_wait(event_flags_t *group, event_wait_t *wait);
+int do_syscall_event_set(event_flags_t *group, uint32_t flags);
+int do_syscall_event_clear(event_flags_t *group, uint32_t flags);
+int do_syscall_message_send(message_queue_t *queue, void *message, unsigned int timeout);
+int do_syscall_message_receive(message_queue_t *queue, void *buffer, unsigned int timeout);
+int do_syscall_wait(int *status);
+int do_syscall_waitpid(taskid_t task_id, int *status);
+int do_syscall_exit(int status);
+int do_syscall_open(char *path);
+int do_syscall_close(int file_descriptor);
+int do_syscall_read(int file_descriptor, void *buffer, int size);
+int do_syscall_write(int file_descriptor, void *buffer, int size);
+int do_syscall_pipe(int *file_descriptors);
+unsigned int do_syscall_ring_enter(syscall_ring_t *ring);
+int do_syscall_seek(int file_descriptor, int offset);
+void do_syscall_mkfile(char *path);
+void do_syscall_mkdir(char *path);
+void do_syscall_delete_file(char *path);
+
+
+#endif /* __ASSEMBLER__ */
+
+
+
 
 
 
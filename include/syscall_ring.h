@@ -0,0 +1,83 @@
+#ifndef SYSCALL_RING_H
+#define SYSCALL_RING_H
+
+
+#include <stdint.h>
+
+
+/*
+ * Batched system calls. A task queues file operations in the
+ * submission ring of a syscall_ring_t in its own memory, and one
+ * ring enter system call runs all of them through the usual
+ * do_syscall_* handlers and posts each result in the completion
+ * ring, so a burst of small reads and writes costs one trap
+ * instead of one per operation.
+ *
+ * Both rings are single producer, single consumer, with
+ * free-running indices. The task only advances submission_tail
+ * and completion_head, and the kernel only advances
+ * submission_head and completion_tail. Operations run in the
+ * order they were queued. An enter stops early if the completion
+ * ring fills up, leaving the rest queued for the next one.
+ *
+ * Only open, close, read, write and seek can be queued. The ring
+ * cannot wait for a task to be woken, so reads and writes of
+ * pipes complete with ERROR_RING_WOULD_BLOCK, and anything else
+ * with ERROR_INVALID_SYSCALL.
+ */
+
+
+// must be a power of two, and match the API's syscall_ring_t
+#define SYSCALL_RING_SIZE           32
+
+#define ERROR_RING_WOULD_BLOCK      -18
+
+
+typedef struct SYSCALL_SUBMISSION
+{
+    // SYSCALL_CODE_* of the operation, and its arguments as they would be passed in a0-a2
+    uint32_t code;
+    uint32_t args[3];
+
+    // passed back with the result, for the task to tell completions apart
+    uint32_t user_data;
+
+} syscall_submission_t;
+
+
+typedef struct SYSCALL_COMPLETION
+{
+    uint32_t user_data;
+
+    // what the system call would have returned
+    int32_t result;
+
+} syscall_completion_t;
+
+
+typedef struct SYSCALL_RING
+{
+    uint32_t submission_head;
+    uint32_t submission_tail;
+    uint32_t completion_head;
+    uint32_t completion_tail;
+
+    syscall_submission_t submissions[SYSCALL_RING_SIZE];
+    syscall_completion_t completions[SYSCALL_RING_SIZE];
+
+} syscall_ring_t;
+
+
+// runs one operation and returns its result
+typedef int (*syscall_ring_handler_t)(syscall_submission_t *submission);
+
+
+/*
+ * Runs queued operations through handler, in order, until the
+ * submission ring is empty or the completion ring is full, and
+ * returns how many it ran.
+ */
+unsigned int run_syscall_ring(syscall_ring_t *ring, syscall_ring_handler_t handler);
+
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef SYSCALL_STATS_H
+#define SYSCALL_STATS_H
+
+
+/*
+ * System call statistics. With CONFIG_SYSCALL_STATS set in
+ * kernel.cfg, the dispatch path counts the calls to each system
+ * call and the cycle counter counts spent in them, in total and
+ * at most, and the calls and cycles of each task. Without it the
+ * hooks compile to nothing.
+ *
+ * On entry the dispatch code stores the code, the first three
+ * arguments and the cycle counter into the call in flight, and
+ * on exit syscall_stats_exit charges the time to the system call
+ * and the calling task. System calls never nest, and the
+ * scheduler only runs after the exit is recorded, so one call in
+ * flight is enough. Calls made by the idle task are left out.
+ *
+ * CONFIG_SYSCALL_STRACE also queues a record of each call, with
+ * its arguments, result and duration, in a ring. The idle task
+ * decodes them one line at a time to the terminal, so streaming
+ * only uses time no task wanted. If the ring fills up, newer
+ * records are dropped and counted.
+ */
+
+
+#include "config.h"
+
+
+// offsets into syscall_stats_t of the call in flight, for syscall_dispatch.S
+#define SYSCALL_STATS_CODE_OFFSET       0
+#define SYSCALL_STATS_ARGS_OFFSET       4
+#define SYSCALL_STATS_START_OFFSET      16
+
+
+#ifndef __ASSEMBLER__
+
+
+#include <stdint.h>
+
+#include "hardware.h"
+#include "syscall.h"
+#include "task.h"
+
+
+#define STRACE_BUFFER_SIZE      CONFIG_STRACE_BUFFER_SIZE
+
+
+typedef struct SYSCALL_IN_FLIGHT
+{
+    uint32_t code;
+    uint32_t args[3];
+
+    // cycle counter at entry
+    uint32_t start;
+
+} syscall_in_flight_t;
+
+
+typedef struct SYSCALL_COUNTERS
+{
+    uint32_t calls;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+
+} syscall_counters_t;
+
+
+typedef struct TASK_SYSCALL_COUNTERS
+{
+    // task the counters belong to, as the slot may be reused by a later task
+    int32_t task_id;
+
+    uint32_t calls;
+    uint64_t total_cycles;
+
+} task_syscall_counters_t;
+
+
+typedef struct STRACE_RECORD
+{
+    int32_t task_id;
+    uint32_t code;
+    uint32_t args[3];
+    int32_t result;
+    uint32_t cycles;
+
+} strace_record_t;
+
+
+typedef struct SYSCALL_STATS
+{
+    // must stay first, at the offsets above
+    syscall_in_flight_t current;
+
+    syscall_counters_t syscalls[NUM_SYSCALLS];
+
+    // indexed by task slot
+    task_syscall_counters_t tasks[MAX_TASKS];
+
+#ifdef CONFIG_SYSCALL_STRACE
+    // free-running indices, written by syscall_stats_exit and read by the idle task
+    uint32_t strace_head;
+    uint32_t strace_tail;
+    uint32_t strace_dropped;
+
+    strace_record_t strace[STRACE_BUFFER_SIZE];
+#endif
+
+} syscall_stats_t;
+
+
+
+#ifdef CONFIG_SYSCALL_STATS
+
+extern syscall_stats_t syscall_stats;
+
+// the host's entry hook; syscall_dispatch.S does the same stores itself
+static inline void syscall_stats_enter(uint32_t code, uint32_t arg0, uint32_t arg1, uint32_t arg2)
+{
+    syscall_stats.current.code = code;
+    syscall_stats.current.args[0] = arg0;
+    syscall_stats.current.args[1] = arg1;
+    syscall_stats.current.args[2] = arg2;
+    syscall_stats.current.start = read_cycle_counter();
+}
+
+#define SYSCALL_STATS_ENTER(_code, _arg0, _arg1, _arg2)     \
+    syscall_stats_enter((_code), (uint32_t) (_arg0), (uint32_t) (_arg1), (uint32_t) (_arg2))
+
+#define SYSCALL_STATS_EXIT(_result)     syscall_stats_exit(_result)
+
+#else
+
+#define SYSCALL_STATS_ENTER(_code, _arg0, _arg1, _arg2)     ((void) 0)
+#define SYSCALL_STATS_EXIT(_result)     ((void) 0)
+
+#endif
+
+
+
+// clears every counter and the strace ring
+void syscall_stats_init(syscall_stats_t *stats);
+
+#ifdef CONFIG_SYSCALL_STATS
+/*
+ * Charges the call in flight to its system call and to the task
+ * the kernel data page names as running, and queues its strace
+ * record. Must be called before the scheduler runs.
+ */
+void syscall_stats_exit(int result);
+#endif
+
+// name of a system call, or NULL for an unused code
+const char *get_syscall_name(unsigned int code);
+
+/*
+ * Writes a table of the calls, total, average and maximum cycles
+ * of every system call that was made, followed by the calls and
+ * cycles of each task, as text through write.
+ */
+void syscall_stats_dump(syscall_stats_t *stats, void (*write)(const void *data, unsigned int size));
+
+#ifdef CONFIG_SYSCALL_STRACE
+/*
+ * Decodes up to max_records queued strace records into lines
+ * such as
+ *
+ *     [task 33] write(0x3, 0x7f001a20, 0x10) = 16 <812 cycles>
+ *
+ * and passes each to write. Returns the number decoded.
+ */
+unsigned int syscall_strace_flush(syscall_stats_t *stats, unsigned int max_records, void (*write)(const void *data, unsigned int size));
+#endif
+
+
+#endif /* __ASSEMBLER__ */
+
+
+#endif
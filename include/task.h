@@ -18,8 +18,69 @@
 #define TASK_ID_NONE -1
 
 
+/*
+ * Task IDs encode the index of the task's slot in the task
+ * table in the low bits and a per-slot generation counter in
+ * the remaining bits. The generation is incremented every
+ * time a slot is reused, so an ID held by someone after the
+ * task it named has exited will no longer match the slot and
+ * is rejected. Looking a task up by ID is one array index and
+ * one compare. The generation is kept to 26 bits so that task
+ * IDs are always non-negative and never equal TASK_ID_NONE.
+ */
+#define TASK_ID_INDEX_BITS          5
+#define TASK_ID_INDEX_MASK          ((1 << TASK_ID_INDEX_BITS) - 1)
+#define TASK_ID_GENERATION_MASK     0x03FFFFFF
+
+#if (1 << TASK_ID_INDEX_BITS) < MAX_TASKS
+#error "TASK_ID_INDEX_BITS is too small to index MAX_TASKS task slots"
+#endif
+
+#define MAKE_TASK_ID(_index, _generation)   ((int)(((_generation) << TASK_ID_INDEX_BITS) | (_index)))
+#define TASK_ID_INDEX(_task_id)             ((_task_id) & TASK_ID_INDEX_MASK)
+
+
 #define ERROR_TASK_TABLE_FULL       -1
 #define ERROR_TASK_NOT_FOUND        -2
+#define ERROR_INVALID_PRIORITY      -3
+#define ERROR_INVALID_RT_PARAMS     -4
+#define ERROR_ADMISSION_FAILED      -5
+#define ERROR_NO_STACK_SPACE        -6
+#define ERROR_NO_CHILDREN           -7
+#define ERROR_TIMED_OUT             -10
+
+// the root task and kernel tasks such as the deferred work worker cannot be killed
+#define ERROR_TASK_NOT_KILLABLE     -20
+
+// task ID passed to wait_task to reap whichever child exits first
+#define WAIT_ANY_CHILD              TASK_ID_NONE
+
+// exit status a task killed by another gets, for its parent to reap
+#define EXIT_STATUS_KILLED          -1
+
+
+/*
+ * Scheduling classes. Real-time tasks are scheduled
+ * earliest-deadline-first and always run before any
+ * best-effort task. Best-effort tasks are scheduled by
+ * priority, round-robin within a priority.
+ */
+#define SCHED_CLASS_BEST_EFFORT     0
+#define SCHED_CLASS_REALTIME        1
+
+
+/*
+ * Utilization of real-time tasks is kept in fixed point,
+ * where RT_UTILIZATION_SCALE is a fully used CPU. New
+ * real-time tasks are only admitted while the total stays
+ * at or below RT_UTILIZATION_BOUND, which leaves some time
+ * for best-effort tasks to run in the background.
+ */
+#define RT_UTILIZATION_SCALE        1000
+#define RT_UTILIZATION_BOUND        900
+
+// no real-time release or deadline is pending
+#define RT_NO_EVENT                 0xFFFFFFFF
 
 
 
@@ -40,14 +101,102 @@ typedef enum
 
 
 /*
- * Used to represent a usable stack starting point
- * for a given task. MiniOS will allocate stacks
- * in a recursive manner, bisecting the total stack
- * space, with each new task created.
+ * Timing parameters of a real-time task, all in system
+ * ticks. The task runs one job per period, each of which
+ * must finish within deadline ticks of its release and is
+ * expected to need at most wcet ticks of CPU time.
+ */
+typedef struct REALTIME_PARAMS
+{
+    unsigned int period;
+    unsigned int wcet;
+    unsigned int deadline;
+
+} realtime_params_t;
+
+
+/*
+ * Scheduling state of a real-time task. The current job is
+ * active from its release until the task calls wait for next
+ * period. A job that is still active at its absolute deadline
+ * counts as one deadline miss.
+ */
+typedef struct REALTIME_STATE
+{
+    realtime_params_t params;
+
+    // share of the CPU reserved for the task at admission
+    unsigned int utilization;
+
+    unsigned int next_release;
+    unsigned int absolute_deadline;
+
+    unsigned int jobs_completed;
+    unsigned int deadline_misses;
+
+    unsigned char job_active;
+    unsigned char miss_counted;
+
+} realtime_state_t;
+
+
+/*
+ * Queue of tasks blocked until some event happens. Blocked
+ * tasks are not on a ready list, so the queue is linked
+ * through the same next and previous task links, in the
+ * order the tasks blocked.
+ */
+typedef struct WAIT_QUEUE
+{
+    struct TASK_CONTROL_BLOCK *head;
+    struct TASK_CONTROL_BLOCK *tail;
+
+} wait_queue_t;
+
+
+/*
+ * CPU accounting. Times are counts of the cycle counter, which
+ * on MIPS is the core timer Count register running at half the
+ * system clock. Wait times from READY to RUNNING are kept in a
+ * log2 histogram: bucket i counts waits of at least
+ * 2^i << WAIT_HISTOGRAM_SHIFT cycles (bucket 0 starts at zero),
+ * and the last bucket also counts every longer wait.
+ */
+#define WAIT_HISTOGRAM_BUCKETS      16
+#define WAIT_HISTOGRAM_SHIFT        6
+
+#define WAIT_HISTOGRAM_BUCKET(_cycles)                                      \
+    __extension__ ({                                                        \
+        int bucket = 31 - __builtin_clz(((_cycles) >> WAIT_HISTOGRAM_SHIFT) | 1); \
+        if(bucket >= WAIT_HISTOGRAM_BUCKETS) bucket = WAIT_HISTOGRAM_BUCKETS - 1; \
+        bucket;                                                             \
+    })
+
+
+typedef struct TASK_STATS
+{
+    // total time spent on the CPU, including system calls
+    unsigned long long run_cycles;
+
+    // number of times the task was switched onto the CPU
+    unsigned int num_switches;
+
+    // cycle count when the task last became ready
+    unsigned int ready_timestamp;
+
+    unsigned int wait_histogram[WAIT_HISTOGRAM_BUCKETS];
+
+} task_stats_t;
+
+
+/*
+ * Stack region of a task. The stack grows down from top,
+ * and its lowest address is top - size.
  */
 typedef struct TASK_STACK
 {
     void *top;
+    unsigned int size;
 
 } task_stack_t;
 
@@ -63,24 +212,102 @@ typedef struct TASK_CONTROL_BLOCK
     task_state_t state;
 
 
+    /*
+     * Scheduling priority of the task. Lower numbers
+     * are higher priority, with 0 being the highest.
+     * While the task holds a mutex that a higher priority
+     * task waits for, priority is raised to the waiter's
+     * and base_priority keeps the task's own priority.
+     */
+    unsigned int priority;
+    unsigned int base_priority;
+
+    // SCHED_CLASS_BEST_EFFORT or SCHED_CLASS_REALTIME
+    unsigned int sched_class;
+
+    // only used by real-time tasks
+    realtime_state_t rt;
+
+
     // information about task ids and parent and child tasks
     taskid_t task_id;
-    taskid_t parent_task_id;
-    taskid_t child_task_ids[MAX_CHILDREN];
-    unsigned int child_task_bitmask;
+    unsigned int generation;
     int num_children;
 
     /*
-     * This variable gives the index into the stack table,
-     * which holds the top (highest address) of the stack
-     * for a given task.
+     * Family tree of the task. The children of a task form a
+     * doubly linked list through their sibling links, headed
+     * by the parent's first child, so a child is added or
+     * removed in constant time without any per-task array.
+     */
+    struct TASK_CONTROL_BLOCK *parent;
+    struct TASK_CONTROL_BLOCK *first_child;
+    struct TASK_CONTROL_BLOCK *next_sibling;
+    struct TASK_CONTROL_BLOCK *previous_sibling;
+
+    /*
+     * Children that have exited but not been reaped are
+     * TERMINATED (zombies). They are moved from the child
+     * list to this list, so waiting for any child finds one
+     * without scanning, and they keep only their exit status.
+     */
+    struct TASK_CONTROL_BLOCK *first_zombie;
+    int exit_status;
+
+    /*
+     * The task blocks on its own child exit queue while it
+     * waits for the child waiting_for (or WAIT_ANY_CHILD) to
+     * exit. The exiting child reaps itself on the waiter's
+     * behalf and stores its status through wait_status.
      */
-    int stack_index;
+    wait_queue_t child_exit_queue;
+    taskid_t waiting_for;
+    int *wait_status;
+
+    // wait queue the task is blocked on, if any
+    wait_queue_t *blocked_on;
 
     /*
-     * Used by main task since no index.
+     * Mutex the task is waiting to lock, if any, and the list
+     * of contended mutexes it holds, whose waiters it inherits
+     * priority from. Defined in mutex.h.
      */
-    task_stack_t *stack;
+    struct MUTEX *waiting_mutex;
+    struct MUTEX *held_mutexes;
+
+    /*
+     * Links in the sleep list, kept apart from next_task and
+     * previous_task so that a task can wait on a queue and for
+     * a timeout at once. While the task is in the list, ticks
+     * between the wakeup of the task before it and its own.
+     */
+    struct TASK_CONTROL_BLOCK *next_sleeper;
+    struct TASK_CONTROL_BLOCK *previous_sleeper;
+    unsigned int sleep_delta;
+
+    /*
+     * While the task waits on an event flag group, the flags it
+     * waits for and where the flags that satisfied the wait are
+     * stored. Defined in event.h.
+     */
+    struct EVENT_WAIT *event_wait;
+
+    /*
+     * While the task waits to send on a message queue, the
+     * message it sends, and while it waits to receive, the
+     * buffer the message is stored into. See message_queue.h.
+     * Pipes use it the same way, with the size of the blocked
+     * read or write and how much of it is done. See pipe.h.
+     */
+    void *message;
+    unsigned int transfer_size;
+    unsigned int transferred;
+
+    // region of user stack space allocated to the task
+    task_stack_t stack;
+
+    // CPU time and scheduling latency of the task
+    task_stats_t stats;
 
 
     /*
@@ -90,227 +317,102 @@ typedef struct TASK_CONTROL_BLOCK
     inode_number_t current_directory;
 
 
-    // next and previous tasks stored in the task list
+    /*
+     * Next and previous tasks in the ready list for this
+     * task's priority, or in the deadline-ordered real-time
+     * ready list. Only meaningful while the task is READY or
+     * CREATED, since running and blocked tasks are not kept
+     * in any ready list. A task blocked on a wait queue is
+     * linked into the wait queue instead.
+     */
     struct TASK_CONTROL_BLOCK *next_task;
     struct TASK_CONTROL_BLOCK *previous_task;
 
 
     // storage for register data when task is context switched off CPU
-    // program counter is at index 0 since register 0 is a constant
+    // program counter is at index REGISTER_PC, and since register 0 is
+    // a constant, index 0 holds the frame type the registers were saved as
     uint32_t regs[NUM_REGS + 1];
 
 } task_control_block_t;
 
 
-#define IS_CHILD_ACTIVE(_task_control_block, _index)                                \
-    __extension__ ({                                                                \
-        int in_use;                                                                 \
-        unsigned short mask = 0x1 << _index;                                        \
-        in_use = ((_task_control_block)->child_task_bitmask & mask) >> _index;      \
-        in_use;                                                                     \
-    })
 
 
-#define SET_CHILD_ACTIVE(_task_control_block, _index)       \
-    unsigned short mask = 0x1 << _index;                    \
-    (_task_control_block)->child_task_bitmask |= mask;
 
-#define SET_CHILD_INACTIVE(_task_control_block, _index)     \
-    unsigned short mask = ~(0x1 << _index);                 \
-    (_task_control_block)->child_task_bitmask &= mask;
 
 
-#define FIRST_FREE_CHILD_INDEX(_task_control_block)             \
-    __extension__ ({                                            \
-        int index;                                              \
-        for(index = 0; index < MAX_CHILDREN; index++)           \
-        {                                                       \
-            if(IS_CHILD_ACTIVE(_task_control_block, index))     \
-            {                                                   \
-                break;                                          \
-            }                                                   \
-        }                                                       \
-        if(index >= MAX_CHILDREN) index = -1;                   \
-        index;                                                  \
-    })
+/*
+ * Free region of user stack space, from base up to but not
+ * including base + size.
+ */
+typedef struct STACK_REGION
+{
+    uintptr_t base;
+    unsigned int size;
 
+} stack_region_t;
 
 
+/*
+ * Every allocated stack splits at most one free region in two,
+ * so there is never more than one free region per task plus
+ * the one at the bottom of the stack space.
+ */
+#define MAX_STACK_REGIONS   (MAX_TASKS + 1)
 
 
 /*
- * This structure is used to keep track of
- * the stacks used for the tasks.
- * 
- * To allocate a stack region to a given task, miniOS
- * will start (with main) by allocating the stack at 
- * the top of the global stack region and that task will
- * have the entire global stack region to itself. The next 
- * task will have its stack allocated halfway down the
- * global stack region, effectively splitting the total
- * size of both program's stacks in half. The next two
- * tasks will have their stacks allocated so that they split
- * the two previous tasks' stack spaces in half, and the
- * next four will split those in half, etc. Thus, the
- * stack allocation process is a form of recursive
- * spatial partitioning.
- * 
- * This data structure is needed to ensure that stacks
- * are not allocated all at one end of the stack region,
- * or grouped together, but are spread relatively evenly
- * throughout the global stack region. Since the spatial
- * partitioning can be thought of as a type of binary
- * search, recursively splitting each stack region in half,
- * the data structure is organized as a binary search tree.
- * The data structure has a member to keep track of the
- * first stack that is in use by the program, the main
- * function stack, and it also keeps an array of stacks
- * that can be used when new tasks are created. The
- * elements of the array "stacks" are organized as a 
- * complete binary search tree based on the address of
- * the top (highest address) of the stack. Each node
- * contains the address of the beginning of a task stack
- * and effectively divides a larger stack region into two
- * sub-regions of equal size. Its left and right children
- * further divide each of those regions into equal-sized
- * sub-regions. The tree is serialized into the array
- * using level-order traversal (since it is a complete
- * binary tree) and the macros below are used to find
- * and manipulate child and parent indices.
+ * This structure is used to keep track of the user stack space
+ * between the end of the user heap and the top of user RAM.
+ *
+ * The main stack is reserved at the very top of the stack space
+ * for the root task. The rest is handed out to tasks by a region
+ * allocator, so each task gets a stack of the size it asked for.
+ * The free regions are kept sorted by address, and a stack that is
+ * freed is merged with any free region directly above or below it,
+ * so freed stacks do not leave the space fragmented. New stacks
+ * are taken from the top of the smallest free region they fit in.
+ *
+ * Stacks are painted with STACK_PAINT_WORD when they are allocated,
+ * so the deepest point a task's stack has reached can be found by
+ * looking for the lowest word that was overwritten.
  */
 typedef struct STACK_CONTROL_BLOCK
 {
     task_stack_t main_stack;
-    task_stack_t stacks[MAX_TASKS - 1];
-
-    uint32_t free_stack_bitmap;
-
-} stack_control_block_t;
-
-
-
-#define NO_INDEX -1
-#define ABSOLUTE_TOP -2
-#define ABSOLUTE_BOTTOM -3
-
-
-#define SET_STACK_FREE(_stack_control_block, _index)        \
-    int mask = 0x1 << _index;                               \
-    (_stack_control_block)->free_stack_bitmap |= mask;
-
-#define SET_STACK_IN_USE(_stack_control_block, _index)      \
-    int mask = ~(0x1 << _index);                            \
-    (_stack_control_block)->free_stack_bitmap &= mask;
-
-
-
-#define IS_STACK_FREE(_stack_control_block, _index)                                 \
-    __extension__ ({                                                                \
-        int mask = 0x1 << _index;                                                   \
-        int is_free;                                                                \
-        is_free = ((_stack_control_block)->free_stack_bitmap & mask) >> _index;     \
-        is_free;                                                                    \
-    })
-
-
-#define IS_RIGHT_CHILD(_index)                          \
-    __extension__ ({                                    \
-        int is_right;                                   \
-        is_right = (_index > 0 && (_index % 2 == 0));   \
-        is_right;                                       \
-    })
-
-
-#define IS_LEFT_CHILD(_index)                           \
-    __extension__ ({                                    \
-        int is_left;                                    \
-        is_left = (_index % 2 == 1);                    \
-        is_left;                                        \
-    })
 
+    stack_region_t free_regions[MAX_STACK_REGIONS];
+    int num_free_regions;
 
-#define LEFT_CHILD_INDEX(_index)                        \
-    __extension__ ({                                    \
-        int left_child;                                 \
-        left_child = 2*_index + 1;                      \
-        left_child;                                     \
-    })
-
-#define RIGHT_CHILD_INDEX(_index)                       \
-    __extension__ ({                                    \
-        int right_child;                                \
-        right_child = 2*_index + 2;                     \
-        right_child;                                    \
-    })
-
-
-#define PARENT_INDEX(_index)                            \
-    __extension__ ({                                    \
-        int parent;                                     \
-        if(IS_RIGHT_CHILD(_index))                      \
-        {                                               \
-            parent = (_index - 2)/2;                    \
-        }                                               \
-        else if(IS_LEFT_CHILD(_index))                  \
-        {                                               \
-            parent = (_index - 1)/2;                    \
-        }                                               \
-        else                                            \
-        {                                               \
-            parent = NO_INDEX;                          \
-        }                                               \
-        parent;                                         \
-    })
+    // total size of all free regions, in bytes
+    unsigned int free_bytes;
 
+} stack_control_block_t;
 
-#define GET_NEXT_LOWEST_STACK_INDEX(_index)                                     \
-    __extension__ ({                                                            \
-        int current = _index;                                                   \
-        int lowest_index;                                                       \
-        while(PARENT_INDEX(current) != NO_INDEX && IS_LEFT_CHILD(current))      \
-        {                                                                       \
-            current = PARENT_INDEX(current);                                    \
-        }                                                                       \
-        if(current == 0)                                                        \
-        {                                                                       \
-            lowest_index = ABSOLUTE_BOTTOM;                                     \
-        }                                                                       \
-        else                                                                    \
-        {                                                                       \
-            lowest_index = PARENT_INDEX(current);                               \
-        }                                                                       \
-        lowest_index;                                                           \
-    })
 
+#define STACK_ALIGNMENT     8
+#define STACK_PAINT_WORD    0xA5A5A5A5
 
-#define GET_NEXT_HIGHEST_STACK_INDEX(_index)                                    \
-    __extension__ ({                                                            \
-        int current = _index;                                                   \
-        int highest_index;                                                      \
-        while(PARENT_INDEX(current) != NO_INDEX && IS_RIGHT_CHILD(current))     \
-        {                                                                       \
-            current = PARENT_INDEX(current);                                    \
-        }                                                                       \
-        if(current == 0)                                                        \
-        {                                                                       \
-            highest_index = ABSOLUTE_TOP;                                       \
-        }                                                                       \
-        else                                                                    \
-        {                                                                       \
-            highest_index = PARENT_INDEX(current);                              \
-        }                                                                       \
-        highest_index;                                                          \
-    })
+#define ALIGN_STACK_UP(_value)      (((_value) + STACK_ALIGNMENT - 1) & ~(STACK_ALIGNMENT - 1))
+#define ALIGN_STACK_DOWN(_value)    ((_value) & ~(STACK_ALIGNMENT - 1))
 
 
 
 
 /*
  * Task table data type used for storing currently existing tasks. Maintains
- * the current number of tasks on the system, as well as the head task, tail task
- * and the task linked list. Task control blocks (TCBs) are stored in a hash 
- * table where each TCB has pointers to the previous and next TCB. Thus the 
- * linked list structure is overlayed on top of the hash table data structure.
+ * the current number of tasks on the system, the currently running task and
+ * the ready lists used for scheduling. Task control blocks (TCBs) are stored
+ * in an array, and each runnable TCB is also linked into the circular ready
+ * list for its priority. Thus the ready lists are overlayed on top of the
+ * task array.
+ *
+ * The ready bitmap has one bit per priority level, which is set whenever the
+ * ready list for that priority is non-empty. Priority 0 is stored in the most
+ * significant bit so that the highest priority runnable task can be found
+ * with a single count-leading-zeros instruction, independent of how many
+ * tasks exist or how many of them are blocked.
  */
 typedef struct TASK_TABLE
 {
@@ -318,13 +420,56 @@ typedef struct TASK_TABLE
     task_control_block_t *root;
     task_control_block_t *current_task;
 
-    unsigned int next_available_task_number;
-
     stack_control_block_t task_stacks;
 
     // bitmap uses MAX_TASKS (32) bits 
     uint32_t free_task_bitmap;
 
+    // bitmap uses NUM_PRIORITIES (32) bits
+    uint32_t ready_bitmap;
+
+    // head of the circular ready list for each priority
+    task_control_block_t *ready_lists[NUM_PRIORITIES];
+
+    /*
+     * Ready real-time tasks, sorted by absolute deadline so
+     * the head is always the next to run. Not circular.
+     */
+    task_control_block_t *rt_ready_list;
+
+    // bitmap uses MAX_TASKS (32) bits, set for real-time tasks
+    uint32_t realtime_bitmap;
+
+    // total utilization reserved by admitted real-time tasks
+    unsigned int rt_utilization;
+
+    /*
+     * Earliest tick at which a real-time job is released or
+     * reaches its deadline, or RT_NO_EVENT. Lets the tick
+     * handler skip the real-time tasks on most ticks.
+     */
+    unsigned int rt_next_event;
+
+    /*
+     * Sleeping tasks and tasks waiting with a timeout, in the
+     * order they wake up. This is a delta list: the head wakes at
+     * sleep_wake_tick and every other task sleep_delta ticks after
+     * the one before it, so the tick handler only ever compares
+     * against the head and a task is removed from anywhere in the
+     * list in constant time.
+     */
+    task_control_block_t *sleep_list;
+    unsigned int sleep_wake_tick;
+
+    /*
+     * Runs when no task is ready. Kept outside of the task
+     * array so it never takes up a task slot or task ID.
+     */
+    task_control_block_t idle_task;
+
+    // cycle count when the current task was switched onto the CPU
+    unsigned int switch_timestamp;
+
     // stores the registers the kernel is using
     uint32_t kernel_regs[NUM_REGS];
 
@@ -339,14 +484,18 @@ typedef struct TASK_TABLE
  * to keep track of which indices into the task
  * table are free for use.
  */
-#define SET_TASK_FREE(_task_table, _task_index)                 \
-    unsigned int mask = 0x1;                                    \
-    (_task_table)->free_task_bitmap |= (mask << _task_index);
+#define SET_TASK_FREE(_task_table, _task_index)                     \
+    {                                                               \
+        unsigned int mask = 0x1;                                    \
+        (_task_table)->free_task_bitmap |= (mask << _task_index);   \
+    }
 
 
-#define SET_TASK_IN_USE(_task_table, _task_index)               \
-    unsigned int mask = 0x1;                                    \
-    (_task_table)->free_task_bitmap &= ~(mask << _task_index);
+#define SET_TASK_IN_USE(_task_table, _task_index)                   \
+    {                                                               \
+        unsigned int mask = 0x1;                                    \
+        (_task_table)->free_task_bitmap &= ~(mask << _task_index);  \
+    }
 
 
 
@@ -361,44 +510,207 @@ typedef struct TASK_TABLE
 
 #define GET_NEXT_FREE_TASK_INDEX(_task_table)                               \
     __extension__ ({                                                        \
-        int free_index;                                                     \
-        for(free_index = 0; free_index < MAX_TASKS; free_index++)           \
+        int free_index = -1;                                                \
+        if((_task_table)->free_task_bitmap != 0)                            \
         {                                                                   \
-            if(IS_TASK_FREE(_task_table, free_index))                       \
-            {                                                               \
-                break;                                                      \
-            }                                                               \
+            free_index = __builtin_ctz((_task_table)->free_task_bitmap);    \
         }                                                                   \
-        if(free_index == MAX_TASKS) free_index = -1;                        \
+        if(free_index >= MAX_TASKS) free_index = -1;                        \
         free_index;                                                         \
     })
 
 
 
+/*
+ * These macros manipulate the ready bitmap. Priority 0
+ * maps to the most significant bit, so the highest ready
+ * priority is the number of leading zeros in the bitmap.
+ * On MIPS32, __builtin_clz compiles to the clz instruction.
+ * HIGHEST_READY_PRIORITY is undefined if no task is ready.
+ */
+#define PRIORITY_MASK(_priority)    (0x80000000u >> (_priority))
+
+#define SET_PRIORITY_READY(_task_table, _priority)                  \
+    (_task_table)->ready_bitmap |= PRIORITY_MASK(_priority);
+
+#define SET_PRIORITY_EMPTY(_task_table, _priority)                  \
+    (_task_table)->ready_bitmap &= ~PRIORITY_MASK(_priority);
+
+#define HIGHEST_READY_PRIORITY(_task_table)                         \
+    __extension__ ({                                                \
+        int priority;                                               \
+        priority = __builtin_clz((_task_table)->ready_bitmap);      \
+        priority;                                                   \
+    })
+
+#define IS_ANY_TASK_READY(_task_table)                              \
+    ((_task_table)->ready_bitmap != 0 || (_task_table)->rt_ready_list != NULL_POINTER)
+
+
+
 
 
 void task_table_init(task_table_t *table);
 void schedule_next_task(task_table_t *table);
+
+
+/*
+ * Returns the task control block for the given task ID, or
+ * NULL_POINTER if no such task exists. IDs of tasks that have
+ * been freed are rejected even after their slot is reused.
+ */
 task_control_block_t *get_task(task_table_t *table, int task_id);
 
+
+/*
+ * Moves a task onto the tail of the ready list for its
+ * priority, or takes it off the ready list and blocks it.
+ * Both run in constant time.
+ */
+void set_task_ready(task_table_t *table, task_control_block_t *task);
+void set_task_blocked(task_table_t *table, task_control_block_t *task);
+
+/*
+ * Changes the priority a task is scheduled at, moving it to
+ * the ready list for the new priority if it is ready. Does not
+ * change its base priority.
+ */
+void set_task_priority(task_table_t *table, task_control_block_t *task, unsigned int priority);
+
+/*
+ * Moves a task into the given scheduling class, requeueing
+ * it if it is ready. The caller sets up the class-specific
+ * state (priority or real-time state) beforehand.
+ */
+void set_task_sched_class(task_table_t *table, task_control_block_t *task, unsigned int sched_class);
+
 taskid_t get_current_task(task_table_t *table);
 
 int set_task_register_value(task_table_t *table, int task_id, int register_number, unsigned int value);
 
 
 /*
- * Creates a new task to run the given function. 
- * Returns the task id of the created task.
+ * Creates a new task to run the given function at the given
+ * priority, with a stack of at least stack_size bytes, or of
+ * DEFAULT_STACK_SIZE bytes if stack_size is 0. Returns the task
+ * id of the created task.
  */ 
-taskid_t create_task(task_table_t *table, int parent_task_id, void *function);
+taskid_t create_task(task_table_t *table, int parent_task_id, void *function, unsigned int priority, unsigned int stack_size);
+
+
+/*
+ * Returns the largest number of bytes of its stack that the
+ * task has used so far, or ERROR_TASK_NOT_FOUND.
+ */
+int get_stack_high_water_mark(task_table_t *table, int task_id);
+
+
+/*
+ * Copies the CPU accounting of a task into stats. The run time
+ * of the current task includes the time since it was switched
+ * in. Returns 0 or ERROR_TASK_NOT_FOUND.
+ */
+int get_task_stats(task_table_t *table, int task_id, task_stats_t *stats);
+
+
+/*
+ * Returns the task's slot and stack region to the task table
+ * and invalidates its task ID.
+ */
+void free_task(task_table_t *table, task_control_block_t *task);
+
+/*
+ * Turns the task into a zombie holding the exit status. Its
+ * children are handed to the root task. If its parent is
+ * waiting for it, the task is reaped at once and the parent
+ * is made ready with the task's ID as its syscall return value.
+ * The caller reschedules if the task was the current task.
+ */
+void exit_task(task_table_t *table, task_control_block_t *task, int status);
+
+/*
+ * Reaps the child task_id of the current task, or any child
+ * if task_id is WAIT_ANY_CHILD, and returns its ID, storing
+ * its exit status through status if that is not NULL_POINTER.
+ * If no such child has exited yet, the current task is blocked
+ * until one does and the return value is meaningless; the child
+ * writes the real one into the task's V0 register. Returns
+ * ERROR_NO_CHILDREN or ERROR_TASK_NOT_FOUND if there is nothing
+ * to wait for.
+ */
+int wait_task(task_table_t *table, taskid_t task_id, int *status);
+
+
+/*
+ * Wait queues. Blocking takes the task off the CPU or its ready
+ * list; the caller reschedules if it blocked the current task.
+ * Waking makes the tasks ready in the order they blocked.
+ */
+void wait_queue_init(wait_queue_t *queue);
+void wait_queue_block(task_table_t *table, wait_queue_t *queue, task_control_block_t *task);
+void wait_queue_remove(wait_queue_t *queue, task_control_block_t *task);
+
+/*
+ * Priority of a task as a waiter. Real-time tasks run ahead of
+ * every best-effort task, so they wait as priority 0.
+ */
+#define TASK_WAIT_PRIORITY(_task)   \
+    (((_task)->sched_class == SCHED_CLASS_REALTIME) ? 0 : (_task)->priority)
+
+/*
+ * Blocks the task on a queue kept in order of TASK_WAIT_PRIORITY,
+ * behind any waiters of the same priority, so waking one task
+ * always wakes the highest priority waiter in constant time.
+ */
+void wait_queue_block_by_priority(task_table_t *table, wait_queue_t *queue, task_control_block_t *task);
+task_control_block_t *wait_queue_wake_one(task_table_t *table, wait_queue_t *queue);
+void wait_queue_wake_all(task_table_t *table, wait_queue_t *queue);
+
+
+// longest sleep, since tick counts are compared as signed differences
+#define SLEEP_MAX_TICKS     0x7FFFFFFF
+
+/*
+ * Timeouts of calls that may block. WAIT_POLL fails at once
+ * instead of blocking and WAIT_FOREVER never times out. Any
+ * other timeout is a number of ticks, up to SLEEP_MAX_TICKS.
+ */
+#define WAIT_POLL           0
+#define WAIT_FOREVER        0xFFFFFFFF
+
+#define IS_TASK_SLEEPING(_task_table, _task)    \
+    ((_task)->previous_sleeper != NULL_POINTER || (_task_table)->sleep_list == (_task))
+
+/*
+ * Blocks the task in the sleep list until the system tick count
+ * reaches wake_tick, and returns 1. If wake_tick is not after
+ * now, the task does not block and 0 is returned. The caller
+ * reschedules if it blocked the current task.
+ */
+int sleep_task_until(task_table_t *table, task_control_block_t *task, unsigned int wake_tick, unsigned int now);
+
+/*
+ * Gives a task that was just blocked on a wait queue a timeout
+ * of the given number of ticks from now, unless the timeout is
+ * WAIT_FOREVER. If the task is still waiting when it runs out,
+ * it is taken off the queue and made ready with ERROR_TIMED_OUT
+ * as its syscall return value. Waking it any other way cancels
+ * the timeout.
+ */
+void set_task_timeout(task_table_t *table, task_control_block_t *task, unsigned int timeout, unsigned int now);
+
+/*
+ * Called from the tick handler after the system tick count has
+ * been advanced. Makes every task that is due to wake ready, a
+ * sleeping task with the tick it woke at as its syscall return
+ * value and a task whose wait timed out with ERROR_TIMED_OUT.
+ * Costs a single compare on ticks where no task wakes.
+ */
+void wake_sleeping_tasks(task_table_t *table, unsigned int now);
+
 void kill_task(unsigned int task_id);   // kills all children as well
-void exit_task(task_table_t *table);    // parent inherits children
 void run_task(int task_id);
 void yield_task(int task_id);
-void sleep_task(task_table_t *table);
-
-// stops the current task from running and sets it into the idle state
-void wait_on_task();
 
 
 
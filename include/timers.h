@@ -3,8 +3,10 @@
 
 
 #include "stdlib.h"
+#include "config.h"
 
-#define MAX_TIMERS 256
+// set by CONFIG_MAX_TIMERS in kernel.cfg
+#define MAX_TIMERS CONFIG_MAX_TIMERS
 #define MAX_TIMER_CALLBACKS 64
 
 #define TIMER_TYPE_REPEATING    0
@@ -15,6 +17,17 @@
 #define TIMER_SIZE_32_BITS      1
 
 
+/*
+ * Software timers are driven by the system tick, which
+ * occurs TICK_RATE_HZ times per second. Tick counts are
+ * allowed to wrap, so they must always be compared by
+ * taking their difference.
+ */
+#define TICK_RATE_HZ            1000
+
+#define TIMER_NO_EXPIRY         0xFFFFFFFF
+
+
 /*
  * Entry in the timer callback function table.
  * This structure is used since storing a full
@@ -130,7 +143,14 @@ typedef struct TIMER
     unsigned int callback_function_index:6;
     unsigned int type:2;
 
-} software_timer_t __attribute__((packed));
+    // number of expiries left for TIMER_TYPE_REPEAT_N timers
+    unsigned short repeats_left;
+
+    // tick at which the timer next expires and its period in ticks
+    unsigned int expiry;
+    unsigned int period;
+
+} software_timer_t;
 
 
 typedef struct TIMER_CONTROL_BLOCK
@@ -139,6 +159,18 @@ typedef struct TIMER_CONTROL_BLOCK
     char timer_bitmap[MAX_TIMERS/8];
     int num_timers;
 
+    // number of system ticks since boot
+    unsigned int ticks;
+
+    /*
+     * Earliest expiry of all pending timers, or
+     * TIMER_NO_EXPIRY if none are pending. Lets the
+     * tick handler return immediately on ticks where
+     * nothing expires, and lets the idle task know
+     * how long it may sleep.
+     */
+    unsigned int next_expiry;
+
 } timer_control_block_t;
 
 
@@ -215,11 +247,34 @@ typedef struct SYSTEM_TIME
  * Timer type will also store the number of times to repeat
  * if it is of type repeat n. The return value is the timer
  * number, which can be used to interact with the timer afterward.
+ * A repeat n timer needs a repeat of at least 1, or -1 is returned.
  */
 int start_timer(int type, int repeat, timer_info_t *info, timer_callback_t callback_function);
 void get_system_time(system_time_t *system_time);
 void cancel_timer(int timer_number);
 
+void init_timer_system();
+unsigned int get_system_ticks();
+
+/*
+ * Returns the tick at which the earliest pending timer
+ * expires, or TIMER_NO_EXPIRY if no timers are pending.
+ */
+unsigned int get_next_timer_expiry();
+
+
+/**********************************
+ * Tick timer interface functions *
+ **********************************/
+
+/*
+ * Called by the tick timer interrupt with the number of
+ * ticks that have elapsed since it was last called. This
+ * is usually 1, but is larger after the idle task has
+ * slept through several ticks. Runs any expired timers.
+ */
+void timer_tick(unsigned int elapsed_ticks);
+
 
 /*************************************
  * Device Driver Interface functions *
@@ -0,0 +1,124 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+
+/*
+ * Event trace. With CONFIG_TRACE set in kernel.cfg, the kernel
+ * records context switches, system call entry and exit,
+ * interrupt entry and exit and software timer expiries into a
+ * ring of fixed size records in RAM, each stamped with the cycle
+ * counter. Without it, TRACE compiles to nothing.
+ *
+ * Recording an event takes the three stores in trace_record and
+ * no lock. An interrupt that records an event between another
+ * event reserving its slot and filling it in may have its record
+ * overwritten, which costs one record but never corrupts the
+ * ring.
+ *
+ * The buffer starts with a header that describes it, so it can
+ * be found in a RAM image by its magic number as well as sent
+ * whole over a UART by trace_dump. scripts/trace_to_json.py
+ * converts either into Chrome trace JSON for Perfetto.
+ */
+
+
+#define TRACE_MAGIC             0x4352544D  // "MTRC" in memory on little endian targets
+#define TRACE_VERSION           1
+
+#define TRACE_EVENT_SWITCH          1   // data is the ID of the task switched in
+#define TRACE_EVENT_SYSCALL_ENTER   2   // data is the system call code
+#define TRACE_EVENT_SYSCALL_EXIT    3
+#define TRACE_EVENT_ISR_ENTER       4   // data is the interrupt vector
+#define TRACE_EVENT_ISR_EXIT        5
+#define TRACE_EVENT_TIMER_EXPIRY    6   // data is the software timer index
+
+#define TRACE_DATA_MASK         0x00FFFFFF
+#define TRACE_EVENT_SHIFT       24
+
+// data recorded for the idle task, which has no task ID
+#define TRACE_IDLE_TASK         TRACE_DATA_MASK
+
+
+// the event numbers above are also used by syscall_dispatch.S
+#ifndef __ASSEMBLER__
+
+
+#include <stdint.h>
+
+#include "config.h"
+#include "hardware.h"
+
+
+#define TRACE_BUFFER_SIZE       CONFIG_TRACE_BUFFER_SIZE
+
+
+typedef struct TRACE_RECORD
+{
+    uint32_t timestamp;
+
+    // event in the top 8 bits and its data in the rest
+    uint32_t info;
+
+} trace_record_t;
+
+
+/*
+ * Layout shared with scripts/trace_to_json.py. All fields are
+ * 32-bit words in the target's byte order.
+ */
+typedef struct TRACE_BUFFER
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_records;
+    uint32_t counter_frequency;
+
+    // free-running count of records written, the oldest is at next - num_records
+    uint32_t next;
+
+    trace_record_t records[TRACE_BUFFER_SIZE];
+
+} trace_buffer_t;
+
+
+
+#ifdef CONFIG_TRACE
+
+extern trace_buffer_t trace_buffer;
+
+static inline void trace_record(unsigned int event, unsigned int data)
+{
+    trace_record_t *record = &trace_buffer.records[trace_buffer.next++ & (TRACE_BUFFER_SIZE - 1)];
+
+    record->timestamp = read_cycle_counter();
+    record->info = (event << TRACE_EVENT_SHIFT) | (data & TRACE_DATA_MASK);
+}
+
+#define TRACE(_event, _data)    trace_record((_event), (unsigned int) (_data))
+
+#else
+
+#define TRACE(_event, _data)    ((void) 0)
+
+#endif
+
+
+
+// fills in the header and empties the ring
+void trace_init(trace_buffer_t *buffer);
+
+// out of line trace_record, for assembly
+void trace_event(unsigned int event, unsigned int data);
+
+/*
+ * Passes the whole buffer, header first, to write, such as a
+ * function sending it over a UART. Recording is not stopped, so
+ * events recorded during the dump may show up in it.
+ */
+void trace_dump(trace_buffer_t *buffer, void (*write)(const void *data, unsigned int size));
+
+
+#endif /* __ASSEMBLER__ */
+
+
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Deferred work queue and its worker task. See deferred_work.h.
+ */
+
+#include "deferred_work.h"
+#include "hardware.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern deferred_work_queue_t deferred_work_queue;
+
+
+#define DEFERRED_WORK_INDEX_MASK    (DEFERRED_WORK_QUEUE_SIZE - 1)
+
+
+
+void deferred_work_queue_init(deferred_work_queue_t *queue)
+{
+    queue->head = 0;
+    queue->tail = 0;
+    semaphore_init(&queue->pending, 0);
+
+    queue->completed = 0;
+    queue->dropped = 0;
+    queue->max_latency = 0;
+    queue->total_latency = 0;
+    queue->worker = TASK_ID_NONE;
+}
+
+
+taskid_t init_deferred_work(task_table_t *table)
+{
+    taskid_t worker;
+
+    deferred_work_queue_init(&deferred_work_queue);
+
+    worker = create_task(table, table->root->task_id, deferred_work_task, DEFERRED_WORK_PRIORITY, DEFERRED_WORK_STACK_SIZE);
+
+    if(worker >= 0)
+    {
+        deferred_work_queue.worker = worker;
+    }
+
+    return worker;
+}
+
+
+int defer_work(task_table_t *table, deferred_work_queue_t *queue, deferred_work_function_t function, void *data, uint32_t value)
+{
+    unsigned int were_enabled = save_and_disable_interrupts();
+    deferred_work_t *item;
+    int result = 0;
+
+    if(queue->tail - queue->head >= DEFERRED_WORK_QUEUE_SIZE)
+    {
+        queue->dropped++;
+        restore_interrupts(were_enabled);
+
+        return ERROR_DEFERRED_WORK_FULL;
+    }
+
+    item = &queue->items[queue->tail & DEFERRED_WORK_INDEX_MASK];
+    item->function = function;
+    item->data = data;
+    item->value = value;
+    item->post_timestamp = read_cycle_counter();
+
+    // the worker only needs waking for the first item, since it drains the queue before waiting
+    if(queue->tail++ == queue->head)
+    {
+        result = semaphore_post(table, &queue->pending);
+    }
+
+    restore_interrupts(were_enabled);
+
+    return result;
+}
+
+
+unsigned int run_deferred_work(deferred_work_queue_t *queue)
+{
+    deferred_work_t item;
+    unsigned int latency, count = 0;
+
+    while(1)
+    {
+        // copied out before the slot is freed, since an interrupt may post into it right after
+        disable_interrupts();
+
+        if(queue->head == queue->tail)
+        {
+            enable_interrupts();
+            break;
+        }
+
+        item = queue->items[queue->head & DEFERRED_WORK_INDEX_MASK];
+        queue->head++;
+
+        enable_interrupts();
+
+        latency = read_cycle_counter() - item.post_timestamp;
+        queue->total_latency += latency;
+
+        if(latency > queue->max_latency)
+        {
+            queue->max_latency = latency;
+        }
+
+        item.function(item.data, item.value);
+
+        queue->completed++;
+        count++;
+    }
+
+    return count;
+}
+
+
+void deferred_work_task()
+{
+    while(1)
+    {
+        run_deferred_work(&deferred_work_queue);
+        kernel_semaphore_wait(&deferred_work_queue.pending);
+    }
+}
@@ -21,6 +21,23 @@ extern driver_table_t driver_table;
 extern superblock_t *ramdisk_superblock;
 
 
+char *dev_file_names[] = {
+    [DRIVER_TYPE_UART] = "uart",
+    [DRIVER_TYPE_SPI] = "spi",
+    [DRIVER_TYPE_I2C] = "i2c",
+    [DRIVER_TYPE_CAN] = "can",
+    [DRIVER_TYPE_TIMER] = "timer",
+    [DRIVER_TYPE_ADC] = "adc",
+    [DRIVER_TYPE_PWM] = "pwm",
+    [DRIVER_TYPE_DAC] = "dac",
+    [DRIVER_TYPE_HDD] = "hdd",
+    [DRIVER_TYPE_SSD] = "ssd",
+    [DRIVER_TYPE_ETHERNET] = "eth",
+    [DRIVER_TYPE_WIFI] = "wifi",
+    [DRIVER_TYPE_BLUETOOTH] = "bluetooth"
+};
+
+
 
 int ring_buffer_init(ring_buffer_t *ring_buffer, int buf_size)
 {
@@ -0,0 +1,115 @@
+/*
+ * Event flag groups. See event.h.
+ */
+
+#include "event.h"
+
+
+
+/*
+ * Returns the flags from the wait's mask that are set in the
+ * group, or 0 if the wait is not satisfied yet.
+ */
+static uint32_t matched_flags(event_flags_t *group, event_wait_t *wait)
+{
+    uint32_t matched = group->flags & wait->mask;
+
+    if((wait->options & EVENT_WAIT_ALL) && matched != wait->mask)
+    {
+        return 0;
+    }
+
+    return matched;
+}
+
+
+static void complete_wait(event_flags_t *group, event_wait_t *wait, uint32_t matched)
+{
+    wait->flags = matched;
+
+    if(wait->options & EVENT_CLEAR)
+    {
+        group->flags &= ~matched;
+    }
+}
+
+
+
+void event_flags_init(event_flags_t *group)
+{
+    group->flags = 0;
+    wait_queue_init(&group->waiters);
+}
+
+
+int event_flags_wait(task_table_t *table, task_control_block_t *task, event_flags_t *group, event_wait_t *wait, unsigned int now)
+{
+    uint32_t matched;
+
+    if(wait->mask == 0)
+    {
+        return ERROR_EVENT_INVALID_MASK;
+    }
+
+    matched = matched_flags(group, wait);
+
+    if(matched != 0)
+    {
+        complete_wait(group, wait, matched);
+        return 0;
+    }
+
+    if(wait->timeout == WAIT_POLL)
+    {
+        return ERROR_TIMED_OUT;
+    }
+
+    wait_queue_block_by_priority(table, &group->waiters, task);
+    task->event_wait = wait;
+    set_task_timeout(table, task, wait->timeout, now);
+
+    return 0;
+}
+
+
+int event_flags_set(task_table_t *table, event_flags_t *group, uint32_t flags)
+{
+    task_control_block_t *task = group->waiters.head;
+    task_control_block_t *next;
+    int preempt = 0;
+
+    group->flags |= flags;
+
+    // in priority order, so flags cleared on wakeup go to the highest priority waiter
+    while(task != NULL_POINTER && group->flags != 0)
+    {
+        uint32_t matched = matched_flags(group, task->event_wait);
+
+        next = task->next_task;
+
+        if(matched != 0)
+        {
+            complete_wait(group, task->event_wait, matched);
+
+            wait_queue_remove(&group->waiters, task);
+            task->event_wait = NULL_POINTER;
+            task->regs[REGISTER_V0] = 0;
+            set_task_ready(table, task);
+
+            if(TASK_WAIT_PRIORITY(task) < TASK_WAIT_PRIORITY(table->current_task))
+            {
+                preempt = 1;
+            }
+        }
+
+        task = next;
+    }
+
+    return preempt;
+}
+
+
+void event_flags_clear(event_flags_t *group, uint32_t flags)
+{
+    group->flags &= ~flags;
+}
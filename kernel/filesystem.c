@@ -5,10 +5,19 @@
 #include "fs_archive.h"
 #include "kdefs.h"
 #include "device_driver_subsystem.h"
+#include "pipe.h"
 
 extern superblock_t *ramdisk_superblock;
 extern filesystem_archive_t fs_archive[];
 extern driver_table_t driver_table;
+extern open_file_table_t open_file_table;
+extern pipe_table_t pipe_table;
+extern task_table_t task_table;
+
+
+// used before they are defined
+static void set_block_in_use(superblock_t *superblock, block_number_t block_number);
+static inode_t *get_inode(superblock_t *superblock, inode_number_t inode_number);
 
 
 /*
@@ -43,6 +52,10 @@ void init_filesystem()
 
     unpack_filesystem_archive(fs_archive);
 
+    // no files are open and no pipes exist yet
+    memset(&open_file_table.free_spot_bitmap, 0xff, MAX_OPEN_FILES/8);
+    pipe_table_init(&pipe_table);
+
     // TODO: add dev filesystem
 }
 
@@ -501,7 +514,7 @@ static block_number_t append_new_file_block(superblock_t *superblock, inode_t *i
 
         // get block, set in use, and add to double indirect list
         block_number = get_next_free_block_number(superblock);
-        set_block_in_use(block_number);
+        set_block_in_use(superblock, block_number);
         double_indirect_blocks[double_indirect_index] = block_number;
     }
 
@@ -734,10 +747,18 @@ int open_file(superblock_t *superblock, inode_number_t current_dir, open_file_ta
 
 int close_file(superblock_t *superblock, open_file_table_t *open_file_table, int file_descriptor)
 {
-    inode_t *inode = get_inode(superblock, open_file_table->open_files[file_descriptor].inode_number);
+    inode_number_t inode_number = open_file_table->open_files[file_descriptor].inode_number;
+    inode_t *inode = get_inode(superblock, inode_number);
+    int preempt = 0;
 
     switch (inode->file_type)
     {
+    case FILE_TYPE_PIPE:
+        // each end of a pipe is only ever open once, so its inode goes with it
+        preempt = close_pipe_end(&task_table, &pipe_table, GET_PIPE_INDEX(inode), GET_PIPE_END(inode));
+        set_inode_free(superblock, inode_number);
+        break;
+
     case FILE_TYPE_CHAR:
         driver_table.drivers[GET_DRIVER_TYPE(inode)].u.chardev.open(GET_DEVICE_NUMBER(inode));
         break;
@@ -774,7 +795,7 @@ int close_file(superblock_t *superblock, open_file_table_t *open_file_table, int
     set_open_file_free(open_file_table, file_descriptor);
 
 
-    return 0;
+    return preempt;
 }
 
 
@@ -794,6 +815,14 @@ int read_file(inode_t *inode, void *buffer, unsigned short offset, unsigned shor
 
     switch (inode->file_type)
     {
+    case FILE_TYPE_PIPE:
+    {
+        // system calls use read_pipe_file directly, to reschedule for a woken writer
+        int preempt;
+
+        return read_pipe_file(inode, buffer, size, &preempt);
+    }
+
     case FILE_TYPE_CHAR:
         bytes_read = driver_table.drivers[GET_DRIVER_TYPE(inode)].u.chardev.read(GET_DEVICE_NUMBER(inode), buffer, size);
         break;
@@ -870,6 +899,13 @@ int write_file(superblock_t *superblock, inode_t *inode, void *buffer, unsigned
 
     switch (inode->file_type)
     {
+    case FILE_TYPE_PIPE:
+    {
+        int preempt;
+
+        return write_pipe_file(inode, buffer, size, &preempt);
+    }
+
     case FILE_TYPE_CHAR:
         bytes_written = driver_table.drivers[GET_DRIVER_TYPE(inode)].u.chardev.write(GET_DEVICE_NUMBER(inode), buffer, size);
         break;
@@ -1003,6 +1039,112 @@ int create_file(superblock_t *superblock, inode_number_t current_dir, int type,
 
 
 
+/*
+ * Takes a free inode for one end of a pipe. It is never linked
+ * into a directory and never given any blocks.
+ */
+static inode_number_t create_pipe_inode(superblock_t *superblock, int pipe_index, int end)
+{
+    inode_number_t inode_number = get_next_free_inode_number(superblock);
+    inode_t *inode;
+
+    if(inode_number < 0)
+    {
+        return INODE_NONE;
+    }
+
+    set_inode_in_use(superblock, inode_number);
+
+    inode = get_inode(superblock, inode_number);
+    memset(inode->block_numbers, 0, INODE_BLOCK_LIST_SIZE*sizeof(block_number_t));
+    inode->file_type = FILE_TYPE_PIPE;
+    inode->file_size = 0;
+    inode->major_and_minor = PIPE_MAJOR_AND_MINOR(pipe_index, end);
+
+    return inode_number;
+}
+
+
+int read_pipe_file(inode_t *inode, void *buffer, unsigned short size, int *preempt)
+{
+    *preempt = 0;
+
+    if(GET_PIPE_END(inode) != PIPE_READ_END)
+    {
+        return ERROR_PIPE_WRONG_END;
+    }
+
+    // may block the current task, in which case the writer stores the real return value
+    return pipe_read(&task_table, task_table.current_task, &pipe_table.pipes[GET_PIPE_INDEX(inode)], buffer, size, preempt);
+}
+
+
+int write_pipe_file(inode_t *inode, void *buffer, unsigned short size, int *preempt)
+{
+    *preempt = 0;
+
+    if(GET_PIPE_END(inode) != PIPE_WRITE_END)
+    {
+        return ERROR_PIPE_WRONG_END;
+    }
+
+    return pipe_write(&task_table, task_table.current_task, &pipe_table.pipes[GET_PIPE_INDEX(inode)], buffer, size, preempt);
+}
+
+
+int create_pipe(superblock_t *superblock, open_file_table_t *open_file_table, int *file_descriptors)
+{
+    int pipe_index = allocate_pipe(&pipe_table);
+    int end;
+
+    if(pipe_index < 0)
+    {
+        return pipe_index;
+    }
+
+    for(end = PIPE_READ_END; end <= PIPE_WRITE_END; end++)
+    {
+        inode_number_t inode_number = create_pipe_inode(superblock, pipe_index, end);
+        int open_file_index = find_first_free_open_file(open_file_table);
+
+        if(inode_number == INODE_NONE || open_file_index == OPEN_FILE_TABLE_FULL)
+        {
+            if(inode_number != INODE_NONE)
+            {
+                set_inode_free(superblock, inode_number);
+            }
+
+            break;
+        }
+
+        set_open_file_in_use(open_file_table, open_file_index);
+        open_file_table->open_files[open_file_index].cursor = 0;
+        open_file_table->open_files[open_file_index].inode_number = inode_number;
+
+        file_descriptors[end] = open_file_index;
+    }
+
+    // out of inodes or open files, so undo whatever was done
+    if(end <= PIPE_WRITE_END)
+    {
+        if(end == PIPE_WRITE_END)
+        {
+            close_file(superblock, open_file_table, file_descriptors[PIPE_READ_END]);
+        }
+        else
+        {
+            close_pipe_end(&task_table, &pipe_table, pipe_index, PIPE_READ_END);
+        }
+
+        close_pipe_end(&task_table, &pipe_table, pipe_index, PIPE_WRITE_END);
+
+        return OPEN_FILE_TABLE_FULL;
+    }
+
+    return 0;
+}
+
+
 int delete_file(superblock_t *superblock, inode_number_t current_dir, open_file_table_t *open_file_table, char *file_path)
 {
     int open_file_index;
@@ -15,6 +15,11 @@
 #include "kheap.h"
 #include "device_driver_subsystem.h"
 #include "timers.h"
+#include "pipe.h"
+#include "deferred_work.h"
+#include "trace.h"
+#include "kernel_data.h"
+#include "syscall_stats.h"
 
 
 // task table
@@ -43,6 +48,15 @@ uint32_t *current_task_register_base;
 uint32_t *kernel_register_base;
 
 
+/*
+ * Set by a system call handler when the caller blocks, or wakes
+ * a task that should preempt it. The system call return path
+ * only runs the scheduler when it is set, and otherwise returns
+ * straight to the caller.
+ */
+unsigned int need_resched;
+
+
 /*
  * Address of the base of the
  * RAMdisk allows the OS to find
@@ -62,6 +76,25 @@ heap_cb_t kernel_heap_cb;
 
 open_file_table_t open_file_table;
 
+pipe_table_t pipe_table;
+
+// work posted by interrupt handlers for the worker task
+deferred_work_queue_t deferred_work_queue;
+
+#ifdef CONFIG_TRACE
+trace_buffer_t trace_buffer;
+#endif
+
+#ifdef CONFIG_SYSCALL_STATS
+syscall_stats_t syscall_stats;
+#endif
+
+/*
+ * Read by tasks with plain loads, so it is placed at the bottom
+ * of user data RAM rather than with the rest of the kernel data.
+ */
+kernel_data_page_t kernel_data_page KERNEL_DATA_PAGE_SECTION;
+
 
 
 driver_table_t driver_table;
@@ -74,6 +107,12 @@ void switch_task_regs()
 }
 
 
+void update_kernel_data()
+{
+    update_kernel_data_page(&kernel_data_page, &task_table, get_system_ticks());
+}
+
+
 
 
 
@@ -0,0 +1,172 @@
+/*
+ * Idle task. Runs whenever no other task is ready and keeps
+ * the processor asleep until the next interrupt. Instead of
+ * waking on every tick, it programs the tick timer for the
+ * earliest pending software timer so that the processor
+ * sleeps through ticks on which nothing would happen.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "idle.h"
+#include "task.h"
+#include "timers.h"
+#include "hardware.h"
+#include "syscall_stats.h"
+
+#ifdef CONFIG_SYSCALL_STRACE
+#include "terminal_control.h"
+#endif
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern task_table_t task_table;
+
+#ifdef CONFIG_SYSCALL_STRACE
+extern syscall_stats_t syscall_stats;
+#endif
+
+
+static uint32_t idle_task_stack[IDLE_STACK_WORDS];
+static unsigned int idle_ticks;
+
+
+
+void init_idle_task(task_table_t *table)
+{
+    task_control_block_t *idle = &table->idle_task;
+
+    memset(idle, 0, sizeof(task_control_block_t));
+
+    idle->task_id = TASK_ID_NONE;
+    idle->parent = NULL_POINTER;
+    idle->state = READY;
+    idle->stack.top = &idle_task_stack[IDLE_STACK_WORDS];
+    idle->stack.size = sizeof(idle_task_stack);
+
+    // lowest priority, though the idle task is never put on a ready list
+    idle->priority = NUM_PRIORITIES - 1;
+
+    idle->regs[REGISTER_SP] = (uint32_t)(uintptr_t) &idle_task_stack[IDLE_STACK_WORDS];
+    idle->regs[REGISTER_FP] = (uint32_t)(uintptr_t) &idle_task_stack[IDLE_STACK_WORDS];
+    idle->regs[REGISTER_PC] = (uint32_t)(uintptr_t) idle_task_loop;
+
+    idle_ticks = 0;
+}
+
+
+/*
+ * Shortens the sleep so that the processor wakes for an event
+ * at the given tick, if it is due sooner.
+ */
+static unsigned int limit_sleep_ticks(unsigned int sleep_ticks, unsigned int event, unsigned int now)
+{
+    int ticks_to_event = (int)(event - now);
+
+    if(ticks_to_event < 1)
+    {
+        return 1;
+    }
+
+    return ((unsigned int) ticks_to_event < sleep_ticks) ? (unsigned int) ticks_to_event : sleep_ticks;
+}
+
+
+unsigned int get_idle_sleep_ticks(unsigned int now)
+{
+    unsigned int next_expiry = get_next_timer_expiry();
+    unsigned int sleep_ticks = IDLE_MAX_SLEEP_TICKS;
+
+    if(next_expiry != TIMER_NO_EXPIRY)
+    {
+        sleep_ticks = limit_sleep_ticks(sleep_ticks, next_expiry, now);
+    }
+
+    // a real-time job release also has to wake the processor
+    if(task_table.rt_next_event != RT_NO_EVENT)
+    {
+        sleep_ticks = limit_sleep_ticks(sleep_ticks, task_table.rt_next_event, now);
+    }
+
+    // and so does a sleeping task waking up or a wait timing out
+    if(task_table.sleep_list != NULL_POINTER)
+    {
+        sleep_ticks = limit_sleep_ticks(sleep_ticks, task_table.sleep_wake_tick, now);
+    }
+
+    return sleep_ticks;
+}
+
+
+#ifdef CONFIG_SYSCALL_STRACE
+static void write_strace(const void *data, unsigned int size)
+{
+    for(unsigned int i = 0; i < size; i++)
+    {
+        terminal_send_byte(((const uint8_t *) data)[i]);
+    }
+}
+#endif
+
+
+
+void idle_task_iteration()
+{
+    unsigned int sleep_start;
+
+    if(IS_ANY_TASK_READY(&task_table))
+    {
+        // go back to a tick every tick before handing over the CPU
+        set_tick_wakeup(1);
+        request_reschedule();
+        return;
+    }
+
+#ifdef CONFIG_SYSCALL_STRACE
+    /*
+     * One line per pass, so a task woken meanwhile waits for at
+     * most one line before the check above hands it the CPU.
+     */
+    if(syscall_strace_flush(&syscall_stats, 1, write_strace) > 0)
+    {
+        return;
+    }
+#endif
+
+    /*
+     * Interrupts are disabled while the wakeup is programmed so
+     * that a timer started by an ISR cannot be missed. They are
+     * re-enabled by wait_for_interrupt. An interrupt that slips
+     * in between can at worst delay the wakeup to the programmed
+     * tick, which is never more than IDLE_MAX_SLEEP_TICKS away.
+     */
+    disable_interrupts();
+
+    sleep_start = get_system_ticks();
+    set_tick_wakeup(get_idle_sleep_ticks(sleep_start));
+
+    wait_for_interrupt();
+
+    // woken by an interrupt other than the tick timer, so catch up
+    update_tick_count();
+
+    idle_ticks += get_system_ticks() - sleep_start;
+}
+
+
+void idle_task_loop()
+{
+    while(1)
+    {
+        idle_task_iteration();
+    }
+}
+
+
+unsigned int get_idle_ticks()
+{
+    return idle_ticks;
+}
@@ -6,6 +6,12 @@
 #include "kheap.h"
 #include "filesystem.h"
 #include "stdlib.h"
+#include "timers.h"
+#include "idle.h"
+#include "deferred_work.h"
+#include "trace.h"
+#include "kernel_data.h"
+#include "syscall_stats.h"
 #include <xc.h>
 
 /*
@@ -13,6 +19,11 @@
  */
 extern void create_userspace();
 
+/*
+ * Defined in arch/mips/core_timer.c
+ */
+extern void init_core_timer();
+
 
 /*
  * Defined in global_structs.c
@@ -20,6 +31,7 @@ extern void create_userspace();
 extern task_table_t task_table;
 extern uint32_t *current_task_register_base;
 extern uint32_t *kernel_register_base;
+extern kernel_data_page_t kernel_data_page;
 
 
 /*
@@ -30,12 +42,32 @@ extern heap_cb_t kernel_heap_cb;
 extern void *_ramdisk_begin;
 extern superblock_t *ramdisk_superblock;
 
+#ifdef CONFIG_TRACE
+extern trace_buffer_t trace_buffer;
+#endif
+
+#ifdef CONFIG_SYSCALL_STATS
+extern syscall_stats_t syscall_stats;
+#endif
+
 void init_kernel()
 {
     // disable interrupts
     create_userspace();
 
+#ifdef CONFIG_TRACE
+    trace_init(&trace_buffer);
+#endif
+
+#ifdef CONFIG_SYSCALL_STATS
+    syscall_stats_init(&syscall_stats);
+#endif
+
+    kernel_data_init(&kernel_data_page);
+
     task_table_init(&task_table);
+    init_idle_task(&task_table);
+    update_kernel_data();
 
     current_task_register_base = &task_table.current_task->regs[0];
     kernel_register_base = &task_table.kernel_regs[0];
@@ -43,7 +75,7 @@ void init_kernel()
     store_kernel_context();
     init_heap(&kernel_heap_cb);
     
-    // not configurable right now
+#ifdef CONFIG_USE_FILESYSTEM
     superblock_t superblock;
     superblock.inode_table_start = 2;
     superblock.num_inodes = NUM_INODES;
@@ -52,6 +84,10 @@ void init_kernel()
     memcpy(ramdisk_superblock, &superblock, sizeof(superblock_t));
 
     init_filesystem();
+#endif
+
+    init_timer_system();
+    init_deferred_work(&task_table);
 
     // TODO:
     //////////////////////////////////
@@ -59,6 +95,7 @@ void init_kernel()
     // init interrupts
     DDPCON = 0;
     INTCONbits.MVEC = 1;
+    init_core_timer();
     // register device drivers
     // register device filesystem (takes driver table)
     // stores the kernel context, loads
@@ -29,11 +29,25 @@ SUBMAKES =	shell
 #											#
 #############################################
 
-#KERNEL_SRCS =	filesystem.c		\
+#KERNEL_SRCS =	deferred_work.c		\
+				event.c				\
+				filesystem.c		\
 				global_structs.c	\
+				idle.c				\
+				kernel_data.c		\
 				list.c				\
+				message_queue.c		\
+				mutex.c				\
+				pipe.c				\
+				protothread.c		\
+				realtime.c			\
+				semaphore.c			\
 				syscall.c			\
+				syscall_ring.c		\
+				syscall_stats.c		\
 				task.c				\
+				timers.c			\
+				trace.c				\
 				init.c
 
 KERNEL_SRCS = 
@@ -74,4 +88,4 @@ setup:
 
 
 $(KERNEL_OBJS): $(OBJ_DIR)/%.o: %.c
-	$(CC) $(INCLUDE_PATHS) $(CFLAGS) -c $< -o $@
\ No newline at end of file
+	$(CC) $(INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
\ No newline at end of file
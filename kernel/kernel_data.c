@@ -0,0 +1,53 @@
+/*
+ * Kernel data page updates. See kernel_data.h.
+ */
+
+#include <string.h>
+
+#include "kernel_data.h"
+#include "hardware.h"
+#include "timers.h"
+
+
+
+void kernel_data_init(kernel_data_page_t *page)
+{
+    memset(page, 0, sizeof(kernel_data_page_t));
+
+    page->version = KERNEL_DATA_VERSION;
+    page->counter_frequency = get_cycle_counter_frequency();
+    page->tick_rate = TICK_RATE_HZ;
+    page->time_base_count = read_cycle_counter();
+    page->current_task_id = KERNEL_DATA_IDLE_TASK;
+}
+
+
+
+void update_kernel_data_page(kernel_data_page_t *page, task_table_t *table, unsigned int ticks)
+{
+    unsigned int now = read_cycle_counter();
+    int task_id = KERNEL_DATA_IDLE_TASK;
+
+    if(table->current_task != &table->idle_task)
+    {
+        task_id = table->current_task->task_id;
+    }
+
+    page->sequence++;
+    KERNEL_DATA_BARRIER();
+
+    page->time_base += now - page->time_base_count;
+    page->time_base_count = now;
+    page->ticks = ticks;
+
+    if(page->current_task_id != task_id)
+    {
+        page->current_task_id = task_id;
+        page->num_switches++;
+    }
+
+    page->idle_cycles = table->idle_task.stats.run_cycles;
+
+    KERNEL_DATA_BARRIER();
+    page->sequence++;
+}
@@ -15,9 +15,9 @@ void init_heap(heap_cb_t *heap)
     heap->in_use_128B = 0;
     heap->in_use_512B = 0;
 
-    heap->num_32B_blocks = 32;
-    heap->num_128B_blocks = 24;
-    heap->num_512B_blocks = 8;
+    heap->num_32B_blocks = NUM_32B_BLOCKS;
+    heap->num_128B_blocks = NUM_128B_BLOCKS;
+    heap->num_512B_blocks = NUM_512B_BLOCKS;
 }
 
 
@@ -0,0 +1,148 @@
+/*
+ * Fixed size message queues. See message_queue.h.
+ */
+
+#include <string.h>
+
+#include "message_queue.h"
+
+
+#define MESSAGE_SLOT(_queue, _index)    ((_queue)->buffer + (_index)*(_queue)->message_size)
+
+
+
+/*
+ * Stores a message as sent into a slot or a waiting receiver's
+ * buffer. In pointer mode the message is the pointer itself.
+ */
+static void store_message(message_queue_t *queue, void *destination, void *message)
+{
+    if(queue->options & MESSAGE_QUEUE_POINTERS)
+    {
+        *(void**) destination = message;
+    }
+    else
+    {
+        memcpy(destination, message, queue->message_size);
+    }
+}
+
+
+// slot after the newest message
+static unsigned int tail_slot(message_queue_t *queue)
+{
+    unsigned int index = queue->head + queue->count;
+
+    return (index >= queue->depth) ? index - queue->depth : index;
+}
+
+
+/*
+ * Wakes a task whose send or receive was completed on its behalf
+ * and returns 1 if it should preempt the current task.
+ */
+static int complete_wait(task_table_t *table, wait_queue_t *waiters, task_control_block_t *task)
+{
+    wait_queue_remove(waiters, task);
+    task->message = NULL_POINTER;
+    task->regs[REGISTER_V0] = 0;
+    set_task_ready(table, task);
+
+    return TASK_WAIT_PRIORITY(task) < TASK_WAIT_PRIORITY(table->current_task);
+}
+
+
+
+int message_queue_init(message_queue_t *queue, void *buffer, unsigned int depth, unsigned int message_size, unsigned int options)
+{
+    if(options & MESSAGE_QUEUE_POINTERS)
+    {
+        message_size = sizeof(void*);
+    }
+
+    if(buffer == NULL_POINTER || depth == 0 || message_size == 0)
+    {
+        return ERROR_MESSAGE_QUEUE_INVALID;
+    }
+
+    queue->buffer = buffer;
+    queue->message_size = message_size;
+    queue->depth = depth;
+    queue->options = options;
+    queue->count = 0;
+    queue->head = 0;
+    wait_queue_init(&queue->receivers);
+    wait_queue_init(&queue->senders);
+
+    return 0;
+}
+
+
+int message_send(task_table_t *table, task_control_block_t *task, message_queue_t *queue, void *message, unsigned int timeout, unsigned int now)
+{
+    task_control_block_t *receiver = queue->receivers.head;
+
+    // receivers only wait on an empty queue, so the message skips it
+    if(receiver != NULL_POINTER)
+    {
+        store_message(queue, receiver->message, message);
+        return complete_wait(table, &queue->receivers, receiver);
+    }
+
+    if(queue->count < queue->depth)
+    {
+        store_message(queue, MESSAGE_SLOT(queue, tail_slot(queue)), message);
+        queue->count++;
+        return 0;
+    }
+
+    if(timeout == WAIT_POLL)
+    {
+        return ERROR_TIMED_OUT;
+    }
+
+    wait_queue_block_by_priority(table, &queue->senders, task);
+    task->message = message;
+    set_task_timeout(table, task, timeout, now);
+
+    return 0;
+}
+
+
+int message_receive(task_table_t *table, task_control_block_t *task, message_queue_t *queue, void *buffer, unsigned int timeout, unsigned int now)
+{
+    task_control_block_t *sender;
+
+    if(queue->count == 0)
+    {
+        if(timeout == WAIT_POLL)
+        {
+            return ERROR_TIMED_OUT;
+        }
+
+        wait_queue_block_by_priority(table, &queue->receivers, task);
+        task->message = buffer;
+        set_task_timeout(table, task, timeout, now);
+
+        return 0;
+    }
+
+    // slots hold the pointer itself in pointer mode, so this is the same for both
+    memcpy(buffer, MESSAGE_SLOT(queue, queue->head), queue->message_size);
+
+    queue->head = (queue->head + 1 == queue->depth) ? 0 : queue->head + 1;
+    queue->count--;
+
+    // senders only wait on a full queue, so the first one takes the freed slot
+    sender = queue->senders.head;
+
+    if(sender != NULL_POINTER)
+    {
+        store_message(queue, MESSAGE_SLOT(queue, tail_slot(queue)), sender->message);
+        queue->count++;
+
+        return complete_wait(table, &queue->senders, sender);
+    }
+
+    return 0;
+}
@@ -0,0 +1,281 @@
+/*
+ * Contended paths of priority inheritance mutexes. The
+ * uncontended paths are the LL/SC sequences in the API
+ * wrappers. See mutex.h.
+ */
+
+#include "mutex.h"
+
+
+// any address inside a task's stack names it as the owner
+#define TASK_STACK_ADDRESS(_task)   ((uint32_t)(uintptr_t) (_task)->stack.top - STACK_ALIGNMENT)
+
+
+
+/*
+ * Finds the live task whose stack contains the address. Only
+ * done the first time a mutex becomes contended, since the
+ * kernel keeps the owner from then on.
+ */
+static task_control_block_t *find_stack_owner(task_table_t *table, uint32_t address)
+{
+    uint32_t in_use = ~table->free_task_bitmap;
+
+    while(in_use != 0)
+    {
+        int index = __builtin_ctz(in_use);
+        in_use &= in_use - 1;
+
+        task_control_block_t *task = &table->tasks[index];
+        uint32_t top = (uint32_t)(uintptr_t) task->stack.top;
+
+        if(task->state != TERMINATED && address < top && address >= top - task->stack.size)
+        {
+            return task;
+        }
+    }
+
+    return NULL_POINTER;
+}
+
+
+static void held_list_push(task_control_block_t *owner, mutex_t *mutex)
+{
+    mutex->next_held = owner->held_mutexes;
+    owner->held_mutexes = mutex;
+}
+
+
+static void held_list_remove(task_control_block_t *owner, mutex_t *mutex)
+{
+    mutex_t **link = &owner->held_mutexes;
+
+    while(*link != NULL_POINTER && *link != mutex)
+    {
+        link = &(*link)->next_held;
+    }
+
+    if(*link != NULL_POINTER)
+    {
+        *link = mutex->next_held;
+    }
+
+    mutex->next_held = NULL_POINTER;
+}
+
+
+/*
+ * Sets the task's priority to the highest of its base priority
+ * and the head waiters of the mutexes it holds. If that changed
+ * and the task is waiting for a mutex itself, it is moved to its
+ * new place among that mutex's waiters, and the owner of that
+ * mutex is updated in turn, so inheritance is transitive.
+ */
+static void update_inherited_priority(task_table_t *table, task_control_block_t *task)
+{
+    while(task != NULL_POINTER)
+    {
+        unsigned int priority = task->base_priority;
+        mutex_t *mutex;
+
+        // waiters are in priority order, so only the head of each queue matters
+        for(mutex = task->held_mutexes; mutex != NULL_POINTER; mutex = mutex->next_held)
+        {
+            unsigned int waiter_priority = TASK_WAIT_PRIORITY(mutex->waiters.head);
+
+            if(waiter_priority < priority)
+            {
+                priority = waiter_priority;
+            }
+        }
+
+        if(priority == task->priority)
+        {
+            return;
+        }
+
+        set_task_priority(table, task, priority);
+
+        mutex = task->waiting_mutex;
+
+        if(mutex == NULL_POINTER)
+        {
+            return;
+        }
+
+        wait_queue_remove(&mutex->waiters, task);
+        wait_queue_block_by_priority(table, &mutex->waiters, task);
+
+        task = mutex->owner;
+    }
+}
+
+
+/*
+ * Takes the mutex's last waiter away and turns it back into a
+ * mutex the owner can unlock without the kernel.
+ */
+static void clear_contended(task_table_t *table, mutex_t *mutex)
+{
+    task_control_block_t *owner = mutex->owner;
+
+    held_list_remove(owner, mutex);
+    mutex->owner = NULL_POINTER;
+    mutex->lock &= MUTEX_OWNER_MASK;
+
+    update_inherited_priority(table, owner);
+}
+
+
+/*
+ * Makes the highest priority waiter the owner of a contended
+ * mutex and returns it. The previous owner's priority is left
+ * for the caller to update.
+ */
+static task_control_block_t *hand_over(task_table_t *table, mutex_t *mutex)
+{
+    task_control_block_t *next = mutex->waiters.head;
+
+    held_list_remove(mutex->owner, mutex);
+
+    wait_queue_remove(&mutex->waiters, next);
+    next->waiting_mutex = NULL_POINTER;
+
+    if(mutex->waiters.head != NULL_POINTER)
+    {
+        mutex->owner = next;
+        mutex->lock = TASK_STACK_ADDRESS(next) | MUTEX_CONTENDED;
+        held_list_push(next, mutex);
+
+        // the new owner inherits from the waiters that are left
+        update_inherited_priority(table, next);
+    }
+    else
+    {
+        mutex->owner = NULL_POINTER;
+        mutex->lock = TASK_STACK_ADDRESS(next);
+    }
+
+    set_task_ready(table, next);
+
+    return next;
+}
+
+
+
+void mutex_init(mutex_t *mutex)
+{
+    mutex->lock = MUTEX_UNLOCKED;
+    mutex->owner = NULL_POINTER;
+    wait_queue_init(&mutex->waiters);
+    mutex->next_held = NULL_POINTER;
+}
+
+
+int mutex_lock(task_table_t *table, task_control_block_t *task, mutex_t *mutex)
+{
+    uint32_t lock = mutex->lock;
+    task_control_block_t *owner;
+
+    // unlocked since the caller looked
+    if(lock == MUTEX_UNLOCKED)
+    {
+        mutex->lock = TASK_STACK_ADDRESS(task);
+        return 0;
+    }
+
+    if(lock & MUTEX_CONTENDED)
+    {
+        owner = mutex->owner;
+    }
+    else
+    {
+        owner = find_stack_owner(table, lock & MUTEX_OWNER_MASK);
+
+        if(owner == NULL_POINTER)
+        {
+            mutex->lock = TASK_STACK_ADDRESS(task);
+            return MUTEX_OWNER_DIED;
+        }
+    }
+
+    if(owner == task)
+    {
+        return ERROR_MUTEX_DEADLOCK;
+    }
+
+    // first waiter, so the kernel takes over tracking the owner
+    if(!(lock & MUTEX_CONTENDED))
+    {
+        mutex->owner = owner;
+        wait_queue_init(&mutex->waiters);
+        held_list_push(owner, mutex);
+        mutex->lock = lock | MUTEX_CONTENDED;
+    }
+
+    wait_queue_block_by_priority(table, &mutex->waiters, task);
+    task->waiting_mutex = mutex;
+
+    update_inherited_priority(table, owner);
+
+    return 0;
+}
+
+
+int mutex_unlock(task_table_t *table, task_control_block_t *task, mutex_t *mutex)
+{
+    uint32_t lock = mutex->lock;
+    task_control_block_t *next;
+
+    // kernel callers, or the last waiter left before the owner unlocked
+    if(!(lock & MUTEX_CONTENDED))
+    {
+        if(lock == MUTEX_UNLOCKED || find_stack_owner(table, lock) != task)
+        {
+            return ERROR_MUTEX_NOT_OWNER;
+        }
+
+        mutex->lock = MUTEX_UNLOCKED;
+        return 0;
+    }
+
+    if(mutex->owner != task)
+    {
+        return ERROR_MUTEX_NOT_OWNER;
+    }
+
+    next = hand_over(table, mutex);
+
+    // drops whatever priority was inherited through this mutex
+    update_inherited_priority(table, task);
+
+    return TASK_WAIT_PRIORITY(next) < TASK_WAIT_PRIORITY(task);
+}
+
+
+void mutex_release_task(task_table_t *table, task_control_block_t *task)
+{
+    mutex_t *mutex = task->waiting_mutex;
+
+    if(mutex != NULL_POINTER)
+    {
+        wait_queue_remove(&mutex->waiters, task);
+        task->waiting_mutex = NULL_POINTER;
+
+        if(mutex->waiters.head == NULL_POINTER)
+        {
+            clear_contended(table, mutex);
+        }
+        else
+        {
+            update_inherited_priority(table, mutex->owner);
+        }
+    }
+
+    // the new owners' mutex_lock calls report the dead owner, as in the uncontended case
+    while(task->held_mutexes != NULL_POINTER)
+    {
+        task_control_block_t *next = hand_over(table, task->held_mutexes);
+        next->regs[REGISTER_V0] = MUTEX_OWNER_DIED;
+    }
+}
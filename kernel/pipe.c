@@ -0,0 +1,235 @@
+/*
+ * Anonymous pipes. See pipe.h.
+ */
+
+#include <string.h>
+
+#include "pipe.h"
+
+
+
+/*
+ * Copies up to size bytes into the ring and returns how many
+ * fitted. The free space may wrap past the end of the buffer,
+ * in which case it is filled in two pieces.
+ */
+static unsigned int ring_put(pipe_t *pipe, const uint8_t *source, unsigned int size)
+{
+    unsigned int space = PIPE_BUFFER_SIZE - pipe->count;
+    unsigned int tail = pipe->head + pipe->count;
+    unsigned int first;
+
+    if(size > space) size = space;
+    if(tail >= PIPE_BUFFER_SIZE) tail -= PIPE_BUFFER_SIZE;
+
+    first = PIPE_BUFFER_SIZE - tail;
+    if(first > size) first = size;
+
+    memcpy(&pipe->data[tail], source, first);
+    memcpy(pipe->data, source + first, size - first);
+
+    pipe->count += size;
+
+    return size;
+}
+
+
+// copies up to size bytes out of the ring and returns how many there were
+static unsigned int ring_get(pipe_t *pipe, uint8_t *destination, unsigned int size)
+{
+    unsigned int first;
+
+    if(size > pipe->count) size = pipe->count;
+
+    first = PIPE_BUFFER_SIZE - pipe->head;
+    if(first > size) first = size;
+
+    memcpy(destination, &pipe->data[pipe->head], first);
+    memcpy(destination + first, pipe->data, size - first);
+
+    pipe->head += size;
+    if(pipe->head >= PIPE_BUFFER_SIZE) pipe->head -= PIPE_BUFFER_SIZE;
+    pipe->count -= size;
+
+    return size;
+}
+
+
+// returns whether the woken task should preempt the current task
+static int complete_transfer(task_table_t *table, wait_queue_t *waiters, task_control_block_t *task, int result)
+{
+    wait_queue_remove(waiters, task);
+    task->message = NULL_POINTER;
+    task->regs[REGISTER_V0] = result;
+    set_task_ready(table, task);
+
+    return TASK_WAIT_PRIORITY(task) < TASK_WAIT_PRIORITY(table->current_task);
+}
+
+
+/*
+ * Moves the data of waiting writers into the space a read freed,
+ * waking each writer whose data is all in. Returns whether one
+ * of them should preempt the current task.
+ */
+static int pull_waiting_writers(task_table_t *table, pipe_t *pipe)
+{
+    task_control_block_t *writer;
+    int preempt = 0;
+
+    while((writer = pipe->writers.head) != NULL_POINTER && pipe->count < PIPE_BUFFER_SIZE)
+    {
+        writer->transferred += ring_put(pipe, (uint8_t*) writer->message + writer->transferred,
+                                        writer->transfer_size - writer->transferred);
+
+        if(writer->transferred < writer->transfer_size)
+        {
+            break;
+        }
+
+        preempt |= complete_transfer(table, &pipe->writers, writer, writer->transfer_size);
+    }
+
+    return preempt;
+}
+
+
+
+void pipe_table_init(pipe_table_t *pipe_table)
+{
+    pipe_table->free_pipe_bitmap = (MAX_PIPES < 32) ? (0x1u << MAX_PIPES) - 1 : 0xFFFFFFFF;
+}
+
+
+int allocate_pipe(pipe_table_t *pipe_table)
+{
+    pipe_t *pipe;
+    int index;
+
+    if(pipe_table->free_pipe_bitmap == 0)
+    {
+        return ERROR_PIPE_TABLE_FULL;
+    }
+
+    index = __builtin_ctz(pipe_table->free_pipe_bitmap);
+    pipe_table->free_pipe_bitmap &= ~(0x1u << index);
+
+    pipe = &pipe_table->pipes[index];
+    pipe->head = 0;
+    pipe->count = 0;
+    pipe->is_open[PIPE_READ_END] = 1;
+    pipe->is_open[PIPE_WRITE_END] = 1;
+    wait_queue_init(&pipe->readers);
+    wait_queue_init(&pipe->writers);
+
+    return index;
+}
+
+
+int pipe_read(task_table_t *table, task_control_block_t *task, pipe_t *pipe, void *buffer, unsigned int size, int *preempt)
+{
+    unsigned int bytes_read;
+
+    *preempt = 0;
+
+    if(size == 0)
+    {
+        return 0;
+    }
+
+    if(pipe->count == 0)
+    {
+        // end of file once nothing can be written any more
+        if(!pipe->is_open[PIPE_WRITE_END])
+        {
+            return 0;
+        }
+
+        wait_queue_block(table, &pipe->readers, task);
+        task->message = buffer;
+        task->transfer_size = size;
+
+        return 0;
+    }
+
+    bytes_read = ring_get(pipe, buffer, size);
+    *preempt = pull_waiting_writers(table, pipe);
+
+    return bytes_read;
+}
+
+
+int pipe_write(task_table_t *table, task_control_block_t *task, pipe_t *pipe, void *buffer, unsigned int size, int *preempt)
+{
+    task_control_block_t *reader;
+    unsigned int written = 0;
+
+    *preempt = 0;
+
+    if(!pipe->is_open[PIPE_READ_END])
+    {
+        return ERROR_PIPE_CLOSED;
+    }
+
+    // readers only wait on an empty pipe, so the data skips the ring
+    while((reader = pipe->readers.head) != NULL_POINTER && written < size)
+    {
+        unsigned int chunk = size - written;
+
+        if(chunk > reader->transfer_size) chunk = reader->transfer_size;
+
+        memcpy(reader->message, (uint8_t*) buffer + written, chunk);
+        written += chunk;
+
+        *preempt |= complete_transfer(table, &pipe->readers, reader, chunk);
+    }
+
+    // queued behind any writer already waiting, so writes are not mixed up
+    if(pipe->writers.head == NULL_POINTER)
+    {
+        written += ring_put(pipe, (uint8_t*) buffer + written, size - written);
+    }
+
+    if(written < size)
+    {
+        wait_queue_block(table, &pipe->writers, task);
+        task->message = buffer;
+        task->transfer_size = size;
+        task->transferred = written;
+    }
+
+    return size;
+}
+
+
+int close_pipe_end(task_table_t *table, pipe_table_t *pipe_table, int pipe_index, int end)
+{
+    pipe_t *pipe = &pipe_table->pipes[pipe_index];
+    task_control_block_t *task;
+    int preempt = 0;
+
+    pipe->is_open[end] = 0;
+
+    if(end == PIPE_WRITE_END)
+    {
+        // nothing more is coming for readers waiting on an empty pipe
+        while((task = pipe->readers.head) != NULL_POINTER)
+        {
+            preempt |= complete_transfer(table, &pipe->readers, task, 0);
+        }
+    }
+    else
+    {
+        while((task = pipe->writers.head) != NULL_POINTER)
+        {
+            preempt |= complete_transfer(table, &pipe->writers, task, (task->transferred > 0) ? (int) task->transferred : ERROR_PIPE_CLOSED);
+        }
+    }
+
+    if(!pipe->is_open[PIPE_READ_END] && !pipe->is_open[PIPE_WRITE_END])
+    {
+        pipe_table->free_pipe_bitmap |= 0x1u << pipe_index;
+    }
+
+    return preempt;
+}
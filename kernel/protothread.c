@@ -0,0 +1,69 @@
+/*
+ * Scheduler for stackless coroutines. See protothread.h.
+ */
+
+#include "protothread.h"
+
+
+
+void pt_scheduler_init(pt_scheduler_t *scheduler)
+{
+    scheduler->jobs = NULL_POINTER;
+    scheduler->num_jobs = 0;
+}
+
+
+void pt_job_start(pt_scheduler_t *scheduler, pt_job_t *job, pt_function_t function)
+{
+    pt_job_t **tail = &scheduler->jobs;
+
+    job->function = function;
+    job->next = NULL_POINTER;
+    job->wake_tick = 0;
+    job->resume_line = 0;
+    job->sleeping = 0;
+
+    // appended so that jobs run in the order they were started
+    while(*tail != NULL_POINTER)
+    {
+        tail = &(*tail)->next;
+    }
+
+    *tail = job;
+    scheduler->num_jobs++;
+}
+
+
+unsigned int pt_scheduler_run(pt_scheduler_t *scheduler)
+{
+    unsigned int now = get_system_ticks();
+    pt_job_t **link = &scheduler->jobs;
+    pt_job_t *job;
+
+    while((job = *link) != NULL_POINTER)
+    {
+        if(job->sleeping)
+        {
+            if((int)(now - job->wake_tick) < 0)
+            {
+                link = &job->next;
+                continue;
+            }
+
+            job->sleeping = 0;
+        }
+
+        if(job->function(job) == PT_ENDED)
+        {
+            *link = job->next;
+            job->next = NULL_POINTER;
+            scheduler->num_jobs--;
+        }
+        else
+        {
+            link = &job->next;
+        }
+    }
+
+    return scheduler->num_jobs;
+}
@@ -0,0 +1,195 @@
+/*
+ * Implements admission control and job release for the
+ * earliest-deadline-first real-time scheduling class. The
+ * deadline-ordered ready list itself is part of the
+ * scheduler in task.c.
+ */
+
+#include "realtime.h"
+#include "timers.h"
+#include "stdlib.h"
+
+
+/*
+ * Density of a task in units of RT_UTILIZATION_SCALE, rounded
+ * up so that admission control never underestimates load.
+ */
+static unsigned int get_density(realtime_params_t *params)
+{
+    unsigned int window = (params->deadline < params->period) ? params->deadline : params->period;
+
+    return (params->wcet*RT_UTILIZATION_SCALE + window - 1)/window;
+}
+
+
+/*
+ * Earliest tick at which the task needs attention from the
+ * tick handler, or RT_NO_EVENT if it needs none.
+ */
+static unsigned int get_task_next_event(task_control_block_t *task)
+{
+    if(!task->rt.job_active)
+    {
+        return task->rt.next_release;
+    }
+
+    // an overrunning job is released again when it completes
+    return task->rt.miss_counted ? RT_NO_EVENT : task->rt.absolute_deadline;
+}
+
+
+static void update_next_event(task_table_t *table, unsigned int now)
+{
+    unsigned int earliest = RT_NO_EVENT;
+    unsigned int earliest_delta = RT_NO_EVENT;
+    uint32_t remaining = table->realtime_bitmap;
+
+    while(remaining != 0)
+    {
+        int index = __builtin_ctz(remaining);
+        remaining &= remaining - 1;
+
+        unsigned int event = get_task_next_event(&table->tasks[index]);
+
+        if(event != RT_NO_EVENT && event - now < earliest_delta)
+        {
+            earliest_delta = event - now;
+            earliest = event;
+        }
+    }
+
+    table->rt_next_event = earliest;
+}
+
+
+static void release_job(task_control_block_t *task)
+{
+    task->rt.absolute_deadline = task->rt.next_release + task->rt.params.deadline;
+    task->rt.next_release += task->rt.params.period;
+    task->rt.job_active = 1;
+    task->rt.miss_counted = 0;
+}
+
+
+
+taskid_t create_realtime_task(task_table_t *table, int parent_task_id, void *function, realtime_params_t *params)
+{
+    taskid_t task_id;
+    task_control_block_t *task;
+    unsigned int density;
+
+    if(params->period == 0 || params->wcet == 0 || params->deadline == 0 ||
+       params->wcet > params->deadline || params->deadline > params->period)
+    {
+        return ERROR_INVALID_RT_PARAMS;
+    }
+
+    density = get_density(params);
+
+    if(table->rt_utilization + density > RT_UTILIZATION_BOUND)
+    {
+        return ERROR_ADMISSION_FAILED;
+    }
+
+    // priority is unused by the real-time class
+    task_id = create_task(table, parent_task_id, function, 0, DEFAULT_STACK_SIZE);
+    if(task_id < 0) return task_id;
+
+    task = get_task(table, task_id);
+
+    task->rt.params = *params;
+    task->rt.utilization = density;
+    task->rt.next_release = get_system_ticks();
+    task->rt.jobs_completed = 0;
+    task->rt.deadline_misses = 0;
+    release_job(task);
+
+    table->rt_utilization += density;
+    table->realtime_bitmap |= 0x1u << TASK_ID_INDEX(task_id);
+    set_task_sched_class(table, task, SCHED_CLASS_REALTIME);
+
+    update_next_event(table, get_system_ticks());
+
+    return task_id;
+}
+
+
+void realtime_tick(task_table_t *table, unsigned int now)
+{
+    uint32_t remaining;
+
+    // nothing is released and no deadline passes on most ticks
+    if(table->rt_next_event == RT_NO_EVENT || (int)(now - table->rt_next_event) < 0)
+    {
+        return;
+    }
+
+    remaining = table->realtime_bitmap;
+
+    while(remaining != 0)
+    {
+        int index = __builtin_ctz(remaining);
+        remaining &= remaining - 1;
+
+        task_control_block_t *task = &table->tasks[index];
+
+        if(task->rt.job_active)
+        {
+            if(!task->rt.miss_counted && (int)(now - task->rt.absolute_deadline) >= 0)
+            {
+                task->rt.deadline_misses++;
+                task->rt.miss_counted = 1;
+            }
+        }
+        else if((int)(now - task->rt.next_release) >= 0)
+        {
+            release_job(task);
+            set_task_ready(table, task);
+        }
+    }
+
+    update_next_event(table, now);
+}
+
+
+void complete_realtime_job(task_table_t *table, task_control_block_t *task, unsigned int now)
+{
+    if(task->sched_class != SCHED_CLASS_REALTIME || !task->rt.job_active)
+    {
+        return;
+    }
+
+    task->rt.jobs_completed++;
+
+    // finishing after the deadline counts even if no tick saw it
+    if(!task->rt.miss_counted && (int)(now - task->rt.absolute_deadline) > 0)
+    {
+        task->rt.deadline_misses++;
+    }
+
+    if((int)(now - task->rt.next_release) >= 0)
+    {
+        // overran into the next period, so start the next job now
+        release_job(task);
+    }
+    else
+    {
+        task->rt.job_active = 0;
+        set_task_blocked(table, task);
+    }
+
+    update_next_event(table, now);
+}
+
+
+int get_deadline_misses(task_table_t *table, int task_id)
+{
+    task_control_block_t *task = get_task(table, task_id);
+
+    if(task == NULL_POINTER || task->sched_class != SCHED_CLASS_REALTIME)
+    {
+        return ERROR_TASK_NOT_FOUND;
+    }
+
+    return task->rt.deadline_misses;
+}
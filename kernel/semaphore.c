@@ -0,0 +1,57 @@
+/*
+ * Counting semaphores. See semaphore.h.
+ */
+
+#include "semaphore.h"
+
+
+
+void semaphore_init(semaphore_t *semaphore, unsigned int count)
+{
+    semaphore->count = count;
+    wait_queue_init(&semaphore->waiters);
+}
+
+
+int semaphore_wait(task_table_t *table, task_control_block_t *task, semaphore_t *semaphore, unsigned int timeout, unsigned int now)
+{
+    if(semaphore->count > 0)
+    {
+        semaphore->count--;
+        return 0;
+    }
+
+    if(timeout == WAIT_POLL)
+    {
+        return ERROR_TIMED_OUT;
+    }
+
+    wait_queue_block_by_priority(table, &semaphore->waiters, task);
+    set_task_timeout(table, task, timeout, now);
+
+    return 0;
+}
+
+
+int semaphore_post(task_table_t *table, semaphore_t *semaphore)
+{
+    task_control_block_t *task = semaphore->waiters.head;
+
+    if(task == NULL_POINTER)
+    {
+        if(semaphore->count >= SEMAPHORE_MAX_COUNT)
+        {
+            return ERROR_SEMAPHORE_OVERFLOW;
+        }
+
+        semaphore->count++;
+        return 0;
+    }
+
+    // the head is the highest priority waiter, and takes the count without it being added
+    wait_queue_remove(&semaphore->waiters, task);
+    task->regs[REGISTER_V0] = 0;
+    set_task_ready(table, task);
+
+    return TASK_WAIT_PRIORITY(task) < TASK_WAIT_PRIORITY(table->current_task);
+}
@@ -20,7 +20,7 @@ setup:
 
 
 $(OBJS): $(SUB_DIR)/%.o: %.c
-	$(CC) $(INCLUDE_PATHS) $(CFLAGS) -c $< -o $@
+	$(CC) $(INCLUDE_PATHS) $(CONFIG_FLAGS) $(CFLAGS) -c $< -o $@
 
 
 
@@ -21,11 +21,30 @@ void memcopy(void *dest, void *source, unsigned int num_bytes)
 
 void memset(void *dest, unsigned char val, unsigned int size)
 {
-    unsigned int current;
+    unsigned int current = 0;
 
     while(current < size)
     {
         *((char*)dest + current) = val;
         current++;
     }
-}
\ No newline at end of file
+}
+
+
+/*
+ * Compares at most max_string_len characters of the two
+ * strings. Returns 0 if they are equal, and otherwise the
+ * difference of the first characters that differ.
+ */
+int string_compare(char *str1, char *str2, int max_string_len)
+{
+    for(int i = 0; i < max_string_len; i++)
+    {
+        if(str1[i] != str2[i] || str1[i] == '\0')
+        {
+            return (unsigned char) str1[i] - (unsigned char) str2[i];
+        }
+    }
+
+    return 0;
+}
@@ -3,12 +3,17 @@
 #include "syscall.h"
 #include "ktypes.h"
 #include "task.h"
+#include "realtime.h"
+#include "timers.h"
 #include "filesystem.h"
+#include "deferred_work.h"
 
 
 extern task_table_t task_table;
 extern superblock_t *ramdisk_superblock;
 extern open_file_table_t open_file_table; 
+extern unsigned int need_resched;
+extern deferred_work_queue_t deferred_work_queue;
 
 
 
@@ -32,8 +37,12 @@ extern open_file_table_t open_file_table;
  * handler function has the same number and type of arguments as the
  * syscall userspace wrapper function, the ABI is unchanged and should
  * work properly.
+ *
+ * The table always has NUM_SYSCALLS entries, and reserved codes
+ * are left NULL, so the dispatch code checks the code against
+ * NUM_SYSCALLS and the entry against NULL before calling it.
  */
-void *syscall_table[] = {
+void *syscall_table[NUM_SYSCALLS] = {
     [SYSCALL_CODE_CREATE_TASK]  = __SYSCALL_TABLE__ do_syscall_create_task,
     [SYSCALL_CODE_KILL_TASK]    = __SYSCALL_TABLE__ do_syscall_kill_task,
     [SYSCALL_CODE_YIELD]        = __SYSCALL_TABLE__ do_syscall_yield,
@@ -47,52 +56,324 @@ void *syscall_table[] = {
     [SYSCALL_CODE_MKFILE]       = __SYSCALL_TABLE__ do_syscall_mkfile,
     [SYSCALL_CODE_SEEK]         = __SYSCALL_TABLE__ do_syscall_seek,
     [SYSCALL_CODE_MKDIR]        = __SYSCALL_TABLE__ do_syscall_mkdir,
-    [SYSCALL_CODE_DELETE_FILE]  = __SYSCALL_TABLE__ do_syscall_delete_file
+    [SYSCALL_CODE_DELETE_FILE]  = __SYSCALL_TABLE__ do_syscall_delete_file,
+    [SYSCALL_CODE_SLEEP]        = __SYSCALL_TABLE__ do_syscall_sleep,
+    [SYSCALL_CODE_CREATE_RT_TASK]   = __SYSCALL_TABLE__ do_syscall_create_realtime_task,
+    [SYSCALL_CODE_WAIT_NEXT_PERIOD] = __SYSCALL_TABLE__ do_syscall_wait_next_period,
+    [SYSCALL_CODE_DEADLINE_MISSES]  = __SYSCALL_TABLE__ do_syscall_deadline_misses,
+    [SYSCALL_CODE_STACK_HIGH_WATER] = __SYSCALL_TABLE__ do_syscall_stack_high_water,
+    [SYSCALL_CODE_TASK_STATS]       = __SYSCALL_TABLE__ do_syscall_task_stats,
+    [SYSCALL_CODE_SLEEP_UNTIL]      = __SYSCALL_TABLE__ do_syscall_sleep_until,
+    [SYSCALL_CODE_MUTEX_LOCK]       = __SYSCALL_TABLE__ do_syscall_mutex_lock,
+    [SYSCALL_CODE_MUTEX_UNLOCK]     = __SYSCALL_TABLE__ do_syscall_mutex_unlock,
+    [SYSCALL_CODE_SEMAPHORE_WAIT]   = __SYSCALL_TABLE__ do_syscall_semaphore_wait,
+    [SYSCALL_CODE_SEMAPHORE_POST]   = __SYSCALL_TABLE__ do_syscall_semaphore_post,
+    [SYSCALL_CODE_EVENT_WAIT]       = __SYSCALL_TABLE__ do_syscall_event_wait,
+    [SYSCALL_CODE_EVENT_SET]        = __SYSCALL_TABLE__ do_syscall_event_set,
+    [SYSCALL_CODE_EVENT_CLEAR]      = __SYSCALL_TABLE__ do_syscall_event_clear,
+    [SYSCALL_CODE_MESSAGE_SEND]     = __SYSCALL_TABLE__ do_syscall_message_send,
+    [SYSCALL_CODE_MESSAGE_RECEIVE]  = __SYSCALL_TABLE__ do_syscall_message_receive,
+    [SYSCALL_CODE_PIPE]             = __SYSCALL_TABLE__ do_syscall_pipe,
+    [SYSCALL_CODE_RING_ENTER]       = __SYSCALL_TABLE__ do_syscall_ring_enter
 };
 
 
 
 
 
-taskid_t do_syscall_create_task(void *function)
+taskid_t do_syscall_create_task(void *function, unsigned int stack_size)
 {
     taskid_t current_task_id = get_current_task(&task_table);
-    taskid_t child_task_id = create_task(&task_table, current_task_id, function);
-    schedule_next_task(&task_table);
 
-    // store return value from syscall into task context
-    set_task_register_value(&task_table, current_task_id, REGISTER_V0, child_task_id);
+    // child tasks inherit the priority of their parent, but not one it inherited itself
+    unsigned int priority = task_table.current_task->base_priority;
+    taskid_t child_task_id = create_task(&task_table, current_task_id, function, priority, stack_size);
 
+    // No reschedule: the child gets the parent's base priority, so it never outranks it.
     return child_task_id;
 }
 
 
+taskid_t do_syscall_create_realtime_task(void *function, realtime_params_t *params)
+{
+    taskid_t current_task_id = get_current_task(&task_table);
+    taskid_t child_task_id = create_realtime_task(&task_table, current_task_id, function, params);
+
+    // the new task may have the earliest deadline if it was admitted, so it may run first
+    if(child_task_id >= 0)
+    {
+        need_resched = 1;
+    }
+
+    return child_task_id;
+}
+
+
+int do_syscall_wait_next_period()
+{
+    complete_realtime_job(&task_table, task_table.current_task, get_system_ticks());
+    need_resched = 1;
+
+    return 0;
+}
+
+
+int do_syscall_deadline_misses(taskid_t task_id)
+{
+    return get_deadline_misses(&task_table, task_id);
+}
+
+
+int do_syscall_stack_high_water(taskid_t task_id)
+{
+    return get_stack_high_water_mark(&task_table, task_id);
+}
+
+
+int do_syscall_task_stats(taskid_t task_id, task_stats_t *stats)
+{
+    return get_task_stats(&task_table, task_id, stats);
+}
+
+
 int do_syscall_kill_task(taskid_t task_id)
 {
-    // TODO
+    task_control_block_t *task = get_task(&task_table, task_id);
+
+    // stale or invalid task IDs are rejected by the lookup, and a zombie is already dead
+    if(task == NULL_POINTER || task->state == TERMINATED)
+    {
+        return ERROR_TASK_NOT_FOUND;
+    }
+
+    /*
+     * The root task has no parent, so killing it would free its
+     * slot while table->root still points at it, and the kernel
+     * relies on the deferred work worker.
+     */
+    if(task == task_table.root || task->task_id == deferred_work_queue.worker)
+    {
+        return ERROR_TASK_NOT_KILLABLE;
+    }
+
+    /*
+     * Torn down the way exit is, which also hands its contended
+     * mutexes on. Its parent may be woken to reap it, and the
+     * caller may have killed itself, so the scheduler runs.
+     */
+    exit_task(&task_table, task, EXIT_STATUS_KILLED);
+    need_resched = 1;
+
+    return 0;
 }
 
 
 int do_syscall_yield()
 {
-    // TODO
+    need_resched = 1;
+
+    return 0;
+}
+
+
+/*
+ * Both sleep calls return the current tick straight away if
+ * there is nothing to wait for. Otherwise the tick handler
+ * stores the tick the task woke at as the return value.
+ */
+unsigned int do_syscall_sleep(unsigned int ticks)
+{
+    unsigned int now = get_system_ticks();
+
+    // wakeups are compared as signed tick differences
+    if(ticks > SLEEP_MAX_TICKS) ticks = SLEEP_MAX_TICKS;
+
+    if(sleep_task_until(&task_table, task_table.current_task, now + ticks, now))
+    {
+        need_resched = 1;
+    }
+
+    return now;
+}
+
+
+unsigned int do_syscall_sleep_until(unsigned int wake_tick)
+{
+    unsigned int now = get_system_ticks();
+
+    if(sleep_task_until(&task_table, task_table.current_task, wake_tick, now))
+    {
+        need_resched = 1;
+    }
+
+    return now;
+}
+
+
+/*
+ * Only reached when the LL/SC fast path in the API found the
+ * mutex locked, or found tasks waiting for it.
+ */
+int do_syscall_mutex_lock(mutex_t *mutex)
+{
+    int result = mutex_lock(&task_table, task_table.current_task, mutex);
+
+    // the unlocking owner hands the mutex over and makes the task ready
+    if(task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
+
+    return result;
+}
+
+
+int do_syscall_mutex_unlock(mutex_t *mutex)
+{
+    int result = mutex_unlock(&task_table, task_table.current_task, mutex);
+
+    // the new owner has a higher priority
+    if(result > 0)
+    {
+        need_resched = 1;
+        result = 0;
+    }
+
+    return result;
 }
 
-int do_syscall_wait()
+
+/*
+ * The waits return 0 straight away if they are satisfied.
+ * Otherwise the post or set that wakes the task, or the tick
+ * handler when the timeout runs out, stores the return value.
+ */
+int do_syscall_semaphore_wait(semaphore_t *semaphore, unsigned int timeout)
 {
-    // TODO
+    int result = semaphore_wait(&task_table, task_table.current_task, semaphore, timeout, get_system_ticks());
+
+    if(task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
+
+    return result;
 }
 
 
-int do_syscall_waitpid(int pid)
+int do_syscall_semaphore_post(semaphore_t *semaphore)
 {
-    // TODO
+    int result = semaphore_post(&task_table, semaphore);
+
+    // the woken task has a higher priority
+    if(result > 0)
+    {
+        need_resched = 1;
+        result = 0;
+    }
+
+    return result;
 }
 
 
-int do_syscall_exit()
+int do_syscall_event_wait(event_flags_t *group, event_wait_t *wait)
 {
-    // TODO
+    int result = event_flags_wait(&task_table, task_table.current_task, group, wait, get_system_ticks());
+
+    if(task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
+
+    return result;
+}
+
+
+int do_syscall_event_set(event_flags_t *group, uint32_t flags)
+{
+    if(event_flags_set(&task_table, group, flags))
+    {
+        need_resched = 1;
+    }
+
+    return 0;
+}
+
+
+int do_syscall_event_clear(event_flags_t *group, uint32_t flags)
+{
+    event_flags_clear(group, flags);
+
+    return 0;
+}
+
+
+/*
+ * A send or receive that blocks gets its return value from the
+ * task that completes it, or from the tick handler if it times
+ * out. One that wakes a higher priority task switches to it.
+ */
+int do_syscall_message_send(message_queue_t *queue, void *message, unsigned int timeout)
+{
+    int result = message_send(&task_table, task_table.current_task, queue, message, timeout, get_system_ticks());
+
+    if(result > 0 || task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+        result = 0;
+    }
+
+    return result;
+}
+
+
+int do_syscall_message_receive(message_queue_t *queue, void *buffer, unsigned int timeout)
+{
+    int result = message_receive(&task_table, task_table.current_task, queue, buffer, timeout, get_system_ticks());
+
+    if(result > 0 || task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+        result = 0;
+    }
+
+    return result;
+}
+
+
+int do_syscall_wait(int *status)
+{
+    int result = wait_task(&task_table, WAIT_ANY_CHILD, status);
+
+    // the exiting child stores the real return value once it wakes the task
+    if(task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
+
+    return result;
+}
+
+
+int do_syscall_waitpid(taskid_t task_id, int *status)
+{
+    int result = wait_task(&task_table, task_id, status);
+
+    if(task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
+
+    return result;
+}
+
+
+int do_syscall_exit(int status)
+{
+    exit_task(&task_table, task_table.current_task, status);
+    need_resched = 1;
+
+    return 0;
 }
 
 
@@ -110,7 +391,11 @@ int do_syscall_close(int file_descriptor)
         return -1;
     }
 
-    close_file(ramdisk_superblock, &open_file_table, file_descriptor);
+    // closing a pipe end wakes the tasks waiting on the other one
+    if(close_file(ramdisk_superblock, &open_file_table, file_descriptor) > 0)
+    {
+        need_resched = 1;
+    }
 
     return 0;
 }
@@ -120,6 +405,7 @@ int do_syscall_close(int file_descriptor)
 int do_syscall_read(int file_descriptor, void *buffer, int size)
 {
     int bytes_read;
+    int preempt = 0;
 
     if(is_open_file_free(&open_file_table, file_descriptor))
     {
@@ -130,8 +416,22 @@ int do_syscall_read(int file_descriptor, void *buffer, int size)
     inode_t *inode_table = GET_POINTER_FROM_BLOCK_NUMBER(ramdisk_superblock->inode_table_start);
     inode_t *file_inode = &inode_table[inode_number];
 
-    bytes_read = read_file(file_inode, buffer, open_file_table.open_files[file_descriptor].cursor, size);
-    open_file_table.open_files[file_descriptor].cursor += bytes_read;
+    if(file_inode->file_type == FILE_TYPE_PIPE)
+    {
+        bytes_read = read_pipe_file(file_inode, buffer, size, &preempt);
+    }
+    else
+    {
+        bytes_read = read_file(file_inode, buffer, open_file_table.open_files[file_descriptor].cursor, size);
+        open_file_table.open_files[file_descriptor].cursor += bytes_read;
+    }
+
+    // a read of an empty pipe blocks, and the writer stores the real return value;
+    // one that makes room may also wake a writer that outranks the caller
+    if(preempt || task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
 
     return bytes_read;
 }
@@ -141,6 +441,7 @@ int do_syscall_read(int file_descriptor, void *buffer, int size)
 int do_syscall_write(int file_descriptor, void *buffer, int size)
 {
     int bytes_written;
+    int preempt = 0;
 
     if(is_open_file_free(&open_file_table, file_descriptor))
     {
@@ -151,15 +452,111 @@ int do_syscall_write(int file_descriptor, void *buffer, int size)
     inode_t *inode_table = GET_POINTER_FROM_BLOCK_NUMBER(ramdisk_superblock->inode_table_start);
     inode_t *file_inode = &inode_table[inode_number];
 
-    bytes_written = write_file(ramdisk_superblock, file_inode, buffer, open_file_table.open_files[file_descriptor].cursor, size);
-    open_file_table.open_files[file_descriptor].cursor += bytes_written;
+    if(file_inode->file_type == FILE_TYPE_PIPE)
+    {
+        bytes_written = write_pipe_file(file_inode, buffer, size, &preempt);
+    }
+    else
+    {
+        bytes_written = write_file(ramdisk_superblock, file_inode, buffer, open_file_table.open_files[file_descriptor].cursor, size);
+        open_file_table.open_files[file_descriptor].cursor += bytes_written;
+    }
+
+    // so does a write to a full pipe, until the readers make room for all of it,
+    // and a write may wake a reader that outranks the caller
+    if(preempt || task_table.current_task->state == BLOCKED)
+    {
+        need_resched = 1;
+    }
 
     return bytes_written;
 }
 
 
 
-void do_syscall_seek(int file_descriptor, int offset)
+int do_syscall_pipe(int *file_descriptors)
+{
+    return create_pipe(ramdisk_superblock, &open_file_table, file_descriptors);
+}
+
+
+
+/*
+ * Ring entries are untrusted user memory, so a descriptor from
+ * one is range checked before it indexes the open file table.
+ */
+static int is_ring_file_descriptor_open(int file_descriptor)
+{
+    return (unsigned int) file_descriptor < MAX_OPEN_FILES && !is_open_file_free(&open_file_table, file_descriptor);
+}
+
+
+/*
+ * Runs one operation from a syscall ring. Reads and writes of
+ * pipes are turned away, since they may block the task and the
+ * ring has nowhere to wait. A descriptor that is not open fails
+ * with -1, as it does in the system calls themselves, without
+ * calling their handlers.
+ */
+static int run_ring_operation(syscall_submission_t *submission)
+{
+    int file_descriptor = (int) submission->args[0];
+    inode_t *inode_table = GET_POINTER_FROM_BLOCK_NUMBER(ramdisk_superblock->inode_table_start);
+
+    switch(submission->code)
+    {
+    case SYSCALL_CODE_OPEN:
+        return do_syscall_open((char*)(uintptr_t) submission->args[0]);
+
+    case SYSCALL_CODE_CLOSE:
+        if(!is_ring_file_descriptor_open(file_descriptor))
+        {
+            return -1;
+        }
+
+        return do_syscall_close(file_descriptor);
+
+    case SYSCALL_CODE_SEEK:
+        if(!is_ring_file_descriptor_open(file_descriptor))
+        {
+            return -1;
+        }
+
+        return do_syscall_seek(file_descriptor, (int) submission->args[1]);
+
+    case SYSCALL_CODE_READ:
+    case SYSCALL_CODE_WRITE:
+        if(!is_ring_file_descriptor_open(file_descriptor))
+        {
+            return -1;
+        }
+
+        if(inode_table[open_file_table.open_files[file_descriptor].inode_number].file_type == FILE_TYPE_PIPE)
+        {
+            return ERROR_RING_WOULD_BLOCK;
+        }
+
+        if(submission->code == SYSCALL_CODE_READ)
+        {
+            return do_syscall_read(file_descriptor, (void*)(uintptr_t) submission->args[1], (int) submission->args[2]);
+        }
+
+        return do_syscall_write(file_descriptor, (void*)(uintptr_t) submission->args[1], (int) submission->args[2]);
+
+    default:
+        return ERROR_INVALID_SYSCALL;
+    }
+}
+
+
+unsigned int do_syscall_ring_enter(syscall_ring_t *ring)
+{
+    return run_syscall_ring(ring, run_ring_operation);
+}
+
+
+
+int do_syscall_seek(int file_descriptor, int offset)
 {
     if(is_open_file_free(&open_file_table, file_descriptor))
     {
@@ -167,6 +564,8 @@ void do_syscall_seek(int file_descriptor, int offset)
     }
 
     open_file_table.open_files[file_descriptor].cursor = offset;
+
+    return 0;
 }
 
 
@@ -0,0 +1,39 @@
+/*
+ * Submission and completion rings for batched system calls. See
+ * syscall_ring.h.
+ */
+
+#include "syscall_ring.h"
+
+
+#define SYSCALL_RING_INDEX_MASK     (SYSCALL_RING_SIZE - 1)
+
+
+
+unsigned int run_syscall_ring(syscall_ring_t *ring, syscall_ring_handler_t handler)
+{
+    syscall_submission_t *submission;
+    syscall_completion_t *completion;
+    unsigned int count = 0;
+
+    /*
+     * The indices live in task memory, so a bad submission_tail
+     * can at most make this run stale entries. Each enter still
+     * stops once the completion ring is full.
+     */
+    while(ring->submission_head != ring->submission_tail &&
+          ring->completion_tail - ring->completion_head < SYSCALL_RING_SIZE)
+    {
+        submission = &ring->submissions[ring->submission_head & SYSCALL_RING_INDEX_MASK];
+        completion = &ring->completions[ring->completion_tail & SYSCALL_RING_INDEX_MASK];
+
+        completion->user_data = submission->user_data;
+        completion->result = handler(submission);
+
+        ring->submission_head++;
+        ring->completion_tail++;
+        count++;
+    }
+
+    return count;
+}
@@ -0,0 +1,233 @@
+/*
+ * Per-system call statistics and the strace stream. See
+ * syscall_stats.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "syscall_stats.h"
+#include "kernel_data.h"
+
+
+/*
+ * Defined in global_structs.c
+ */
+extern kernel_data_page_t kernel_data_page;
+
+
+#define STRACE_INDEX_MASK       (STRACE_BUFFER_SIZE - 1)
+
+
+// reserved codes have no entry
+static const char *syscall_names[NUM_SYSCALLS] =
+{
+    [SYSCALL_CODE_CREATE_TASK]      = "create_task",
+    [SYSCALL_CODE_KILL_TASK]        = "kill_task",
+    [SYSCALL_CODE_YIELD]            = "yield",
+    [SYSCALL_CODE_WAIT]             = "wait",
+    [SYSCALL_CODE_WAITPID]          = "waitpid",
+    [SYSCALL_CODE_EXIT]             = "exit",
+    [SYSCALL_CODE_OPEN]             = "open",
+    [SYSCALL_CODE_CLOSE]            = "close",
+    [SYSCALL_CODE_READ]             = "read",
+    [SYSCALL_CODE_WRITE]            = "write",
+    [SYSCALL_CODE_MKFILE]           = "mkfile",
+    [SYSCALL_CODE_MKDIR]            = "mkdir",
+    [SYSCALL_CODE_SEEK]             = "seek",
+    [SYSCALL_CODE_DELETE_FILE]      = "delete_file",
+    [SYSCALL_CODE_SLEEP]            = "sleep",
+    [SYSCALL_CODE_CREATE_RT_TASK]   = "create_rt_task",
+    [SYSCALL_CODE_WAIT_NEXT_PERIOD] = "wait_next_period",
+    [SYSCALL_CODE_DEADLINE_MISSES]  = "deadline_misses",
+    [SYSCALL_CODE_STACK_HIGH_WATER] = "stack_high_water",
+    [SYSCALL_CODE_TASK_STATS]       = "task_stats",
+    [SYSCALL_CODE_SLEEP_UNTIL]      = "sleep_until",
+    [SYSCALL_CODE_MUTEX_LOCK]       = "mutex_lock",
+    [SYSCALL_CODE_MUTEX_UNLOCK]     = "mutex_unlock",
+    [SYSCALL_CODE_SEMAPHORE_WAIT]   = "semaphore_wait",
+    [SYSCALL_CODE_SEMAPHORE_POST]   = "semaphore_post",
+    [SYSCALL_CODE_EVENT_WAIT]       = "event_wait",
+    [SYSCALL_CODE_EVENT_SET]        = "event_set",
+    [SYSCALL_CODE_EVENT_CLEAR]      = "event_clear",
+    [SYSCALL_CODE_MESSAGE_SEND]     = "message_send",
+    [SYSCALL_CODE_MESSAGE_RECEIVE]  = "message_receive",
+    [SYSCALL_CODE_PIPE]             = "pipe",
+    [SYSCALL_CODE_RING_ENTER]       = "ring_enter",
+};
+
+
+
+void syscall_stats_init(syscall_stats_t *stats)
+{
+    memset(stats, 0, sizeof(syscall_stats_t));
+
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        stats->tasks[i].task_id = -1;
+    }
+}
+
+
+
+#ifdef CONFIG_SYSCALL_STATS
+void syscall_stats_exit(int result)
+{
+    syscall_stats_t *stats = &syscall_stats;
+    unsigned int cycles = read_cycle_counter() - stats->current.start;
+    unsigned int code = stats->current.code;
+    task_syscall_counters_t *task_counters;
+
+    /*
+     * The kernel data page still names the caller, as it is only
+     * updated once the scheduler runs, even if the call was exit
+     * and the caller's slot is already free.
+     */
+    int task_id = kernel_data_page.current_task_id;
+
+    // the idle task's yields are not part of any workload
+    if(task_id == KERNEL_DATA_IDLE_TASK)
+    {
+        return;
+    }
+
+    // rejected codes have no counters, but still show up in the strace
+    if(code < NUM_SYSCALLS && syscall_names[code] != NULL)
+    {
+        syscall_counters_t *counters = &stats->syscalls[code];
+
+        counters->calls++;
+        counters->total_cycles += cycles;
+
+        if(cycles > counters->max_cycles)
+        {
+            counters->max_cycles = cycles;
+        }
+    }
+
+    task_counters = &stats->tasks[TASK_ID_INDEX(task_id)];
+
+    if(task_counters->task_id != task_id)
+    {
+        task_counters->task_id = task_id;
+        task_counters->calls = 0;
+        task_counters->total_cycles = 0;
+    }
+
+    task_counters->calls++;
+    task_counters->total_cycles += cycles;
+
+#ifdef CONFIG_SYSCALL_STRACE
+    if(stats->strace_tail - stats->strace_head < STRACE_BUFFER_SIZE)
+    {
+        strace_record_t *record = &stats->strace[stats->strace_tail & STRACE_INDEX_MASK];
+
+        record->task_id = task_id;
+        record->code = code;
+        memcpy(record->args, stats->current.args, sizeof(record->args));
+        record->result = result;
+        record->cycles = cycles;
+
+        stats->strace_tail++;
+    }
+    else
+    {
+        stats->strace_dropped++;
+    }
+#endif
+}
+#endif
+
+
+
+const char *get_syscall_name(unsigned int code)
+{
+    return (code < NUM_SYSCALLS) ? syscall_names[code] : NULL;
+}
+
+
+
+void syscall_stats_dump(syscall_stats_t *stats, void (*write)(const void *data, unsigned int size))
+{
+    char line[96];
+    int length;
+
+    length = snprintf(line, sizeof(line), "%-18s %10s %12s %10s %10s\r\n", "syscall", "calls", "cycles", "average", "max");
+    write(line, length);
+
+    for(unsigned int code = 0; code < NUM_SYSCALLS; code++)
+    {
+        syscall_counters_t *counters = &stats->syscalls[code];
+
+        if(counters->calls == 0)
+        {
+            continue;
+        }
+
+        length = snprintf(line, sizeof(line), "%-18s %10u %12llu %10llu %10u\r\n",
+                          get_syscall_name(code), counters->calls, (unsigned long long) counters->total_cycles,
+                          (unsigned long long) (counters->total_cycles/counters->calls), counters->max_cycles);
+        write(line, length);
+    }
+
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        task_syscall_counters_t *counters = &stats->tasks[i];
+
+        if(counters->task_id < 0 || counters->calls == 0)
+        {
+            continue;
+        }
+
+        length = snprintf(line, sizeof(line), "task %-13d %10u %12llu %10llu\r\n",
+                          counters->task_id, counters->calls, (unsigned long long) counters->total_cycles,
+                          (unsigned long long) (counters->total_cycles/counters->calls));
+        write(line, length);
+    }
+}
+
+
+
+#ifdef CONFIG_SYSCALL_STRACE
+unsigned int syscall_strace_flush(syscall_stats_t *stats, unsigned int max_records, void (*write)(const void *data, unsigned int size))
+{
+    char line[128];
+    char name[16];
+    const char *syscall_name;
+    unsigned int count = 0;
+    unsigned int dropped;
+    int length;
+
+    while(count < max_records && stats->strace_head != stats->strace_tail)
+    {
+        strace_record_t *record = &stats->strace[stats->strace_head & STRACE_INDEX_MASK];
+
+        if((syscall_name = get_syscall_name(record->code)) == NULL)
+        {
+            snprintf(name, sizeof(name), "syscall_%u", (unsigned int) record->code);
+            syscall_name = name;
+        }
+
+        length = snprintf(line, sizeof(line), "[task %d] %s(%#x, %#x, %#x) = %d <%u cycles>\r\n",
+                          (int) record->task_id, syscall_name, (unsigned int) record->args[0],
+                          (unsigned int) record->args[1], (unsigned int) record->args[2],
+                          (int) record->result, (unsigned int) record->cycles);
+
+        // the record is free again once it is decoded
+        stats->strace_head++;
+        count++;
+
+        write(line, length);
+    }
+
+    // records were dropped after the ones just decoded, so they are reported once those are out
+    if(stats->strace_head == stats->strace_tail && (dropped = stats->strace_dropped) != 0)
+    {
+        stats->strace_dropped -= dropped;
+        length = snprintf(line, sizeof(line), "[strace] %u records dropped\r\n", dropped);
+        write(line, length);
+    }
+
+    return count;
+}
+#endif
@@ -5,145 +5,936 @@
  * This file implements a number of functions regarding task management.
  */
 
+#include <stdint.h>
+#include <string.h>
+
 #include "task.h"
+#include "mutex.h"
 #include "stdlib.h"
+#include "hardware.h"
+#include "trace.h"
+
+/*
+ * Linker script symbols. Only their addresses are meaningful:
+ * user stack space runs from the end of the user heap up to
+ * the top of user RAM.
+ */
+extern char _user_stack[];
+extern char _user_heap_end[];
+
+extern void _exit_main(int status);
+extern void _exit_task(int status);
+extern uint32_t *current_task_register_base;
+
+static void sleep_list_remove(task_table_t *table, task_control_block_t *task);
+
+
+static void init_stack_control_block(stack_control_block_t *stacks)
+{
+    uintptr_t top = ALIGN_STACK_DOWN((uintptr_t) _user_stack);
+    uintptr_t bottom = ALIGN_STACK_UP((uintptr_t) _user_heap_end);
+
+    // main stack is reserved for the root task at the top of the stack space
+    stacks->main_stack.top = (void*) top;
+    stacks->main_stack.size = MAIN_STACK_SIZE;
+
+    // everything below it is free
+    stacks->free_regions[0].base = bottom;
+    stacks->free_regions[0].size = top - MAIN_STACK_SIZE - bottom;
+    stacks->num_free_regions = 1;
+    stacks->free_bytes = stacks->free_regions[0].size;
+}
+
+
+/*
+ * Fills the whole stack with STACK_PAINT_WORD so that the high
+ * water mark can later be found from the first overwritten word.
+ */
+static void paint_stack(task_stack_t *stack)
+{
+    uint32_t *word = (uint32_t*)((uintptr_t) stack->top - stack->size);
+    uint32_t *top = (uint32_t*) stack->top;
+
+    while(word < top)
+    {
+        *word++ = STACK_PAINT_WORD;
+    }
+}
+
+
+static void remove_free_region(stack_control_block_t *stacks, int index)
+{
+    for(int i = index; i < stacks->num_free_regions - 1; i++)
+    {
+        stacks->free_regions[i] = stacks->free_regions[i + 1];
+    }
+
+    stacks->num_free_regions--;
+}
+
+
+/*
+ * Allocates a stack from the smallest free region that can hold
+ * it, taking it from the top of the region so that the rest of
+ * the region stays where it was. Returns 0 on success or
+ * ERROR_NO_STACK_SPACE if no free region is large enough.
+ */
+static int allocate_stack(stack_control_block_t *stacks, unsigned int size, task_stack_t *stack)
+{
+    int best = -1;
+
+    for(int i = 0; i < stacks->num_free_regions; i++)
+    {
+        if(stacks->free_regions[i].size >= size &&
+           (best < 0 || stacks->free_regions[i].size < stacks->free_regions[best].size))
+        {
+            best = i;
+        }
+    }
+
+    if(best < 0)
+    {
+        return ERROR_NO_STACK_SPACE;
+    }
+
+    stack_region_t *region = &stacks->free_regions[best];
+
+    stack->top = (void*)(region->base + region->size);
+    stack->size = size;
+
+    region->size -= size;
+    stacks->free_bytes -= size;
+
+    if(region->size == 0)
+    {
+        remove_free_region(stacks, best);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Returns a stack to the free regions, merging it with the free
+ * regions directly below and above it if there are any.
+ */
+static void free_stack(stack_control_block_t *stacks, task_stack_t *stack)
+{
+    uintptr_t base = (uintptr_t) stack->top - stack->size;
+    int index;
+
+    // index of the first free region above the stack
+    for(index = 0; index < stacks->num_free_regions; index++)
+    {
+        if(stacks->free_regions[index].base > base)
+        {
+            break;
+        }
+    }
+
+    stacks->free_bytes += stack->size;
+
+    int merges_below = (index > 0 &&
+        stacks->free_regions[index - 1].base + stacks->free_regions[index - 1].size == base);
+    int merges_above = (index < stacks->num_free_regions &&
+        stacks->free_regions[index].base == (uintptr_t) stack->top);
+
+    if(merges_below && merges_above)
+    {
+        stacks->free_regions[index - 1].size += stack->size + stacks->free_regions[index].size;
+        remove_free_region(stacks, index);
+    }
+    else if(merges_below)
+    {
+        stacks->free_regions[index - 1].size += stack->size;
+    }
+    else if(merges_above)
+    {
+        stacks->free_regions[index].base = base;
+        stacks->free_regions[index].size += stack->size;
+    }
+    else
+    {
+        for(int i = stacks->num_free_regions; i > index; i--)
+        {
+            stacks->free_regions[i] = stacks->free_regions[i - 1];
+        }
+
+        stacks->free_regions[index].base = base;
+        stacks->free_regions[index].size = stack->size;
+        stacks->num_free_regions++;
+    }
+
+    stack->top = NULL_POINTER;
+    stack->size = 0;
+}
+
+
+void task_table_init(task_table_t *table)
+{
+    table->num_tasks = 0;
+
+    // zero out task table
+    memset(table->tasks, 0, sizeof(task_control_block_t)*MAX_TASKS);
+
+    // no slot holds a valid task ID until it is allocated
+    for(int i = 0; i < MAX_TASKS; i++)
+    {
+        table->tasks[i].task_id = TASK_ID_NONE;
+    }
+
+    // set all bits in bitmask to free
+    table->free_task_bitmap = 0xFFFFFFFF;
+
+    // no tasks are ready to run yet
+    table->ready_bitmap = 0;
+    memset(table->ready_lists, 0, sizeof(task_control_block_t*)*NUM_PRIORITIES);
+
+    // no real-time tasks have been admitted yet
+    table->rt_ready_list = NULL_POINTER;
+    table->realtime_bitmap = 0;
+    table->rt_utilization = 0;
+    table->rt_next_event = RT_NO_EVENT;
+
+    table->sleep_list = NULL_POINTER;
+    table->sleep_wake_tick = 0;
+
+    // initialize the stack management data structure
+    init_stack_control_block(&table->task_stacks);
+
+    table->tasks[0].generation = 0;
+    table->tasks[0].task_id = MAKE_TASK_ID(0, 0);
+
+    table->tasks[0].parent = NULL_POINTER;
+    table->tasks[0].first_child = NULL_POINTER;
+    table->tasks[0].first_zombie = NULL_POINTER;
+    table->tasks[0].next_sibling = NULL_POINTER;
+    table->tasks[0].previous_sibling = NULL_POINTER;
+    table->tasks[0].num_children = 0;
+    wait_queue_init(&table->tasks[0].child_exit_queue);
+    table->tasks[0].blocked_on = NULL_POINTER;
+    table->tasks[0].priority = DEFAULT_TASK_PRIORITY;
+    table->tasks[0].base_priority = DEFAULT_TASK_PRIORITY;
+    table->tasks[0].waiting_mutex = NULL_POINTER;
+    table->tasks[0].held_mutexes = NULL_POINTER;
+    table->tasks[0].sched_class = SCHED_CLASS_BEST_EFFORT;
+    SET_TASK_IN_USE(table, 0);
+    table->num_tasks++;
+
+    table->tasks[0].stack = table->task_stacks.main_stack;
+    paint_stack(&table->tasks[0].stack);
+
+    /*
+     * The root task is the one that is running when the kernel
+     * jumps to main, so it is not placed on a ready list until
+     * it is switched off the CPU.
+     */
+    table->tasks[0].state = RUNNING;
+    table->tasks[0].next_task = NULL_POINTER;
+    table->tasks[0].previous_task = NULL_POINTER;
+
+    table->root = &table->tasks[0];
+    table->current_task = table->root;
+    table->switch_timestamp = read_cycle_counter();
+
+    // save root task registers
+    table->tasks[0].regs[REGISTER_SP] = (uint32_t)(uintptr_t) table->tasks[0].stack.top;
+    table->tasks[0].regs[REGISTER_FP] = (uint32_t)(uintptr_t) table->tasks[0].stack.top;
+    table->tasks[0].regs[REGISTER_RA] = (uint32_t)(uintptr_t) _exit_main; // need to define in userspace
+}
+
+
+
+/*
+ * Appends the task to the tail of the circular ready list
+ * for its priority and marks that priority as ready.
+ */
+static void ready_list_insert(task_table_t *table, task_control_block_t *task)
+{
+    task_control_block_t *head = table->ready_lists[task->priority];
+
+    if(head == NULL_POINTER)
+    {
+        task->next_task = task;
+        task->previous_task = task;
+        table->ready_lists[task->priority] = task;
+        SET_PRIORITY_READY(table, task->priority);
+    }
+    else
+    {
+        // the tail of a circular list is the element before the head
+        task->next_task = head;
+        task->previous_task = head->previous_task;
+        head->previous_task->next_task = task;
+        head->previous_task = task;
+    }
+}
+
+
+/*
+ * Unlinks the task from the ready list for its priority and
+ * clears the priority's ready bit if the list becomes empty.
+ */
+static void ready_list_remove(task_table_t *table, task_control_block_t *task)
+{
+    if(task->next_task == task)
+    {
+        table->ready_lists[task->priority] = NULL_POINTER;
+        SET_PRIORITY_EMPTY(table, task->priority);
+    }
+    else
+    {
+        task->previous_task->next_task = task->next_task;
+        task->next_task->previous_task = task->previous_task;
+
+        if(table->ready_lists[task->priority] == task)
+        {
+            table->ready_lists[task->priority] = task->next_task;
+        }
+    }
+
+    task->next_task = NULL_POINTER;
+    task->previous_task = NULL_POINTER;
+}
+
+
+/*
+ * Inserts the task into the real-time ready list in order of
+ * absolute deadline. Tasks with equal deadlines keep the order
+ * they were inserted in. Deadlines may wrap, so they are
+ * compared by their difference.
+ */
+static void rt_ready_list_insert(task_table_t *table, task_control_block_t *task)
+{
+    task_control_block_t *previous = NULL_POINTER;
+    task_control_block_t *current = table->rt_ready_list;
+
+    while(current != NULL_POINTER &&
+          (int)(current->rt.absolute_deadline - task->rt.absolute_deadline) <= 0)
+    {
+        previous = current;
+        current = current->next_task;
+    }
+
+    task->previous_task = previous;
+    task->next_task = current;
+
+    if(current != NULL_POINTER)
+    {
+        current->previous_task = task;
+    }
+
+    if(previous != NULL_POINTER)
+    {
+        previous->next_task = task;
+    }
+    else
+    {
+        table->rt_ready_list = task;
+    }
+}
+
+
+static void rt_ready_list_remove(task_table_t *table, task_control_block_t *task)
+{
+    if(task->previous_task != NULL_POINTER)
+    {
+        task->previous_task->next_task = task->next_task;
+    }
+    else
+    {
+        table->rt_ready_list = task->next_task;
+    }
+
+    if(task->next_task != NULL_POINTER)
+    {
+        task->next_task->previous_task = task->previous_task;
+    }
+
+    task->next_task = NULL_POINTER;
+    task->previous_task = NULL_POINTER;
+}
+
+
+// puts the task on the ready list for its scheduling class
+static void enqueue_task(task_table_t *table, task_control_block_t *task)
+{
+    if(task->sched_class == SCHED_CLASS_REALTIME)
+    {
+        rt_ready_list_insert(table, task);
+    }
+    else
+    {
+        ready_list_insert(table, task);
+    }
+}
+
+
+static void dequeue_task(task_table_t *table, task_control_block_t *task)
+{
+    if(task->sched_class == SCHED_CLASS_REALTIME)
+    {
+        rt_ready_list_remove(table, task);
+    }
+    else
+    {
+        ready_list_remove(table, task);
+    }
+}
+
+
+/*
+ * The child and zombie lists of a task are doubly linked
+ * through the sibling links and headed by a pointer in the
+ * parent, so pushing and removing are constant time.
+ */
+static void sibling_list_push(task_control_block_t **head, task_control_block_t *task)
+{
+    task->previous_sibling = NULL_POINTER;
+    task->next_sibling = *head;
+
+    if(*head != NULL_POINTER)
+    {
+        (*head)->previous_sibling = task;
+    }
+
+    *head = task;
+}
+
+
+static void sibling_list_remove(task_control_block_t **head, task_control_block_t *task)
+{
+    if(task->previous_sibling != NULL_POINTER)
+    {
+        task->previous_sibling->next_sibling = task->next_sibling;
+    }
+    else
+    {
+        *head = task->next_sibling;
+    }
+
+    if(task->next_sibling != NULL_POINTER)
+    {
+        task->next_sibling->previous_sibling = task->previous_sibling;
+    }
+
+    task->next_sibling = NULL_POINTER;
+    task->previous_sibling = NULL_POINTER;
+}
+
+
+static void add_child(task_control_block_t *parent, task_control_block_t *child)
+{
+    child->parent = parent;
+    sibling_list_push(&parent->first_child, child);
+    parent->num_children++;
+}
+
+
+// zombies are on the zombie list rather than the child list
+static void remove_child(task_control_block_t *child)
+{
+    task_control_block_t *parent = child->parent;
+
+    sibling_list_remove((child->state == TERMINATED) ? &parent->first_zombie : &parent->first_child, child);
+
+    child->parent = NULL_POINTER;
+    parent->num_children--;
+}
+
+
+/*
+ * Sets the parent of every task in the list and splices the
+ * whole list onto the front of the list at to, if there is one.
+ */
+static void splice_sibling_list(task_control_block_t **from, task_control_block_t **to, task_control_block_t *new_parent)
+{
+    task_control_block_t *task;
+    task_control_block_t *last_task = NULL_POINTER;
+
+    if(*from == NULL_POINTER)
+    {
+        return;
+    }
+
+    for(task = *from; task != NULL_POINTER; task = task->next_sibling)
+    {
+        task->parent = new_parent;
+        last_task = task;
+    }
+
+    if(to != NULL_POINTER)
+    {
+        last_task->next_sibling = *to;
+
+        if(*to != NULL_POINTER)
+        {
+            (*to)->previous_sibling = last_task;
+        }
+
+        *to = *from;
+    }
+
+    *from = NULL_POINTER;
+}
+
+
+/*
+ * Moves all children of the task, living or zombie, to the new
+ * parent, or orphans them if new_parent is NULL_POINTER. Each
+ * list is spliced on as a whole, so the only per-child work is
+ * updating each parent link. Orphans keep their sibling links,
+ * but no list reaches them anymore.
+ */
+static void reparent_children(task_control_block_t *task, task_control_block_t *new_parent)
+{
+    if(new_parent != NULL_POINTER)
+    {
+        splice_sibling_list(&task->first_child, &new_parent->first_child, new_parent);
+        splice_sibling_list(&task->first_zombie, &new_parent->first_zombie, new_parent);
+        new_parent->num_children += task->num_children;
+    }
+    else
+    {
+        splice_sibling_list(&task->first_child, NULL_POINTER, NULL_POINTER);
+        splice_sibling_list(&task->first_zombie, NULL_POINTER, NULL_POINTER);
+    }
+
+    task->num_children = 0;
+}
+
+
+
+void set_task_ready(task_table_t *table, task_control_block_t *task)
+{
+    if(task->state == READY || task->state == CREATED || task->state == RUNNING)
+    {
+        return;
+    }
+
+    // woken before its timeout ran out
+    if(IS_TASK_SLEEPING(table, task))
+    {
+        sleep_list_remove(table, task);
+    }
+
+    task->state = READY;
+    task->stats.ready_timestamp = read_cycle_counter();
+    enqueue_task(table, task);
+}
+
+
+void set_task_blocked(task_table_t *table, task_control_block_t *task)
+{
+    if(task->state == READY || task->state == CREATED)
+    {
+        dequeue_task(table, task);
+    }
+
+    task->state = BLOCKED;
+}
+
+
+void set_task_priority(task_table_t *table, task_control_block_t *task, unsigned int priority)
+{
+    int is_queued = (task->state == READY || task->state == CREATED);
+
+    if(is_queued)
+    {
+        dequeue_task(table, task);
+    }
+
+    task->priority = priority;
+
+    if(is_queued)
+    {
+        enqueue_task(table, task);
+    }
+}
+
+
+void set_task_sched_class(task_table_t *table, task_control_block_t *task, unsigned int sched_class)
+{
+    int is_queued = (task->state == READY || task->state == CREATED);
+
+    if(is_queued)
+    {
+        dequeue_task(table, task);
+    }
+
+    task->sched_class = sched_class;
+
+    if(is_queued)
+    {
+        enqueue_task(table, task);
+    }
+}
+
+
+void wait_queue_init(wait_queue_t *queue)
+{
+    queue->head = NULL_POINTER;
+    queue->tail = NULL_POINTER;
+}
+
+
+void wait_queue_block(task_table_t *table, wait_queue_t *queue, task_control_block_t *task)
+{
+    set_task_blocked(table, task);
+
+    // append, so tasks are woken in the order they blocked
+    task->next_task = NULL_POINTER;
+    task->previous_task = queue->tail;
+
+    if(queue->tail != NULL_POINTER)
+    {
+        queue->tail->next_task = task;
+    }
+    else
+    {
+        queue->head = task;
+    }
 
-extern void *_user_stack;
-extern void *_user_heap_end;
-extern void _exit_main(int status);
-extern void _exit_task(int status);
-extern uint32_t *current_task_register_base;
+    queue->tail = task;
+    task->blocked_on = queue;
+}
 
 
-static void init_stack_control_block(stack_control_block_t *stacks)
+void wait_queue_block_by_priority(task_table_t *table, wait_queue_t *queue, task_control_block_t *task)
+{
+    task_control_block_t *next = queue->head;
+    unsigned int priority = TASK_WAIT_PRIORITY(task);
+
+    set_task_blocked(table, task);
+
+    while(next != NULL_POINTER && TASK_WAIT_PRIORITY(next) <= priority)
+    {
+        next = next->next_task;
+    }
+
+    // inserted in front of the first lower priority waiter
+    task->next_task = next;
+    task->previous_task = (next != NULL_POINTER) ? next->previous_task : queue->tail;
+
+    if(task->previous_task != NULL_POINTER)
+    {
+        task->previous_task->next_task = task;
+    }
+    else
+    {
+        queue->head = task;
+    }
+
+    if(next != NULL_POINTER)
+    {
+        next->previous_task = task;
+    }
+    else
+    {
+        queue->tail = task;
+    }
+
+    task->blocked_on = queue;
+}
+
+
+void wait_queue_remove(wait_queue_t *queue, task_control_block_t *task)
+{
+    if(task->previous_task != NULL_POINTER)
+    {
+        task->previous_task->next_task = task->next_task;
+    }
+    else
+    {
+        queue->head = task->next_task;
+    }
+
+    if(task->next_task != NULL_POINTER)
+    {
+        task->next_task->previous_task = task->previous_task;
+    }
+    else
+    {
+        queue->tail = task->previous_task;
+    }
+
+    task->next_task = NULL_POINTER;
+    task->previous_task = NULL_POINTER;
+    task->blocked_on = NULL_POINTER;
+}
+
+
+task_control_block_t *wait_queue_wake_one(task_table_t *table, wait_queue_t *queue)
+{
+    task_control_block_t *task = queue->head;
+
+    if(task != NULL_POINTER)
+    {
+        wait_queue_remove(queue, task);
+        set_task_ready(table, task);
+    }
+
+    return task;
+}
+
+
+void wait_queue_wake_all(task_table_t *table, wait_queue_t *queue)
 {
-    stacks->main_stack.top = _user_stack;
-    stacks->free_stack_bitmap = 0xFFFFFFFF;
+    while(wait_queue_wake_one(table, queue) != NULL_POINTER);
+}
+
 
-    // stacks must be aligned to 8-byte boundary
-    stacks->stacks[0].top = (void*)(((_user_stack - _user_heap_end)/2) & 0xFFFFFFF8);
 
-    for(int i = 1; i < MAX_TASKS - 1; i++)
+/*
+ * Takes a task out of the sleep list. The ticks it was waiting
+ * after its predecessor are handed on to its successor, or, if
+ * it was the head, the successor becomes the new head.
+ */
+static void sleep_list_remove(task_table_t *table, task_control_block_t *task)
+{
+    task_control_block_t *next = task->next_sleeper;
+
+    if(next != NULL_POINTER)
     {
-        if(IS_LEFT_CHILD(i))
+        if(task == table->sleep_list)
         {
-            int parent_index = PARENT_INDEX(i);
-            int next_lowest_index = GET_NEXT_LOWEST_STACK_INDEX(i);
-
-            if(next_lowest_index == ABSOLUTE_BOTTOM)
-            {
-                // aligned to 8-byte boundary
-                stacks->stacks[i].top = ((stacks->stacks[parent_index].top - _user_heap_end)/2) & 0xFFFFFFF8;
-            }
-            else
-            {
-                // aligned to 8-byte boundary
-                stacks->stacks[i].top = ((stacks->stacks[parent_index].top - 
-                    stacks->stacks[next_lowest_index].top)/2) & 0xFFFFFFF8;
-            }
+            table->sleep_wake_tick += next->sleep_delta;
+            next->sleep_delta = 0;
         }
         else
         {
-            int parent_index = PARENT_INDEX(i);
-            int next_highest_index = GET_NEXT_HIGHEST_STACK_INDEX(i);
-
-            if(next_highest_index == ABSOLUTE_TOP)
-            {
-                // aligned to 8-byte boundary
-                stacks->stacks[i].top = ((_user_stack - stacks->stacks[parent_index].top)/2) & 0xFFFFFFF8;
-            }
-            else
-            {
-                // aligned to 8-byte boundary
-                stacks->stacks[i].top = ((stacks->stacks[next_highest_index].top - 
-                    stacks->stacks[parent_index].top)/2) & 0xFFFFFFF8;
-            }
+            next->sleep_delta += task->sleep_delta;
         }
+
+        next->previous_sleeper = task->previous_sleeper;
+    }
+
+    if(task->previous_sleeper != NULL_POINTER)
+    {
+        task->previous_sleeper->next_sleeper = next;
+    }
+    else
+    {
+        table->sleep_list = next;
     }
+
+    task->next_sleeper = NULL_POINTER;
+    task->previous_sleeper = NULL_POINTER;
 }
 
 
-static int get_next_available_stack_index(stack_control_block_t *stack_cb)
+/*
+ * Puts a task into the sleep list to wake at wake_tick, after
+ * every task waking at or before it so equal wakeups keep their
+ * order. The caller makes sure wake_tick is after now.
+ */
+static void sleep_list_insert(task_table_t *table, task_control_block_t *task, unsigned int wake_tick)
 {
-    int index;
+    task_control_block_t *head = table->sleep_list;
+    task_control_block_t *previous;
+    unsigned int delta;
 
-    for(index = 0; index < MAX_TASKS; index++)
+    // wakes before everything else, so becomes the new head
+    if(head == NULL_POINTER || (int)(wake_tick - table->sleep_wake_tick) < 0)
     {
-        if(IS_STACK_FREE(stack_cb, index))
+        if(head != NULL_POINTER)
         {
-            break;
+            head->sleep_delta = table->sleep_wake_tick - wake_tick;
+            head->previous_sleeper = task;
         }
+
+        task->next_sleeper = head;
+        task->previous_sleeper = NULL_POINTER;
+        task->sleep_delta = 0;
+
+        table->sleep_list = task;
+        table->sleep_wake_tick = wake_tick;
+
+        return;
+    }
+
+    previous = head;
+    delta = wake_tick - table->sleep_wake_tick;
+
+    while(previous->next_sleeper != NULL_POINTER && previous->next_sleeper->sleep_delta <= delta)
+    {
+        previous = previous->next_sleeper;
+        delta -= previous->sleep_delta;
+    }
+
+    task->sleep_delta = delta;
+    task->previous_sleeper = previous;
+    task->next_sleeper = previous->next_sleeper;
+
+    if(task->next_sleeper != NULL_POINTER)
+    {
+        task->next_sleeper->sleep_delta -= delta;
+        task->next_sleeper->previous_sleeper = task;
     }
 
-    return (index < MAX_TASKS) ? index : -1;
+    previous->next_sleeper = task;
 }
 
 
-void task_table_init(task_table_t *table)
+int sleep_task_until(task_table_t *table, task_control_block_t *task, unsigned int wake_tick, unsigned int now)
 {
-    table->next_available_task_number = 0;
+    if((int)(wake_tick - now) <= 0)
+    {
+        return 0;
+    }
 
-    // zero out task table
-    memset(table->tasks, 0, sizeof(task_control_block_t)*MAX_TASKS);
+    set_task_blocked(table, task);
+    sleep_list_insert(table, task, wake_tick);
 
-    // set all bits in bitmask to free
-    memset(table->free_task_bitmap, 0xff, MAX_TASKS/8);
+    return 1;
+}
 
-    // initialize the stack management data structure
-    init_stack_control_block(&table->task_stacks);
 
-    table->tasks[0].task_id = table->next_available_task_number;
-    table->next_available_task_number++;
+void set_task_timeout(task_table_t *table, task_control_block_t *task, unsigned int timeout, unsigned int now)
+{
+    if(timeout == WAIT_FOREVER)
+    {
+        return;
+    }
 
-    table->tasks[0].parent_task_id = TASK_ID_NONE;
-    table->tasks[0].state = CREATED;
-    table->tasks[0].num_children = 0;
-    SET_TASK_IN_USE(table, 0);
+    if(timeout > SLEEP_MAX_TICKS) timeout = SLEEP_MAX_TICKS;
 
-    table->tasks[0].stack = &table->task_stacks.main_stack;
-    table->tasks[0].stack_index = -1;
-    
-    // set up task scheduling linked list with root task
-    table->tasks[0].next_task = &table->tasks[0];
-    table->tasks[0].previous_task = &table->tasks[0];
+    sleep_list_insert(table, task, now + timeout);
+}
 
-    table->current_task = table->root;
 
-    // save root task registers
-    table->tasks[0].regs[REGISTER_SP] = _user_stack;
-    table->tasks[0].regs[REGISTER_FP] = _user_stack;
-    table->tasks[0].regs[REGISTER_RA] = _exit_main; // need to define in userspace
+void wake_sleeping_tasks(task_table_t *table, unsigned int now)
+{
+    task_control_block_t *task;
+
+    while((task = table->sleep_list) != NULL_POINTER && (int)(now - table->sleep_wake_tick) >= 0)
+    {
+        sleep_list_remove(table, task);
+
+        if(task->blocked_on != NULL_POINTER)
+        {
+            // nothing woke it before the timeout ran out
+            wait_queue_remove(task->blocked_on, task);
+            task->regs[REGISTER_V0] = ERROR_TIMED_OUT;
+        }
+        else
+        {
+            // the sleep system call returns the tick the task woke at
+            task->regs[REGISTER_V0] = now;
+        }
+
+        set_task_ready(table, task);
+    }
 }
 
 
+
+/*
+ * Picks the next task to run. The current task, if it is still
+ * runnable, goes to the back of the ready list for its priority
+ * so that tasks of equal priority are scheduled round-robin.
+ * Ready real-time tasks always run first, earliest deadline
+ * first. Otherwise the next task is the head of the highest
+ * priority non-empty ready list, which is found from the ready
+ * bitmap in constant time. If no task is ready, the idle task
+ * runs instead.
+ */
 void schedule_next_task(task_table_t *table)
 {
+    task_control_block_t *next_task;
+    int priority;
+    unsigned int now = read_cycle_counter();
+    unsigned int wait;
+
+    // charge the outgoing task for the time since it was switched in
+    table->current_task->stats.run_cycles += now - table->switch_timestamp;
+    table->switch_timestamp = now;
+
     // set current task into ready to be scheduled state
-    table->current_task->state = READY;
-    table->current_task = table->current_task->next_task;
+    if(table->current_task == &table->idle_task)
+    {
+        table->idle_task.state = READY;
+    }
+    else if(table->current_task->state == RUNNING)
+    {
+        table->current_task->state = READY;
+        table->current_task->stats.ready_timestamp = now;
+        enqueue_task(table, table->current_task);
+    }
+
+    // nothing is runnable, so run the idle task until something is
+    if(!IS_ANY_TASK_READY(table))
+    {
+        table->idle_task.state = RUNNING;
+        table->idle_task.stats.num_switches++;
+        table->current_task = &table->idle_task;
+        current_task_register_base = table->idle_task.regs;
+        TRACE(TRACE_EVENT_SWITCH, TRACE_IDLE_TASK);
+        return;
+    }
 
-    // should check here for case where no tasks are ready and sleep
-    while(table->current_task->state != READY && table->current_task->state != CREATED)
+    if(table->rt_ready_list != NULL_POINTER)
+    {
+        next_task = table->rt_ready_list;
+        rt_ready_list_remove(table, next_task);
+    }
+    else
     {
-        table->current_task = table->current_task->next_task;
+        priority = HIGHEST_READY_PRIORITY(table);
+        next_task = table->ready_lists[priority];
+        ready_list_remove(table, next_task);
     }
+
+    // time from becoming ready until now goes into the wait histogram
+    wait = now - next_task->stats.ready_timestamp;
+    next_task->stats.wait_histogram[WAIT_HISTOGRAM_BUCKET(wait)]++;
+    next_task->stats.num_switches++;
+
+    next_task->state = RUNNING;
+    table->current_task = next_task;
     
     current_task_register_base = table->current_task->regs;
+    TRACE(TRACE_EVENT_SWITCH, next_task->task_id);
 }
 
 
 
 task_control_block_t *get_task(task_table_t *table, int task_id)
 {
-    task_control_block_t *task = NULL_POINTER;
+    if(task_id < 0)
+    {
+        return NULL_POINTER;
+    }
+
+    /*
+     * Free slots hold TASK_ID_NONE, and reused slots hold an ID
+     * with a newer generation, so a single compare rejects both
+     * stale and never-allocated IDs.
+     */
+    task_control_block_t *task = &table->tasks[TASK_ID_INDEX(task_id)];
+
+    return (TASK_ID_INDEX(task_id) < MAX_TASKS && task->task_id == task_id) ? task : NULL_POINTER;
+}
+
+
+taskid_t get_current_task(task_table_t *table)
+{
+    return table->current_task->task_id;
+}
 
-    for(int i = 0; i < MAX_TASKS; i++)
+
+int set_task_register_value(task_table_t *table, int task_id, int register_number, unsigned int value)
+{
+    task_control_block_t *task = get_task(table, task_id);
+
+    if(task == NULL_POINTER)
     {
-        if(!IS_TASK_FREE(table, i) && task_id == table->tasks[i].task_id)
-            task = &table->tasks[i];
+        return ERROR_TASK_NOT_FOUND;
     }
 
-    return task;
+    task->regs[register_number] = value;
+
+    return 0;
 }
 
 
@@ -153,56 +944,273 @@ void run_task(int task_id)
 }
 
 
-taskid_t create_task(task_table_t *table, int parent_task_id, void *function)
+taskid_t create_task(task_table_t *table, int parent_task_id, void *function, unsigned int priority, unsigned int stack_size)
 {
+    if(priority >= NUM_PRIORITIES) return ERROR_INVALID_PRIORITY;
+
+    // find parent task and return error if not found
+    task_control_block_t *parent_task = get_task(table, parent_task_id);
+    if(parent_task == NULL_POINTER) return ERROR_TASK_NOT_FOUND;
 
     // get next free task
     int index = GET_NEXT_FREE_TASK_INDEX(table);
     if(index < 0) return ERROR_TASK_TABLE_FULL;
     task_control_block_t *new_task = &table->tasks[index];
-    SET_TASK_IN_USE(table, index);
 
-    // find parent task and return error if not found
-    task_control_block_t *parent_task = get_task(table, parent_task_id);
-    if(parent_task == NULL_POINTER) return ERROR_TASK_NOT_FOUND;
-    
-    // get the next available stack region and add to task control block
-    int stack_index = get_next_available_stack_index(&table->task_stacks);
-    SET_STACK_IN_USE(&table->task_stacks, stack_index);
-    new_task->stack_index = stack_index;
-    new_task->stack = &table->task_stacks.stacks[stack_index];
+    if(stack_size == 0) stack_size = DEFAULT_STACK_SIZE;
+    if(stack_size < MIN_STACK_SIZE) stack_size = MIN_STACK_SIZE;
+
+    // allocate and paint a stack before the slot is taken, so failure leaves nothing to undo
+    if(allocate_stack(&table->task_stacks, ALIGN_STACK_UP(stack_size), &new_task->stack) < 0)
+    {
+        return ERROR_NO_STACK_SPACE;
+    }
+
+    paint_stack(&new_task->stack);
+    SET_TASK_IN_USE(table, index);
 
-    // get next task ID for new task
-    new_task->task_id = table->next_available_task_number;
-    table->next_available_task_number++;
+    // new generation for the slot so old IDs for it become stale
+    new_task->generation = (new_task->generation + 1) & TASK_ID_GENERATION_MASK;
+    new_task->task_id = MAKE_TASK_ID(index, new_task->generation);
 
     // init task regs
     memset(new_task->regs, 0, (NUM_REGS+1)*BYTES_PER_REGISTER);
-    new_task->regs[REGISTER_SP] = new_task->stack->top;
-    new_task->regs[REGISTER_FP] = new_task->stack->top;
-    new_task->regs[REGISTER_RA] = _exit_task;
-    new_task->regs[REGISTER_PC] = function;
+    new_task->regs[REGISTER_SP] = (uint32_t)(uintptr_t) new_task->stack.top;
+    new_task->regs[REGISTER_FP] = (uint32_t)(uintptr_t) new_task->stack.top;
+    new_task->regs[REGISTER_RA] = (uint32_t)(uintptr_t) _exit_task;
+    new_task->regs[REGISTER_PC] = (uint32_t)(uintptr_t) function;
 
-    // init new task child tasks
+    // new task has no children yet and is not waiting for any
     new_task->num_children = 0;
-    memset(new_task->child_task_ids, 0, sizeof(int)*MAX_CHILDREN);
-    memset(new_task->child_task_bitmask, 0, MAX_CHILDREN/8);
-
-    // add to scheduling list
-    task_control_block_t *next_task = table->current_task->next_task;
-    next_task->previous_task = new_task;
-    new_task->next_task = next_task;
-    table->current_task->next_task = new_task;
-    new_task->previous_task = table->current_task;
+    new_task->first_child = NULL_POINTER;
+    new_task->first_zombie = NULL_POINTER;
+    new_task->exit_status = 0;
+    wait_queue_init(&new_task->child_exit_queue);
+    new_task->blocked_on = NULL_POINTER;
+
+    new_task->waiting_mutex = NULL_POINTER;
+    new_task->held_mutexes = NULL_POINTER;
+    new_task->next_sleeper = NULL_POINTER;
+    new_task->previous_sleeper = NULL_POINTER;
+
+    // add to the ready list for its priority
+    new_task->priority = priority;
+    new_task->base_priority = priority;
+    new_task->sched_class = SCHED_CLASS_BEST_EFFORT;
+    memset(&new_task->rt, 0, sizeof(realtime_state_t));
+    memset(&new_task->stats, 0, sizeof(task_stats_t));
+    new_task->stats.ready_timestamp = read_cycle_counter();
+    new_task->state = CREATED;
+    ready_list_insert(table, new_task);
     
-    // add new task to children of parent
-    new_task->parent_task_id = parent_task_id;
-    int child_index = FIRST_FREE_CHILD_INDEX(parent_task);
-    SET_CHILD_ACTIVE(parent_task, child_index);
-    parent_task->child_task_ids[child_index] = new_task->task_id;
-    parent_task->num_children++;
+    add_child(parent_task, new_task);
 
     table->num_tasks++;
 
     return new_task->task_id;
-}
\ No newline at end of file
+}
+
+
+
+/*
+ * Takes the task out of scheduling: off its ready list or wait
+ * queue, out of any mutexes, and out of the real-time class. Its
+ * children are handed to the root task.
+ */
+static void detach_task(task_table_t *table, task_control_block_t *task)
+{
+    int index = task - table->tasks;
+
+    // stops waiting for a mutex and hands on the contended ones it holds
+    mutex_release_task(table, task);
+
+    if(task->state == READY || task->state == CREATED)
+    {
+        dequeue_task(table, task);
+    }
+    else if(task->blocked_on != NULL_POINTER)
+    {
+        wait_queue_remove(task->blocked_on, task);
+    }
+
+    if(IS_TASK_SLEEPING(table, task))
+    {
+        sleep_list_remove(table, task);
+    }
+
+    // release the CPU share reserved by a real-time task
+    if(task->sched_class == SCHED_CLASS_REALTIME)
+    {
+        table->rt_utilization -= task->rt.utilization;
+        table->realtime_bitmap &= ~(0x1u << index);
+        task->sched_class = SCHED_CLASS_BEST_EFFORT;
+    }
+
+    reparent_children(task, (task == table->root) ? NULL_POINTER : table->root);
+}
+
+
+void free_task(task_table_t *table, task_control_block_t *task)
+{
+    int index = task - table->tasks;
+
+    // a zombie was already detached when it exited
+    if(task->state != TERMINATED)
+    {
+        detach_task(table, task);
+    }
+
+    if(task->parent != NULL_POINTER)
+    {
+        remove_child(task);
+    }
+
+    // the main stack is not part of the allocator
+    if(task->stack.top != table->task_stacks.main_stack.top)
+    {
+        free_stack(&table->task_stacks, &task->stack);
+    }
+
+    // generation is kept so the next task in this slot gets a new ID
+    task->task_id = TASK_ID_NONE;
+    task->state = TERMINATED;
+    SET_TASK_FREE(table, index);
+
+    table->num_tasks--;
+}
+
+
+
+/*
+ * Frees a zombie child for its parent and hands back its ID and
+ * exit status. Freeing the slot and stack does not depend on the
+ * number of tasks, since the zombie is unlinked from its parent's
+ * zombie list directly.
+ */
+static taskid_t reap_task(task_table_t *table, task_control_block_t *zombie, int *status)
+{
+    taskid_t task_id = zombie->task_id;
+
+    if(status != NULL_POINTER)
+    {
+        *status = zombie->exit_status;
+    }
+
+    free_task(table, zombie);
+
+    return task_id;
+}
+
+
+void exit_task(task_table_t *table, task_control_block_t *task, int status)
+{
+    task_control_block_t *parent = task->parent;
+
+    detach_task(table, task);
+
+    task->exit_status = status;
+
+    // nobody can wait for a task without a parent
+    if(parent == NULL_POINTER)
+    {
+        free_task(table, task);
+        return;
+    }
+
+    // move from the parent's child list to its zombie list
+    sibling_list_remove(&parent->first_child, task);
+    task->state = TERMINATED;
+    sibling_list_push(&parent->first_zombie, task);
+
+    if(parent->blocked_on == &parent->child_exit_queue &&
+       (parent->waiting_for == WAIT_ANY_CHILD || parent->waiting_for == task->task_id))
+    {
+        // the parent's wait system call returns the reaped task's ID
+        parent->regs[REGISTER_V0] = reap_task(table, task, parent->wait_status);
+        wait_queue_wake_all(table, &parent->child_exit_queue);
+    }
+}
+
+
+int wait_task(task_table_t *table, taskid_t task_id, int *status)
+{
+    task_control_block_t *parent = table->current_task;
+    task_control_block_t *child;
+
+    if(task_id == WAIT_ANY_CHILD)
+    {
+        if(parent->first_zombie != NULL_POINTER)
+        {
+            return reap_task(table, parent->first_zombie, status);
+        }
+
+        if(parent->first_child == NULL_POINTER)
+        {
+            return ERROR_NO_CHILDREN;
+        }
+    }
+    else
+    {
+        child = get_task(table, task_id);
+
+        if(child == NULL_POINTER || child->parent != parent)
+        {
+            return ERROR_TASK_NOT_FOUND;
+        }
+
+        if(child->state == TERMINATED)
+        {
+            return reap_task(table, child, status);
+        }
+    }
+
+    parent->waiting_for = task_id;
+    parent->wait_status = status;
+    wait_queue_block(table, &parent->child_exit_queue, parent);
+
+    return 0;
+}
+
+
+
+int get_task_stats(task_table_t *table, int task_id, task_stats_t *stats)
+{
+    task_control_block_t *task = get_task(table, task_id);
+
+    if(task == NULL_POINTER)
+    {
+        return ERROR_TASK_NOT_FOUND;
+    }
+
+    *stats = task->stats;
+
+    if(task == table->current_task)
+    {
+        stats->run_cycles += read_cycle_counter() - table->switch_timestamp;
+    }
+
+    return 0;
+}
+
+
+
+int get_stack_high_water_mark(task_table_t *table, int task_id)
+{
+    task_control_block_t *task = get_task(table, task_id);
+
+    if(task == NULL_POINTER)
+    {
+        return ERROR_TASK_NOT_FOUND;
+    }
+
+    uint32_t *word = (uint32_t*)((uintptr_t) task->stack.top - task->stack.size);
+    uint32_t *top = (uint32_t*) task->stack.top;
+
+    // the stack grows down, so the lowest overwritten word is the deepest point reached
+    while(word < top && *word == STACK_PAINT_WORD)
+    {
+        word++;
+    }
+
+    return (uintptr_t) top - (uintptr_t) word;
+}
@@ -1,6 +1,9 @@
 
 
+#include <string.h>
+
 #include "timers.h"
+#include "trace.h"
 #include "kdefs.h"
 
 
@@ -9,26 +12,52 @@ static timer_callback_table_t callback_table;
 static system_time_t previous_system_time;
 
 /*
- * The following three functions are wrappers
- * for accessing the device driver table to find
- * callback functions for a set timer event.
+ * Converts the requested timer duration into a number of
+ * system ticks, rounding up so that a timer never expires
+ * early. Every timer lasts at least one tick.
  */
-
-static void set_one_time_hardware_timer(int timer_number, timer_info_t *info)
+static unsigned int timer_info_to_ticks(timer_info_t *info)
 {
-    // TODO: implement
-}
+    unsigned int ticks;
+    unsigned int sub_milli_ns;
 
+    ticks = info->seconds*TICK_RATE_HZ;
+    ticks += (info->milli*TICK_RATE_HZ + 999)/1000;
 
-static void set_n_times_hardware_timer(int timer_number, timer_info_t *info, int n)
-{
-    // TODO: implement
+    sub_milli_ns = info->micro*1000 + info->nano;
+    ticks += (sub_milli_ns*(TICK_RATE_HZ/1000) + 999999)/1000000;
+
+    return (ticks == 0) ? 1 : ticks;
 }
 
 
-static void set_repeating_hardware_timer(int timer_number, timer_info_t *info)
+/*
+ * Recomputes the earliest expiry of all pending timers.
+ * Only needed when a timer expires or is cancelled, not on
+ * every tick.
+ */
+static void update_next_expiry()
 {
-    // TODO: implement
+    unsigned int earliest = TIMER_NO_EXPIRY;
+    unsigned int earliest_delta = TIMER_NO_EXPIRY;
+
+    for(int index = 0; index < MAX_TIMERS; index++)
+    {
+        if(IS_TIMER_FREE(&timer_cb, index))
+        {
+            continue;
+        }
+
+        unsigned int delta = timer_cb.timers[index].expiry - timer_cb.ticks;
+
+        if(delta < earliest_delta)
+        {
+            earliest_delta = delta;
+            earliest = timer_cb.timers[index].expiry;
+        }
+    }
+
+    timer_cb.next_expiry = earliest;
 }
 
 
@@ -42,6 +71,9 @@ void init_timer_system()
 {
     memset(timer_cb.timers, 0, sizeof(software_timer_t)*MAX_TIMERS);
     memset(timer_cb.timer_bitmap, 0xFF, MAX_TIMERS/8);
+    timer_cb.num_timers = 0;
+    timer_cb.ticks = 0;
+    timer_cb.next_expiry = TIMER_NO_EXPIRY;
     memset(callback_table.handlers, 0, sizeof(timer_callback_table_entry_t)*MAX_TIMER_CALLBACKS);
     memset(callback_table.free_handler_bitmap, 0xff, MAX_TIMER_CALLBACKS/8);
 }
@@ -82,7 +114,10 @@ int start_timer(int type, int repeat, timer_info_t *info, timer_callback_t callb
     int timer_number;
     software_timer_t *timer;
 
+    if(type == TIMER_TYPE_REPEAT_N && repeat < 1) return -1;
+
     timer_number = GET_NEXT_AVAILABLE_TIMER_INDEX(&timer_cb);
+    if(timer_number >= MAX_TIMERS) return -1;
     timer = &timer_cb.timers[timer_number];
     SET_TIMER_IN_USE(&timer_cb, timer_number);
 
@@ -93,28 +128,44 @@ int start_timer(int type, int repeat, timer_info_t *info, timer_callback_t callb
     {
         case TIMER_TYPE_REPEATING:
             timer->type = 0b00;
-            set_repeating_hardware_timer(timer_number, info);
             break;
 
         case TIMER_TYPE_ONCE:
             timer->type = 0b01;
-            set_one_time_hardware_timer(timer_number, info);
             break;
 
         case TIMER_TYPE_REPEAT_N:
             timer->type = 0b10;
-            set_n_times_hardware_timer(timer_number, info, repeat);
+            timer->repeats_left = repeat;
             break;
         
         default:
             break;
     }
+
+    timer->period = timer_info_to_ticks(info);
+    timer->expiry = timer_cb.ticks + timer->period;
+    timer_cb.num_timers++;
+
+    // TIMER_NO_EXPIRY is reserved, so such timers fire one tick late
+    if(timer->expiry == TIMER_NO_EXPIRY) timer->expiry++;
+
+    if(timer_cb.next_expiry == TIMER_NO_EXPIRY ||
+       timer->expiry - timer_cb.ticks < timer_cb.next_expiry - timer_cb.ticks)
+    {
+        timer_cb.next_expiry = timer->expiry;
+    }
     
     return timer_number;
 }
 
 
-void cancel_timer(int timer_number)
+/*
+ * Frees the timer's slot without recomputing the next
+ * expiry, so that the tick handler can release several
+ * expired timers and recompute only once.
+ */
+static void release_timer(int timer_number)
 {
     software_timer_t *timer = &timer_cb.timers[timer_number];
     int callback_index = timer->callback_function_index;
@@ -132,3 +183,66 @@ void cancel_timer(int timer_number)
     SET_TIMER_FREE(&timer_cb, timer_number);
     timer_cb.num_timers--;
 }
+
+
+void cancel_timer(int timer_number)
+{
+    release_timer(timer_number);
+    update_next_expiry();
+}
+
+
+unsigned int get_system_ticks()
+{
+    return timer_cb.ticks;
+}
+
+
+unsigned int get_next_timer_expiry()
+{
+    return timer_cb.next_expiry;
+}
+
+
+void timer_tick(unsigned int elapsed_ticks)
+{
+    timer_cb.ticks += elapsed_ticks;
+
+    // nothing expires on most ticks
+    if(timer_cb.next_expiry == TIMER_NO_EXPIRY || (int)(timer_cb.ticks - timer_cb.next_expiry) < 0)
+    {
+        return;
+    }
+
+    for(int index = 0; index < MAX_TIMERS; index++)
+    {
+        software_timer_t *timer = &timer_cb.timers[index];
+
+        if(IS_TIMER_FREE(&timer_cb, index) || (int)(timer_cb.ticks - timer->expiry) < 0)
+        {
+            continue;
+        }
+
+        timer_callback_t callback = callback_table.handlers[timer->callback_function_index].handler;
+
+        TRACE(TRACE_EVENT_TIMER_EXPIRY, index);
+
+        // rearm or release the timer before the callback so it may start new timers
+        if(timer->type == 0b00 || (timer->type == 0b10 && --timer->repeats_left > 0))
+        {
+            timer->expiry += timer->period;
+            if(timer->expiry == TIMER_NO_EXPIRY) timer->expiry++;
+        }
+        else
+        {
+            release_timer(index);
+        }
+
+        if(callback != NULL_POINTER)
+        {
+            callback(timer_cb.ticks);
+        }
+    }
+
+    update_next_expiry();
+}
@@ -0,0 +1,28 @@
+/*
+ * Event trace buffer. See trace.h.
+ */
+
+#include "trace.h"
+
+
+
+void trace_init(trace_buffer_t *buffer)
+{
+    buffer->magic = TRACE_MAGIC;
+    buffer->version = TRACE_VERSION;
+    buffer->num_records = TRACE_BUFFER_SIZE;
+    buffer->counter_frequency = get_cycle_counter_frequency();
+    buffer->next = 0;
+}
+
+
+void trace_event(unsigned int event, unsigned int data)
+{
+    TRACE(event, data);
+}
+
+
+void trace_dump(trace_buffer_t *buffer, void (*write)(const void *data, unsigned int size))
+{
+    write(buffer, sizeof(trace_buffer_t));
+}
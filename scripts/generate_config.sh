@@ -0,0 +1,49 @@
+#! /bin/bash
+
+# Generates the kernel configuration header from kernel.cfg
+# and prints it. The build includes the header ahead of every
+# source file, so each variable with the M_ prefix or no prefix
+# is defined as a macro named after the variable without its
+# M_ prefix. A value of Y defines the macro as 1 and a value
+# of N leaves it undefined. Variables with the LD_ prefix only
+# become linker symbols, see get_ld_config.sh.
+#
+# Usage: generate_config.sh kernel.cfg > kernel_config.h
+
+
+config_file=$1
+
+echo "/*"
+echo " * Generated from $(basename "$config_file") by $(basename "$0"). Do not edit."
+echo " */"
+echo
+echo "#ifndef KERNEL_CONFIG_H"
+echo "#define KERNEL_CONFIG_H"
+echo
+
+while IFS='=' read -r name value
+do
+    case $name in
+        LD_*|"")
+            continue
+            ;;
+    esac
+
+    macro=${name#M_}
+
+    case $value in
+        Y)
+            echo "#define $macro 1"
+            ;;
+        N)
+            echo "#undef $macro"
+            ;;
+        *)
+            echo "#define $macro $value"
+            ;;
+    esac
+
+done < <(sed -e 's/#.*//' -e 's/[[:space:]]//g' -e '/^$/d' "$config_file")
+
+echo
+echo "#endif"
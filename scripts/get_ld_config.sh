@@ -4,4 +4,32 @@
 # linker script to work properly. It searches for
 # the config variables that the linker will need
 # and then exports them by adding them to the symbols
-# that are to be defined on the command-line.
\ No newline at end of file
+# that are to be defined on the command-line.
+#
+# Usage: get_ld_config.sh kernel.cfg
+#
+# Variables with the LD_ prefix or no prefix become linker
+# symbols named after the variable without its prefixes, in
+# lower case, so CONFIG_RAMDISK_SIZE defines _ramdisk_size.
+# The output is a comma separated list for -Wl.
+
+
+config_file=$1
+symbols=()
+
+while IFS='=' read -r name value
+do
+    case $name in
+        M_*|"")
+            continue
+            ;;
+    esac
+
+    symbol=${name#LD_}
+    symbol=${symbol#CONFIG_}
+    symbols+=("--defsym=_${symbol,,}=$value")
+
+done < <(sed -e 's/#.*//' -e 's/[[:space:]]//g' -e '/^$/d' "$config_file")
+
+
+(IFS=','; echo "${symbols[*]}")
@@ -0,0 +1,232 @@
+#! /usr/bin/python3
+
+
+'''
+Converts a miniOS trace buffer into Chrome trace JSON, which
+Perfetto (ui.perfetto.dev) and chrome://tracing can open.
+
+The input is either the buffer as written by trace_dump, e.g.
+captured from the UART or the file given to the host port's
+--trace option, or a raw RAM image containing it, in which case
+the buffer is found by its magic number. See include/trace.h
+for the layout.
+
+Tasks are drawn as slices on a CPU track, with the system calls
+they make nested inside them and named from include/syscall.h.
+Interrupt handlers are drawn on a track of their own, and
+software timer expiries as instant events on it.
+'''
+
+
+from typing import Dict, List, Tuple
+import argparse
+import json
+import os
+import re
+import struct
+import sys
+
+
+
+TRACE_MAGIC: int = 0x4352544D
+TRACE_VERSION: int = 1
+TRACE_HEADER_WORDS: int = 5
+
+TRACE_EVENT_SWITCH: int = 1
+TRACE_EVENT_SYSCALL_ENTER: int = 2
+TRACE_EVENT_SYSCALL_EXIT: int = 3
+TRACE_EVENT_ISR_ENTER: int = 4
+TRACE_EVENT_ISR_EXIT: int = 5
+TRACE_EVENT_TIMER_EXPIRY: int = 6
+
+TRACE_DATA_MASK: int = 0x00FFFFFF
+TRACE_EVENT_SHIFT: int = 24
+TRACE_IDLE_TASK: int = TRACE_DATA_MASK
+
+TASK_ID_INDEX_BITS: int = 5
+
+CPU_TRACK: int = 1
+INTERRUPT_TRACK: int = 2
+
+DEFAULT_SYSCALL_HEADER: str = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "include", "syscall.h")
+
+
+
+def read_syscall_names(header: str) -> Dict[int, str]:
+
+	names: Dict[int, str] = {}
+
+	if not os.path.exists(header):
+		return names
+
+	with open(header, "r") as file_handle:
+		for line in file_handle:
+			match = re.match(r"#define\s+SYSCALL_CODE_(\w+)\s+(\d+)", line)
+			if match is not None:
+				names[int(match.group(2))] = match.group(1).lower()
+
+	return names
+
+
+
+'''
+Finds the trace buffer in the image and returns its byte order,
+counter frequency and records, oldest first.
+'''
+def find_trace_buffer(image: bytes) -> Tuple[str, int, List[Tuple[int, int]]]:
+
+	for byte_order in ("<", ">"):
+
+		magic: bytes = struct.pack(byte_order + "I", TRACE_MAGIC)
+		offset: int = image.find(magic)
+
+		while offset >= 0:
+
+			header = image[offset:offset + 4*TRACE_HEADER_WORDS]
+
+			if len(header) == 4*TRACE_HEADER_WORDS:
+
+				_, version, num_records, frequency, next_record = struct.unpack(byte_order + "5I", header)
+				records_start: int = offset + len(header)
+				records_end: int = records_start + 8*num_records
+				is_power_of_two: bool = num_records > 0 and (num_records & (num_records - 1)) == 0
+
+				if version == TRACE_VERSION and is_power_of_two and frequency > 0 and records_end <= len(image):
+
+					words = struct.unpack(byte_order + f"{2*num_records}I", image[records_start:records_end])
+					count: int = min(next_record, num_records)
+					records: List[Tuple[int, int]] = []
+
+					for i in range(next_record - count, next_record):
+						slot: int = i % num_records
+						records.append((words[2*slot], words[2*slot + 1]))
+
+					if next_record > num_records:
+						print(f"{next_record - num_records} older records were overwritten", file=sys.stderr)
+
+					return byte_order, frequency, records
+
+			offset = image.find(magic, offset + 1)
+
+	raise ValueError("no trace buffer found")
+
+
+
+def task_name(data: int) -> str:
+
+	if data == TRACE_IDLE_TASK:
+		return "idle"
+
+	return f"task {data} (slot {data & ((1 << TASK_ID_INDEX_BITS) - 1)})"
+
+
+
+def slice_event(name: str, track: int, start: float, end: float, category: str) -> dict:
+	return {"name": name, "cat": category, "ph": "X", "pid": 1, "tid": track, "ts": start, "dur": end - start}
+
+
+
+def convert(records: List[Tuple[int, int]], frequency: int, syscall_names: Dict[int, str]) -> List[dict]:
+
+	events: List[dict] = [
+		{"name": "process_name", "ph": "M", "pid": 1, "args": {"name": "miniOS"}},
+		{"name": "thread_name", "ph": "M", "pid": 1, "tid": CPU_TRACK, "args": {"name": "CPU"}},
+		{"name": "thread_name", "ph": "M", "pid": 1, "tid": INTERRUPT_TRACK, "args": {"name": "interrupts"}},
+	]
+
+	current_task: Tuple[str, float] = None
+	open_syscalls: List[Tuple[str, float]] = []
+	switched_syscalls: int = 0
+	open_isrs: List[Tuple[str, float]] = []
+
+	# the counter is 32 bits, so timestamps are unwrapped into a running count
+	cycles: int = 0
+	previous: int = records[0][0] if len(records) > 0 else 0
+	now: float = 0.0
+
+	for timestamp, info in records:
+
+		cycles += (timestamp - previous) & 0xFFFFFFFF
+		previous = timestamp
+		now = cycles*1e6/frequency
+
+		event: int = info >> TRACE_EVENT_SHIFT
+		data: int = info & TRACE_DATA_MASK
+
+		if event == TRACE_EVENT_SWITCH:
+
+			# the kernel switches inside a system call and records its exit after, so it ends here
+			for name, start in open_syscalls:
+				events.append(slice_event(name, CPU_TRACK, start, now, "syscall"))
+
+			switched_syscalls += len(open_syscalls)
+			open_syscalls = []
+
+			if current_task is not None:
+				events.append(slice_event(current_task[0], CPU_TRACK, current_task[1], now, "task"))
+
+			current_task = (task_name(data), now)
+
+		elif event == TRACE_EVENT_SYSCALL_ENTER:
+			open_syscalls.append((syscall_names.get(data, f"syscall {data}"), now))
+
+		elif event == TRACE_EVENT_SYSCALL_EXIT and switched_syscalls > 0:
+			switched_syscalls -= 1
+
+		# an exit without an entry was entered before the oldest record
+		elif event == TRACE_EVENT_SYSCALL_EXIT and len(open_syscalls) > 0:
+			name, start = open_syscalls.pop()
+			events.append(slice_event(name, CPU_TRACK, start, now, "syscall"))
+
+		elif event == TRACE_EVENT_ISR_ENTER:
+			open_isrs.append((f"vector {data}", now))
+
+		elif event == TRACE_EVENT_ISR_EXIT and len(open_isrs) > 0:
+			name, start = open_isrs.pop()
+			events.append(slice_event(name, INTERRUPT_TRACK, start, now, "interrupt"))
+
+		elif event == TRACE_EVENT_TIMER_EXPIRY:
+			events.append({"name": f"timer {data}", "cat": "timer", "ph": "i", "s": "t", "pid": 1, "tid": INTERRUPT_TRACK, "ts": now})
+
+	# whatever is still running when the trace ends is cut off there
+	for name, start in open_syscalls:
+		events.append(slice_event(name, CPU_TRACK, start, now, "syscall"))
+
+	for name, start in open_isrs:
+		events.append(slice_event(name, INTERRUPT_TRACK, start, now, "interrupt"))
+
+	if current_task is not None:
+		events.append(slice_event(current_task[0], CPU_TRACK, current_task[1], now, "task"))
+
+	return events
+
+
+
+def main() -> None:
+
+	parser = argparse.ArgumentParser(description="Converts a miniOS trace buffer or RAM image to Chrome trace JSON")
+	parser.add_argument("input", help="trace dump or RAM image")
+	parser.add_argument("-o", "--output", help="JSON file to write, stdout if not given")
+	parser.add_argument("--syscalls", default=DEFAULT_SYSCALL_HEADER, help="header to take system call names from")
+	args = parser.parse_args()
+
+	with open(args.input, "rb") as file_handle:
+		image: bytes = file_handle.read()
+
+	try:
+		_, frequency, records = find_trace_buffer(image)
+	except ValueError as error:
+		sys.exit(f"{args.input}: {error}")
+
+	trace: dict = {"traceEvents": convert(records, frequency, read_syscall_names(args.syscalls)), "displayTimeUnit": "ns"}
+
+	if args.output is None:
+		json.dump(trace, sys.stdout)
+	else:
+		with open(args.output, "w") as file_handle:
+			json.dump(trace, file_handle)
+
+
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "deferred_work.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+unsigned int save_and_disable_interrupts() { return 1; }
+void restore_interrupts(unsigned int were_enabled) {}
+void disable_interrupts() {}
+void enable_interrupts() {}
+void kernel_semaphore_wait(struct SEMAPHORE *semaphore) {}
+
+deferred_work_queue_t deferred_work_queue;
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+static deferred_work_queue_t queue;
+static uint32_t work_log[DEFERRED_WORK_QUEUE_SIZE + 1];
+static unsigned int work_count;
+
+
+static void logging_work(void *data, uint32_t value)
+{
+	work_log[work_count++] = value;
+}
+
+
+// posts another item the first time it runs, as an interrupt during the work could
+static void reposting_work(void *data, uint32_t value)
+{
+	logging_work(data, value);
+
+	if(value == 1)
+	{
+		defer_work(&table, &queue, reposting_work, NULL, 2);
+	}
+}
+
+
+// the worker task, waiting for work the way deferred_work_task does
+static task_control_block_t *new_waiting_worker()
+{
+	task_control_block_t *worker = new_task(DEFERRED_WORK_PRIORITY);
+
+	semaphore_wait(&table, worker, &queue.pending, WAIT_FOREVER, 0);
+
+	return worker;
+}
+
+
+
+UNIT_TEST bool test_deferred_work_wakeup_1()
+{
+	task_control_block_t *worker;
+
+	task_table_init(&table);
+	deferred_work_queue_init(&queue);
+	worker = new_waiting_worker();
+	ASSERT(worker->state == BLOCKED);
+
+	// the first item wakes the worker, which outranks the interrupted task
+	ASSERT(defer_work(&table, &queue, logging_work, NULL, 1) == 1);
+	ASSERT(worker->state == READY);
+	ASSERT(table.current_task == table.root);
+
+	// later items find it already woken
+	ASSERT(defer_work(&table, &queue, logging_work, NULL, 2) == 0);
+	ASSERT(queue.pending.count == 0);
+	ASSERT(queue.tail - queue.head == 2);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_deferred_work_order_1()
+{
+	task_table_init(&table);
+	deferred_work_queue_init(&queue);
+	work_count = 0;
+
+	defer_work(&table, &queue, logging_work, NULL, 7);
+	defer_work(&table, &queue, reposting_work, NULL, 1);
+	defer_work(&table, &queue, logging_work, NULL, 9);
+
+	// items run in the order they were posted, including one posted while running
+	ASSERT(run_deferred_work(&queue) == 4);
+	ASSERT(work_count == 4);
+	ASSERT(work_log[0] == 7 && work_log[1] == 1 && work_log[2] == 9 && work_log[3] == 2);
+	ASSERT(queue.completed == 4);
+	ASSERT(queue.head == queue.tail);
+
+	// nothing left to run
+	ASSERT(run_deferred_work(&queue) == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_deferred_work_full_1()
+{
+	task_table_init(&table);
+	deferred_work_queue_init(&queue);
+	work_count = 0;
+
+	for(int i = 0; i < DEFERRED_WORK_QUEUE_SIZE; i++)
+	{
+		ASSERT(defer_work(&table, &queue, logging_work, NULL, i) >= 0);
+	}
+
+	// a full queue drops the item and counts it
+	ASSERT(defer_work(&table, &queue, logging_work, NULL, 100) == ERROR_DEFERRED_WORK_FULL);
+	ASSERT(queue.dropped == 1);
+
+	ASSERT(run_deferred_work(&queue) == DEFERRED_WORK_QUEUE_SIZE);
+	ASSERT(work_log[DEFERRED_WORK_QUEUE_SIZE - 1] == DEFERRED_WORK_QUEUE_SIZE - 1);
+
+	// the ring wraps around once drained
+	ASSERT(defer_work(&table, &queue, logging_work, NULL, 100) >= 0);
+	ASSERT(run_deferred_work(&queue) == 1);
+	ASSERT(work_log[DEFERRED_WORK_QUEUE_SIZE] == 100);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_deferred_work_init_1()
+{
+	task_control_block_t *worker;
+
+	task_table_init(&table);
+	worker = get_task(&table, init_deferred_work(&table));
+
+	// the worker is a child of the root task at the highest priority
+	ASSERT(worker != NULL_POINTER);
+	ASSERT(worker->priority == DEFERRED_WORK_PRIORITY);
+	ASSERT(worker->parent == table.root);
+	ASSERT(deferred_work_queue.head == 0 && deferred_work_queue.tail == 0);
+
+	return true;
+}
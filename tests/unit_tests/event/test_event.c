@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "event.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+UNIT_TEST bool test_event_any_all_1()
+{
+	event_flags_t group = EVENT_FLAGS_INITIALIZER;
+	event_wait_t any = { 0x3, EVENT_WAIT_ANY, WAIT_FOREVER, 0 };
+	event_wait_t all = { 0x3, EVENT_WAIT_ALL, WAIT_FOREVER, 0 };
+	task_control_block_t *any_waiter, *all_waiter;
+
+	task_table_init(&table);
+	any_waiter = new_task(20);
+	all_waiter = new_task(20);
+
+	event_flags_wait(&table, any_waiter, &group, &any, 0);
+	event_flags_wait(&table, all_waiter, &group, &all, 0);
+
+	// one of the flags is enough for any, but not for all
+	ASSERT(event_flags_set(&table, &group, 0x2) == 0);
+	ASSERT(any_waiter->state == READY);
+	ASSERT(any.flags == 0x2);
+	ASSERT(all_waiter->state == BLOCKED);
+
+	// flags outside the mask do not count
+	event_flags_set(&table, &group, 0x4);
+	ASSERT(all_waiter->state == BLOCKED);
+
+	event_flags_set(&table, &group, 0x1);
+	ASSERT(all_waiter->state == READY);
+	ASSERT(all.flags == 0x3);
+	ASSERT(all_waiter->regs[REGISTER_V0] == 0);
+
+	// without EVENT_CLEAR the flags stay set, so waiting again returns at once
+	ASSERT(group.flags == 0x7);
+	ASSERT(event_flags_wait(&table, table.root, &group, &all, 0) == 0);
+	ASSERT(table.root->state == RUNNING);
+
+	event_flags_clear(&group, 0x5);
+	ASSERT(group.flags == 0x2);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_event_clear_priority_1()
+{
+	event_flags_t group;
+	event_wait_t low_wait = { 0x1, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER, 0 };
+	event_wait_t high_wait = { 0x1, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER, 0 };
+	event_wait_t other_wait = { 0x2, EVENT_WAIT_ANY | EVENT_CLEAR, WAIT_FOREVER, 0 };
+	task_control_block_t *low, *high, *other;
+
+	task_table_init(&table);
+	event_flags_init(&group);
+	low = new_task(20);
+	high = new_task(4);
+	other = new_task(25);
+
+	event_flags_wait(&table, low, &group, &low_wait, 0);
+	event_flags_wait(&table, other, &group, &other_wait, 0);
+	event_flags_wait(&table, high, &group, &high_wait, 0);
+	ASSERT(group.waiters.head == high);
+
+	// the flag is consumed by the highest priority waiter, and the walk goes on for the others
+	ASSERT(event_flags_set(&table, &group, 0x3) == 1);
+	ASSERT(high->state == READY && high_wait.flags == 0x1);
+	ASSERT(low->state == BLOCKED);
+	ASSERT(other->state == READY && other_wait.flags == 0x2);
+	ASSERT(group.flags == 0);
+
+	ASSERT(event_flags_set(&table, &group, 0x1) == 0);
+	ASSERT(low->state == READY);
+	ASSERT(group.flags == 0);
+	ASSERT(group.waiters.head == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_event_timeout_1()
+{
+	event_flags_t group = EVENT_FLAGS_INITIALIZER;
+	event_wait_t wait = { 0x1, EVENT_WAIT_ANY, 3, 0 };
+	event_wait_t poll = { 0x1, EVENT_WAIT_ANY, WAIT_POLL, 0 };
+	event_wait_t empty = { 0, EVENT_WAIT_ANY, WAIT_FOREVER, 0 };
+	task_control_block_t *waiter;
+
+	task_table_init(&table);
+	waiter = new_task(20);
+
+	ASSERT(event_flags_wait(&table, table.root, &group, &poll, 0) == ERROR_TIMED_OUT);
+	ASSERT(event_flags_wait(&table, table.root, &group, &empty, 0) == ERROR_EVENT_INVALID_MASK);
+	ASSERT(table.root->state == RUNNING);
+
+	event_flags_wait(&table, waiter, &group, &wait, 10);
+	ASSERT(IS_TASK_SLEEPING(&table, waiter));
+
+	wake_sleeping_tasks(&table, 13);
+	ASSERT(waiter->state == READY);
+	ASSERT(waiter->regs[REGISTER_V0] == (uint32_t) ERROR_TIMED_OUT);
+	ASSERT(group.waiters.head == NULL_POINTER);
+
+	// setting the flag afterwards finds nobody waiting
+	ASSERT(event_flags_set(&table, &group, 0x1) == 0);
+	ASSERT(wait.flags == 0);
+	ASSERT(group.flags == 0x1);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_event_interrupt_1()
+{
+	event_flags_t group = EVENT_FLAGS_INITIALIZER;
+	event_wait_t wait = { 0x80000000, EVENT_WAIT_ANY, WAIT_FOREVER, 0 };
+	task_control_block_t *waiter;
+
+	task_table_init(&table);
+	waiter = new_task(2);
+
+	event_flags_wait(&table, waiter, &group, &wait, 0);
+
+	// setting the top flag from an interrupt readies the waiter without a switch
+	ASSERT(event_flags_set(&table, &group, 0x80000000) == 1);
+	ASSERT(table.current_task == table.root);
+	ASSERT(waiter->state == READY);
+	ASSERT(wait.flags == 0x80000000);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task == waiter);
+
+	return true;
+}
@@ -0,0 +1,309 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "timers.h"
+#include "idle.h"
+#include "hardware.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+task_table_t task_table;
+
+static void dummy_task_function(void) {}
+
+
+
+/*
+ * Simulated tick timer. Sleeping in wait_for_interrupt
+ * advances the clock straight to the programmed wakeup,
+ * the same as the core timer interrupt would on hardware.
+ */
+
+static unsigned int programmed_wakeup;
+static unsigned int num_wakeups;
+static unsigned int num_reschedules;
+static int interrupts_enabled;
+
+
+void disable_interrupts()
+{
+	interrupts_enabled = 0;
+}
+
+void enable_interrupts()
+{
+	interrupts_enabled = 1;
+}
+
+void set_tick_wakeup(unsigned int ticks)
+{
+	programmed_wakeup = ticks;
+}
+
+void update_tick_count() {}
+
+void wait_for_interrupt()
+{
+	interrupts_enabled = 1;
+	num_wakeups++;
+	timer_tick(programmed_wakeup);
+	wake_sleeping_tasks(&task_table, get_system_ticks());
+}
+
+void request_reschedule()
+{
+	num_reschedules++;
+	schedule_next_task(&task_table);
+}
+
+
+
+static task_control_block_t *waiting_task;
+static int num_callbacks;
+
+static void wake_task_callback(int ticks)
+{
+	num_callbacks++;
+
+	if(waiting_task != NULL_POINTER)
+	{
+		set_task_ready(&task_table, waiting_task);
+	}
+}
+
+
+static void reset_simulation()
+{
+	task_table_init(&task_table);
+	init_idle_task(&task_table);
+	init_timer_system();
+
+	programmed_wakeup = 0;
+	num_wakeups = 0;
+	num_reschedules = 0;
+	interrupts_enabled = 1;
+	waiting_task = NULL_POINTER;
+	num_callbacks = 0;
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_idle_selected_1()
+{
+	reset_simulation();
+
+	set_task_blocked(&task_table, task_table.root);
+	schedule_next_task(&task_table);
+
+	ASSERT(task_table.current_task == &task_table.idle_task);
+	ASSERT(current_task_register_base == task_table.idle_task.regs);
+	ASSERT(task_table.idle_task.regs[REGISTER_PC] == (uint32_t)(uintptr_t) idle_task_loop);
+
+	// idle task never appears on a ready list
+	ASSERT(task_table.ready_bitmap == 0);
+
+	set_task_ready(&task_table, task_table.root);
+	schedule_next_task(&task_table);
+	ASSERT(task_table.current_task == task_table.root);
+	ASSERT(task_table.idle_task.state == READY);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_idle_sleep_ticks_1()
+{
+	timer_info_t info = {0};
+
+	reset_simulation();
+
+	// nothing pending, so sleep as long as allowed
+	ASSERT(get_next_timer_expiry() == TIMER_NO_EXPIRY);
+	ASSERT(get_idle_sleep_ticks(get_system_ticks()) == IDLE_MAX_SLEEP_TICKS);
+
+	info.seconds = 5;
+	start_timer(TIMER_TYPE_ONCE, 0, &info, wake_task_callback);
+	ASSERT(get_idle_sleep_ticks(get_system_ticks()) == IDLE_MAX_SLEEP_TICKS);
+
+	info.seconds = 0;
+	info.milli = 7;
+	start_timer(TIMER_TYPE_ONCE, 0, &info, wake_task_callback);
+	ASSERT(get_next_timer_expiry() == 7);
+	ASSERT(get_idle_sleep_ticks(get_system_ticks()) == 7);
+
+	// an overdue timer still sleeps for one tick
+	ASSERT(get_idle_sleep_ticks(10) == 1);
+
+	return true;
+}
+
+
+/*
+ * All tasks are blocked and the only pending timer expires
+ * in 50 ms. The idle task must sleep through the whole 50
+ * ticks with a single wakeup, then hand the CPU over to the
+ * task that the timer made ready.
+ */
+UNIT_TEST bool test_idle_tickless_1()
+{
+	timer_info_t info = {0};
+	taskid_t id;
+
+	reset_simulation();
+
+	id = create_task(&task_table, task_table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	waiting_task = get_task(&task_table, id);
+	set_task_blocked(&task_table, waiting_task);
+	set_task_blocked(&task_table, task_table.root);
+
+	info.milli = 50;
+	ASSERT(start_timer(TIMER_TYPE_ONCE, 0, &info, wake_task_callback) >= 0);
+
+	schedule_next_task(&task_table);
+	ASSERT(task_table.current_task == &task_table.idle_task);
+
+	idle_task_iteration();
+	ASSERT(programmed_wakeup == 50);
+	ASSERT(num_wakeups == 1);
+	ASSERT(interrupts_enabled);
+	ASSERT(get_system_ticks() == 50);
+	ASSERT(get_idle_ticks() == 50);
+	ASSERT(num_callbacks == 1);
+	ASSERT(waiting_task->state == READY);
+	ASSERT(get_next_timer_expiry() == TIMER_NO_EXPIRY);
+
+	// next pass hands over instead of sleeping again
+	idle_task_iteration();
+	ASSERT(num_wakeups == 1);
+	ASSERT(num_reschedules == 1);
+	ASSERT(programmed_wakeup == 1);
+	ASSERT(task_table.current_task == waiting_task);
+
+	printf("\t50 ms idle: %u wakeup(s), periodic tick would take 50\n", num_wakeups);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_idle_tickless_2()
+{
+	timer_info_t info = {0};
+
+	reset_simulation();
+	set_task_blocked(&task_table, task_table.root);
+	schedule_next_task(&task_table);
+
+	// a repeating 20 ms timer wakes the idle task once per period
+	info.milli = 20;
+	start_timer(TIMER_TYPE_REPEATING, 0, &info, wake_task_callback);
+
+	for(int i = 0; i < 5; i++)
+	{
+		idle_task_iteration();
+		ASSERT(programmed_wakeup == 20);
+	}
+
+	ASSERT(num_wakeups == 5);
+	ASSERT(num_callbacks == 5);
+	ASSERT(get_system_ticks() == 100);
+	ASSERT(get_idle_ticks() == 100);
+	ASSERT(get_next_timer_expiry() == 120);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_timer_repeat_n_1()
+{
+	timer_info_t info = {0};
+	int timer_number;
+
+	reset_simulation();
+
+	info.milli = 10;
+	timer_number = start_timer(TIMER_TYPE_REPEAT_N, 3, &info, wake_task_callback);
+	ASSERT(timer_number >= 0);
+
+	for(int i = 0; i < 100; i++)
+	{
+		timer_tick(1);
+	}
+
+	ASSERT(num_callbacks == 3);
+	ASSERT(get_next_timer_expiry() == TIMER_NO_EXPIRY);
+
+	// a repeat count below 1 would wrap repeats_left
+	ASSERT(start_timer(TIMER_TYPE_REPEAT_N, 0, &info, wake_task_callback) < 0);
+	ASSERT(start_timer(TIMER_TYPE_REPEAT_N, -1, &info, wake_task_callback) < 0);
+
+	// cancelled timers never fire
+	timer_number = start_timer(TIMER_TYPE_ONCE, 0, &info, wake_task_callback);
+	cancel_timer(timer_number);
+	timer_tick(20);
+	ASSERT(num_callbacks == 3);
+
+	return true;
+}
+
+
+/*
+ * A sleeping task wakes the idle task at its wakeup tick even
+ * though no software timer is pending.
+ */
+UNIT_TEST bool test_idle_sleeping_task_1()
+{
+	timer_info_t info = {0};
+	task_control_block_t *sleeper;
+
+	reset_simulation();
+
+	sleeper = get_task(&task_table, create_task(&task_table, task_table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	sleep_task_until(&task_table, sleeper, 30, get_system_ticks());
+	set_task_blocked(&task_table, task_table.root);
+
+	// the earlier of the timer and the sleeping task is used
+	info.milli = 40;
+	start_timer(TIMER_TYPE_ONCE, 0, &info, wake_task_callback);
+	ASSERT(get_idle_sleep_ticks(get_system_ticks()) == 30);
+
+	schedule_next_task(&task_table);
+	ASSERT(task_table.current_task == &task_table.idle_task);
+
+	idle_task_iteration();
+	ASSERT(programmed_wakeup == 30);
+	ASSERT(num_wakeups == 1);
+	ASSERT(sleeper->state == READY);
+	ASSERT(sleeper->regs[REGISTER_V0] == 30);
+
+	idle_task_iteration();
+	ASSERT(task_table.current_task == sleeper);
+
+	return true;
+}
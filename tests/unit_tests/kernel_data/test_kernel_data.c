@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "kernel_data.h"
+#include "timers.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+
+// set directly by the tests
+static unsigned int cycle_counter;
+unsigned int read_cycle_counter() { return cycle_counter; }
+unsigned int get_cycle_counter_frequency() { return 40000000; }
+
+
+static task_table_t table;
+static kernel_data_page_t page;
+
+static void dummy_task_function(void) {}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_kernel_data_init_1()
+{
+	memset(&page, 0xFF, sizeof(page));
+	cycle_counter = 1234;
+
+	kernel_data_init(&page);
+
+	ASSERT(page.sequence == 0);
+	ASSERT(page.version == KERNEL_DATA_VERSION);
+	ASSERT(page.counter_frequency == 40000000);
+	ASSERT(page.tick_rate == TICK_RATE_HZ);
+	ASSERT(page.time_base == 0);
+	ASSERT(page.time_base_count == 1234);
+	ASSERT(page.ticks == 0);
+	ASSERT(page.current_task_id == KERNEL_DATA_IDLE_TASK);
+	ASSERT(page.num_switches == 0);
+	ASSERT(page.idle_cycles == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_update_kernel_data_page_1()
+{
+	kernel_data_page_t snapshot;
+
+	task_table_init(&table);
+	cycle_counter = 0xFFFFFF00;
+	kernel_data_init(&page);
+
+	// the time base keeps counting across a wrap of the 32-bit counter
+	cycle_counter = 0x100;
+	update_kernel_data_page(&page, &table, 7);
+
+	ASSERT(page.sequence == 2);
+	ASSERT(page.time_base == 0x200);
+	ASSERT(page.time_base_count == 0x100);
+	ASSERT(page.ticks == 7);
+
+	cycle_counter = 0x80000000;
+	update_kernel_data_page(&page, &table, 8);
+
+	ASSERT(page.sequence == 4);
+	ASSERT(page.time_base == 0x80000100ULL);
+	ASSERT(page.ticks == 8);
+
+	// a reader gets the page as the last update left it
+	read_kernel_data(&page, &snapshot);
+	ASSERT(!memcmp(&snapshot, &page, sizeof(page)));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_update_kernel_data_page_2()
+{
+	task_control_block_t *task;
+
+	task_table_init(&table);
+	kernel_data_init(&page);
+	task = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, 0, 0));
+
+	// the root task is current after init
+	update_kernel_data_page(&page, &table, 0);
+	ASSERT(page.current_task_id == table.root->task_id);
+	ASSERT(page.num_switches == 1);
+
+	// an update without a switch does not count one
+	update_kernel_data_page(&page, &table, 1);
+	ASSERT(page.num_switches == 1);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task == task);
+	update_kernel_data_page(&page, &table, 2);
+	ASSERT(page.current_task_id == task->task_id);
+	ASSERT(page.num_switches == 2);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_update_kernel_data_page_3()
+{
+	task_table_init(&table);
+	cycle_counter = 0;
+	kernel_data_init(&page);
+
+	// nothing else is ready, so the idle task runs
+	set_task_blocked(&table, table.root);
+	schedule_next_task(&table);
+	ASSERT(table.current_task == &table.idle_task);
+
+	update_kernel_data_page(&page, &table, 0);
+	ASSERT(page.current_task_id == KERNEL_DATA_IDLE_TASK);
+
+	// idle time is published as of the idle task's last switch out
+	cycle_counter = 500;
+	set_task_ready(&table, table.root);
+	schedule_next_task(&table);
+	update_kernel_data_page(&page, &table, 0);
+
+	ASSERT(page.current_task_id == table.root->task_id);
+	ASSERT(page.idle_cycles == table.idle_task.stats.run_cycles);
+	ASSERT(page.idle_cycles == 500);
+
+	return true;
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "message_queue.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+UNIT_TEST bool test_message_queue_copy_1()
+{
+	message_queue_t queue;
+	uint32_t buffer[3];
+	uint32_t message;
+
+	task_table_init(&table);
+
+	ASSERT(message_queue_init(&queue, buffer, 0, sizeof(uint32_t), 0) == ERROR_MESSAGE_QUEUE_INVALID);
+	ASSERT(message_queue_init(&queue, buffer, 3, sizeof(uint32_t), 0) == 0);
+
+	// try variants fail instead of blocking on an empty or full queue
+	ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == ERROR_TIMED_OUT);
+
+	for(uint32_t i = 1; i <= 3; i++)
+	{
+		message = i;
+		ASSERT(message_send(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+	}
+
+	message = 4;
+	ASSERT(message_send(&table, table.root, &queue, &message, WAIT_POLL, 0) == ERROR_TIMED_OUT);
+	ASSERT(table.root->state == RUNNING);
+
+	// messages come out in order, and the slots wrap around
+	ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+	ASSERT(message == 1);
+
+	message = 4;
+	ASSERT(message_send(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+	ASSERT(queue.head == 1 && queue.count == 3);
+
+	for(uint32_t i = 2; i <= 4; i++)
+	{
+		ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+		ASSERT(message == i);
+	}
+
+	ASSERT(queue.count == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_message_queue_pointers_1()
+{
+	message_queue_t queue;
+	void *buffer[2];
+	char frame[64] = "frame";
+	char *received = NULL_POINTER;
+
+	task_table_init(&table);
+
+	// the message size is ignored, since only pointers are queued
+	ASSERT(message_queue_init(&queue, buffer, 2, 0, MESSAGE_QUEUE_POINTERS) == 0);
+	ASSERT(queue.message_size == sizeof(void*));
+
+	message_send(&table, table.root, &queue, frame, WAIT_POLL, 0);
+	ASSERT(buffer[0] == frame);
+
+	message_receive(&table, table.root, &queue, &received, WAIT_POLL, 0);
+	ASSERT(received == frame);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_message_queue_direct_receive_1()
+{
+	message_queue_t queue;
+	uint8_t buffer[2*32];
+	uint8_t message[32], received[32];
+	task_control_block_t *receiver;
+
+	task_table_init(&table);
+	message_queue_init(&queue, buffer, 2, sizeof(message), 0);
+	receiver = new_task(4);
+
+	memset(message, 0x5A, sizeof(message));
+	memset(received, 0, sizeof(received));
+
+	ASSERT(message_receive(&table, receiver, &queue, received, 10, 0) == 0);
+	ASSERT(receiver->state == BLOCKED);
+	ASSERT(IS_TASK_SLEEPING(&table, receiver));
+
+	// the message goes straight into the waiting receiver's buffer, not through the queue
+	ASSERT(message_send(&table, table.root, &queue, message, WAIT_POLL, 0) == 1);
+	ASSERT(memcmp(received, message, sizeof(message)) == 0);
+	ASSERT(queue.count == 0);
+	ASSERT(receiver->state == READY);
+	ASSERT(receiver->regs[REGISTER_V0] == 0);
+	ASSERT(!IS_TASK_SLEEPING(&table, receiver));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_message_queue_blocked_sender_1()
+{
+	message_queue_t queue;
+	uint32_t buffer[1];
+	uint32_t first = 1, second = 2, third = 3, message;
+	task_control_block_t *low, *high;
+
+	task_table_init(&table);
+	message_queue_init(&queue, buffer, 1, sizeof(uint32_t), 0);
+	low = new_task(20);
+	high = new_task(10);
+
+	message_send(&table, table.root, &queue, &first, WAIT_POLL, 0);
+	message_send(&table, low, &queue, &second, WAIT_FOREVER, 0);
+	message_send(&table, high, &queue, &third, WAIT_FOREVER, 0);
+	ASSERT(low->state == BLOCKED && high->state == BLOCKED);
+	ASSERT(queue.senders.head == high);
+
+	// each receive frees a slot for the highest priority sender
+	ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == 1);
+	ASSERT(message == 1);
+	ASSERT(high->state == READY && high->regs[REGISTER_V0] == 0);
+	ASSERT(queue.count == 1);
+
+	ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+	ASSERT(message == 3);
+	ASSERT(low->state == READY);
+
+	ASSERT(message_receive(&table, table.root, &queue, &message, WAIT_POLL, 0) == 0);
+	ASSERT(message == 2);
+	ASSERT(queue.count == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_message_queue_timeout_1()
+{
+	message_queue_t queue;
+	uint32_t buffer[1];
+	uint32_t message = 7;
+	task_control_block_t *receiver;
+
+	task_table_init(&table);
+	message_queue_init(&queue, buffer, 1, sizeof(uint32_t), 0);
+	receiver = new_task(20);
+
+	message_receive(&table, receiver, &queue, &message, 5, 0);
+	wake_sleeping_tasks(&table, 5);
+
+	ASSERT(receiver->state == READY);
+	ASSERT(receiver->regs[REGISTER_V0] == (uint32_t) ERROR_TIMED_OUT);
+	ASSERT(queue.receivers.head == NULL_POINTER);
+
+	// a later message is queued rather than handed to the receiver that gave up
+	message_send(&table, table.root, &queue, &message, WAIT_POLL, 0);
+	ASSERT(queue.count == 1);
+
+	return true;
+}
@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "mutex.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+// the lock word names the owner by an address inside its stack
+static bool is_owner(mutex_t *mutex, task_control_block_t *task)
+{
+	uint32_t address = mutex->lock & MUTEX_OWNER_MASK;
+	uint32_t top = (uint32_t)(uintptr_t) task->stack.top;
+
+	return mutex->lock != MUTEX_UNLOCKED && address < top && address >= top - task->stack.size;
+}
+
+
+// what the API fast path does when it finds the mutex unlocked
+static void fast_lock(mutex_t *mutex, task_control_block_t *task)
+{
+	mutex->lock = (uint32_t)(uintptr_t) task->stack.top - 64;
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_mutex_uncontended_1()
+{
+	mutex_t mutex = MUTEX_INITIALIZER;
+	task_control_block_t *other;
+
+	task_table_init(&table);
+	other = new_task(DEFAULT_TASK_PRIORITY);
+
+	// kernel callers take a free mutex straight away
+	ASSERT(mutex_lock(&table, table.root, &mutex) == 0);
+	ASSERT(is_owner(&mutex, table.root));
+	ASSERT(mutex.owner == NULL_POINTER);
+
+	ASSERT(mutex_lock(&table, table.root, &mutex) == ERROR_MUTEX_DEADLOCK);
+	ASSERT(mutex_unlock(&table, other, &mutex) == ERROR_MUTEX_NOT_OWNER);
+
+	ASSERT(mutex_unlock(&table, table.root, &mutex) == 0);
+	ASSERT(mutex.lock == MUTEX_UNLOCKED);
+	ASSERT(mutex_unlock(&table, table.root, &mutex) == ERROR_MUTEX_NOT_OWNER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_mutex_inherit_1()
+{
+	mutex_t mutex = MUTEX_INITIALIZER;
+	task_control_block_t *low, *high;
+
+	task_table_init(&table);
+	low = new_task(20);
+	high = new_task(5);
+
+	// taken on the fast path, so the kernel first learns the owner from the lock word
+	fast_lock(&mutex, low);
+
+	ASSERT(mutex_lock(&table, high, &mutex) == 0);
+	ASSERT(high->state == BLOCKED);
+	ASSERT(high->waiting_mutex == &mutex);
+	ASSERT(mutex.lock & MUTEX_CONTENDED);
+	ASSERT(mutex.owner == low);
+	ASSERT(low->held_mutexes == &mutex);
+
+	// the owner runs at the waiter's priority, on that priority's ready list
+	ASSERT(low->priority == 5);
+	ASSERT(low->base_priority == 20);
+	ASSERT(table.ready_lists[5] == low);
+	ASSERT(table.ready_lists[20] == NULL_POINTER);
+
+	// unlocking hands over to the waiter, which should preempt
+	ASSERT(mutex_unlock(&table, low, &mutex) == 1);
+	ASSERT(high->state == READY);
+	ASSERT(high->waiting_mutex == NULL_POINTER);
+	ASSERT(is_owner(&mutex, high));
+	ASSERT(!(mutex.lock & MUTEX_CONTENDED));
+	ASSERT(low->priority == 20);
+	ASSERT(low->held_mutexes == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_mutex_transitive_1()
+{
+	mutex_t first = MUTEX_INITIALIZER;
+	mutex_t second = MUTEX_INITIALIZER;
+	task_control_block_t *low, *middle, *high;
+
+	task_table_init(&table);
+	low = new_task(20);
+	middle = new_task(15);
+	high = new_task(5);
+
+	// low holds first, middle holds second and waits for first
+	mutex_lock(&table, low, &first);
+	mutex_lock(&table, middle, &second);
+	mutex_lock(&table, middle, &first);
+	ASSERT(low->priority == 15);
+
+	// high waiting for second raises middle, and through it low
+	mutex_lock(&table, high, &second);
+	ASSERT(middle->priority == 5);
+	ASSERT(low->priority == 5);
+
+	// low gives up first, so middle gets it and low drops back
+	ASSERT(mutex_unlock(&table, low, &first) == 1);
+	ASSERT(low->priority == 20);
+	ASSERT(middle->state == READY);
+	ASSERT(middle->priority == 5);
+	ASSERT(is_owner(&first, middle));
+
+	ASSERT(mutex_unlock(&table, middle, &second) == 1);
+	ASSERT(middle->priority == 15);
+	ASSERT(is_owner(&second, high));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_mutex_waiter_order_1()
+{
+	mutex_t mutex = MUTEX_INITIALIZER;
+	task_control_block_t *owner, *waiters[4];
+	unsigned int priorities[4] = {10, 4, 10, 7};
+
+	task_table_init(&table);
+	owner = new_task(20);
+	mutex_lock(&table, owner, &mutex);
+
+	for(int i = 0; i < 4; i++)
+	{
+		waiters[i] = new_task(priorities[i]);
+		mutex_lock(&table, waiters[i], &mutex);
+	}
+
+	// highest priority first, equal priorities in the order they came
+	ASSERT(mutex.waiters.head == waiters[1]);
+	ASSERT(waiters[1]->next_task == waiters[3]);
+	ASSERT(waiters[3]->next_task == waiters[0]);
+	ASSERT(waiters[0]->next_task == waiters[2]);
+	ASSERT(mutex.waiters.tail == waiters[2]);
+	ASSERT(owner->priority == 4);
+
+	// each new owner inherits from the waiters left behind
+	mutex_unlock(&table, owner, &mutex);
+	ASSERT(is_owner(&mutex, waiters[1]));
+	ASSERT(waiters[1]->priority == 4);
+	ASSERT(owner->priority == 20);
+
+	mutex_unlock(&table, waiters[1], &mutex);
+	ASSERT(is_owner(&mutex, waiters[3]));
+	ASSERT(waiters[3]->priority == 7);
+	ASSERT(waiters[1]->priority == 4);
+
+	mutex_unlock(&table, waiters[3], &mutex);
+	ASSERT(is_owner(&mutex, waiters[0]));
+	ASSERT(mutex.lock & MUTEX_CONTENDED);
+
+	mutex_unlock(&table, waiters[0], &mutex);
+	ASSERT(is_owner(&mutex, waiters[2]));
+	ASSERT(!(mutex.lock & MUTEX_CONTENDED));
+	ASSERT(mutex.owner == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_mutex_exit_1()
+{
+	mutex_t mutex = MUTEX_INITIALIZER;
+	task_control_block_t *owner, *waiter, *high;
+
+	task_table_init(&table);
+	owner = new_task(20);
+	waiter = new_task(10);
+	high = new_task(5);
+
+	mutex_lock(&table, owner, &mutex);
+	mutex_lock(&table, waiter, &mutex);
+	mutex_lock(&table, high, &mutex);
+	ASSERT(owner->priority == 5);
+
+	// a waiter that exits no longer lends its priority
+	exit_task(&table, high, 0);
+	ASSERT(owner->priority == 10);
+	ASSERT(mutex.waiters.head == waiter);
+
+	// an owner that exits hands the mutex on
+	exit_task(&table, owner, 0);
+	ASSERT(waiter->state == READY);
+	ASSERT(is_owner(&mutex, waiter));
+	ASSERT(!(mutex.lock & MUTEX_CONTENDED));
+	ASSERT(waiter->regs[REGISTER_V0] == MUTEX_OWNER_DIED);
+
+	// and one that exited with it uncontended leaves it to the next task
+	exit_task(&table, waiter, 0);
+	ASSERT(mutex_lock(&table, table.root, &mutex) == MUTEX_OWNER_DIED);
+	ASSERT(is_owner(&mutex, table.root));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_mutex_last_waiter_leaves_1()
+{
+	mutex_t mutex = MUTEX_INITIALIZER;
+	task_control_block_t *owner, *waiter;
+
+	task_table_init(&table);
+	owner = new_task(20);
+	waiter = new_task(5);
+
+	fast_lock(&mutex, owner);
+	mutex_lock(&table, waiter, &mutex);
+	exit_task(&table, waiter, 0);
+
+	// back to a mutex the owner can unlock on the fast path
+	ASSERT(!(mutex.lock & MUTEX_CONTENDED));
+	ASSERT(is_owner(&mutex, owner));
+	ASSERT(owner->held_mutexes == NULL_POINTER);
+	ASSERT(owner->priority == 20);
+
+	ASSERT(mutex_unlock(&table, owner, &mutex) == 0);
+	ASSERT(mutex.lock == MUTEX_UNLOCKED);
+
+	return true;
+}
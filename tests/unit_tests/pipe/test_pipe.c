@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "pipe.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+static pipe_table_t pipe_table;
+static int preempt;
+
+
+
+UNIT_TEST bool test_pipe_ring_1()
+{
+	uint8_t data[PIPE_BUFFER_SIZE], buffer[PIPE_BUFFER_SIZE];
+	pipe_t *pipe;
+	int index;
+
+	task_table_init(&table);
+	pipe_table_init(&pipe_table);
+	index = allocate_pipe(&pipe_table);
+	ASSERT(index == 0);
+	pipe = &pipe_table.pipes[index];
+
+	for(int i = 0; i < PIPE_BUFFER_SIZE; i++)
+	{
+		data[i] = i;
+	}
+
+	ASSERT(pipe_write(&table, table.root, pipe, data, 200, &preempt) == 200);
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, 150, &preempt) == 150);
+	ASSERT(!memcmp(buffer, data, 150));
+
+	// the second write wraps past the end of the buffer
+	ASSERT(pipe_write(&table, table.root, pipe, data, 200, &preempt) == 200);
+	ASSERT(pipe->count == 250);
+	ASSERT(table.root->state == RUNNING);
+
+	// and reads come out in the order they went in
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, PIPE_BUFFER_SIZE, &preempt) == 250);
+	ASSERT(!memcmp(buffer, data + 150, 50));
+	ASSERT(!memcmp(buffer + 50, data, 200));
+	ASSERT(pipe->count == 0);
+
+	// an empty read is not an end of file and does not block
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, 0, &preempt) == 0);
+	ASSERT(table.root->state == RUNNING);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_pipe_reader_1()
+{
+	uint8_t first[8], second[8];
+	task_control_block_t *readers[2];
+	pipe_t *pipe;
+
+	task_table_init(&table);
+	pipe_table_init(&pipe_table);
+	pipe = &pipe_table.pipes[allocate_pipe(&pipe_table)];
+	readers[0] = new_task(DEFAULT_TASK_PRIORITY);
+	readers[1] = new_task(DEFAULT_TASK_PRIORITY);
+
+	// reads of an empty pipe block in the order they came
+	ASSERT(pipe_read(&table, readers[0], pipe, first, sizeof(first), &preempt) == 0);
+	ASSERT(pipe_read(&table, readers[1], pipe, second, sizeof(second), &preempt) == 0);
+	ASSERT(readers[0]->state == BLOCKED && readers[1]->state == BLOCKED);
+
+	// a write goes straight into the waiting buffers, and only the rest into the ring
+	ASSERT(pipe_write(&table, table.root, pipe, "abcdefghijklmnopqrst", 20, &preempt) == 20);
+	ASSERT(readers[0]->state == READY && readers[1]->state == READY);
+	ASSERT(readers[0]->regs[REGISTER_V0] == 8 && readers[1]->regs[REGISTER_V0] == 8);
+	ASSERT(!memcmp(first, "abcdefgh", 8));
+	ASSERT(!memcmp(second, "ijklmnop", 8));
+	ASSERT(pipe->count == 4);
+	ASSERT(pipe->readers.head == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_pipe_writer_1()
+{
+	uint8_t data[300], buffer[100];
+	task_control_block_t *writers[2];
+	pipe_t *pipe;
+
+	task_table_init(&table);
+	pipe_table_init(&pipe_table);
+	pipe = &pipe_table.pipes[allocate_pipe(&pipe_table)];
+	writers[0] = new_task(DEFAULT_TASK_PRIORITY);
+	writers[1] = new_task(DEFAULT_TASK_PRIORITY);
+	memset(data, 'x', sizeof(data));
+
+	// the first write fills the pipe and blocks with the rest
+	ASSERT(pipe_write(&table, writers[0], pipe, data, 300, &preempt) == 300);
+	ASSERT(writers[0]->state == BLOCKED);
+	ASSERT(writers[0]->transferred == PIPE_BUFFER_SIZE);
+	ASSERT(pipe->count == PIPE_BUFFER_SIZE);
+
+	// a second write waits behind it even once there is room
+	ASSERT(pipe_write(&table, writers[1], pipe, "y", 1, &preempt) == 1);
+	ASSERT(writers[1]->state == BLOCKED);
+	ASSERT(writers[1]->transferred == 0);
+
+	// a read pulls the rest of both writes into the room it made, in order
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, sizeof(buffer), &preempt) == 100);
+	ASSERT(writers[0]->state == READY && writers[0]->regs[REGISTER_V0] == 300);
+	ASSERT(writers[1]->state == READY && writers[1]->regs[REGISTER_V0] == 1);
+	ASSERT(pipe->count == PIPE_BUFFER_SIZE - 100 + 44 + 1);
+	ASSERT(pipe->data[(pipe->head + pipe->count - 1) % PIPE_BUFFER_SIZE] == 'y');
+	ASSERT(pipe->writers.head == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_pipe_close_1()
+{
+	uint8_t data[300], buffer[PIPE_BUFFER_SIZE];
+	task_control_block_t *task;
+	pipe_t *pipe;
+	int index;
+
+	task_table_init(&table);
+	pipe_table_init(&pipe_table);
+	index = allocate_pipe(&pipe_table);
+	pipe = &pipe_table.pipes[index];
+	task = new_task(DEFAULT_TASK_PRIORITY);
+
+	// closing the write end wakes a waiting reader with an end of file
+	pipe_read(&table, task, pipe, buffer, sizeof(buffer), &preempt);
+	close_pipe_end(&table, &pipe_table, index, PIPE_WRITE_END);
+	ASSERT(task->state == READY && task->regs[REGISTER_V0] == 0);
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, sizeof(buffer), &preempt) == 0);
+	ASSERT(table.root->state == RUNNING);
+
+	close_pipe_end(&table, &pipe_table, index, PIPE_READ_END);
+	ASSERT(pipe_table.free_pipe_bitmap == (0x1u << MAX_PIPES) - 1);
+
+	// closing the read end wakes a waiting writer with what it got in
+	index = allocate_pipe(&pipe_table);
+	pipe = &pipe_table.pipes[index];
+	pipe_write(&table, task, pipe, data, sizeof(data), &preempt);
+	ASSERT(task->state == BLOCKED);
+	close_pipe_end(&table, &pipe_table, index, PIPE_READ_END);
+	ASSERT(task->state == READY && task->regs[REGISTER_V0] == PIPE_BUFFER_SIZE);
+
+	// and later writes fail
+	ASSERT(pipe_write(&table, table.root, pipe, data, 1, &preempt) == ERROR_PIPE_CLOSED);
+
+	// and closing the other end as well frees the pipe
+	close_pipe_end(&table, &pipe_table, index, PIPE_WRITE_END);
+	ASSERT(pipe_table.free_pipe_bitmap == (0x1u << MAX_PIPES) - 1);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_pipe_preempt_1()
+{
+	uint8_t data[PIPE_BUFFER_SIZE + 8], buffer[8];
+	task_control_block_t *high, *same;
+	pipe_t *pipe;
+	int index;
+
+	task_table_init(&table);
+	pipe_table_init(&pipe_table);
+	index = allocate_pipe(&pipe_table);
+	pipe = &pipe_table.pipes[index];
+	high = new_task(DEFAULT_TASK_PRIORITY - 1);
+	same = new_task(DEFAULT_TASK_PRIORITY);
+	memset(data, 'x', sizeof(data));
+
+	// waking a reader of the same priority does not preempt the writer
+	pipe_read(&table, same, pipe, buffer, sizeof(buffer), &preempt);
+	ASSERT(pipe_write(&table, table.root, pipe, "ab", 2, &preempt) == 2);
+	ASSERT(same->state == READY && preempt == 0);
+
+	// but waking one of a higher priority does
+	pipe_read(&table, high, pipe, buffer, sizeof(buffer), &preempt);
+	ASSERT(pipe_write(&table, table.root, pipe, "ab", 2, &preempt) == 2);
+	ASSERT(high->state == READY && preempt == 1);
+
+	// as does a read that lets a higher priority writer finish
+	pipe_write(&table, high, pipe, data, sizeof(data), &preempt);
+	ASSERT(high->state == BLOCKED);
+	ASSERT(pipe_read(&table, table.root, pipe, buffer, sizeof(buffer), &preempt) == sizeof(buffer));
+	ASSERT(high->state == READY && preempt == 1);
+
+	// and closing the end a higher priority task waits on
+	pipe_write(&table, high, pipe, data, sizeof(data), &preempt);
+	ASSERT(high->state == BLOCKED);
+	ASSERT(close_pipe_end(&table, &pipe_table, index, PIPE_READ_END) == 1);
+	ASSERT(high->state == READY);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_pipe_table_1()
+{
+	pipe_table_init(&pipe_table);
+
+	for(int i = 0; i < MAX_PIPES; i++)
+	{
+		ASSERT(allocate_pipe(&pipe_table) == i);
+	}
+
+	ASSERT(allocate_pipe(&pipe_table) == ERROR_PIPE_TABLE_FULL);
+
+	// a freed pipe is handed out again
+	close_pipe_end(&table, &pipe_table, 3, PIPE_READ_END);
+	ASSERT(allocate_pipe(&pipe_table) == ERROR_PIPE_TABLE_FULL);
+	close_pipe_end(&table, &pipe_table, 3, PIPE_WRITE_END);
+	ASSERT(allocate_pipe(&pipe_table) == 3);
+
+	return true;
+}
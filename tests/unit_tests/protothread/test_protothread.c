@@ -0,0 +1,252 @@
+
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "kdefs.h"
+#include "task.h"
+#include "timers.h"
+#include "protothread.h"
+#include "test.h"
+
+
+
+#define LOG_SIZE 32
+
+static char event_log[LOG_SIZE + 1];
+static unsigned int log_length;
+
+static pt_scheduler_t scheduler;
+
+// stands in for a device status bit
+static int device_ready;
+
+
+static void log_event(char event)
+{
+	if(log_length < LOG_SIZE)
+	{
+		event_log[log_length++] = event;
+		event_log[log_length] = '\0';
+	}
+}
+
+
+static void reset_simulation()
+{
+	init_timer_system();
+	pt_scheduler_init(&scheduler);
+
+	event_log[0] = '\0';
+	log_length = 0;
+	device_ready = 0;
+}
+
+
+
+/*
+ * Jobs keep what must survive a wait in the structure that
+ * embeds their pt_job_t, the same as real jobs would.
+ */
+typedef struct
+{
+	pt_job_t job;
+	char name;
+	unsigned int count;
+
+} counting_job_t;
+
+
+static int yielding_job(pt_job_t *job)
+{
+	counting_job_t *state = (counting_job_t*) job;
+
+	PT_BEGIN(job);
+
+	for(state->count = 0; state->count < 3; state->count++)
+	{
+		log_event(state->name);
+		PT_YIELD(job);
+	}
+
+	PT_END(job);
+}
+
+
+static int sleeping_job(pt_job_t *job)
+{
+	PT_BEGIN(job);
+
+	log_event('s');
+	PT_SLEEP(job, 10);
+	log_event('w');
+
+	PT_END(job);
+}
+
+
+static int device_job(pt_job_t *job)
+{
+	PT_BEGIN(job);
+
+	PT_WAIT_UNTIL(job, device_ready);
+	log_event('d');
+
+	PT_END(job);
+}
+
+
+static int exiting_job(pt_job_t *job)
+{
+	PT_BEGIN(job);
+
+	log_event('e');
+	PT_EXIT(job);
+	log_event('x');
+
+	PT_END(job);
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_protothread_yield_1()
+{
+	counting_job_t first = { .name = 'a' };
+	counting_job_t second = { .name = 'b' };
+
+	reset_simulation();
+
+	pt_job_start(&scheduler, &first.job, yielding_job);
+	pt_job_start(&scheduler, &second.job, yielding_job);
+
+	// jobs take turns, and end on the pass after their last yield
+	ASSERT(pt_scheduler_run(&scheduler) == 2);
+	ASSERT(pt_scheduler_run(&scheduler) == 2);
+	ASSERT(pt_scheduler_run(&scheduler) == 2);
+	ASSERT(pt_scheduler_run(&scheduler) == 0);
+	ASSERT(strcmp(event_log, "ababab") == 0);
+	ASSERT(scheduler.jobs == NULL_POINTER);
+
+	// an ended job may be started again from the beginning
+	pt_job_start(&scheduler, &first.job, yielding_job);
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "abababa") == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_protothread_sleep_1()
+{
+	pt_job_t sleeper;
+
+	reset_simulation();
+
+	pt_job_start(&scheduler, &sleeper, sleeping_job);
+
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "s") == 0);
+	ASSERT(sleeper.sleeping);
+
+	// not called at all before the wakeup tick
+	timer_tick(9);
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "s") == 0);
+
+	timer_tick(1);
+	ASSERT(pt_scheduler_run(&scheduler) == 0);
+	ASSERT(strcmp(event_log, "sw") == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_protothread_sleep_wrap_1()
+{
+	pt_job_t sleeper;
+
+	reset_simulation();
+
+	// the wakeup tick wraps past zero
+	timer_tick(0xFFFFFFFA);
+
+	pt_job_start(&scheduler, &sleeper, sleeping_job);
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(sleeper.wake_tick == 4);
+
+	timer_tick(9);
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "s") == 0);
+
+	timer_tick(1);
+	ASSERT(pt_scheduler_run(&scheduler) == 0);
+	ASSERT(strcmp(event_log, "sw") == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_protothread_wait_until_1()
+{
+	pt_job_t waiter;
+	counting_job_t other = { .name = 'a' };
+
+	reset_simulation();
+
+	pt_job_start(&scheduler, &waiter, device_job);
+	pt_job_start(&scheduler, &other.job, yielding_job);
+
+	// a job waiting on the device does not hold up the others
+	ASSERT(pt_scheduler_run(&scheduler) == 2);
+	ASSERT(pt_scheduler_run(&scheduler) == 2);
+	ASSERT(strcmp(event_log, "aa") == 0);
+
+	device_ready = 1;
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "aada") == 0);
+	ASSERT(scheduler.jobs == &other.job);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_protothread_exit_1()
+{
+	pt_job_t first;
+	pt_job_t second;
+	counting_job_t third = { .name = 'a' };
+
+	reset_simulation();
+
+	pt_job_start(&scheduler, &first, exiting_job);
+	pt_job_start(&scheduler, &second, exiting_job);
+	pt_job_start(&scheduler, &third.job, yielding_job);
+
+	// jobs ending early are unlinked from the middle of the list
+	ASSERT(pt_scheduler_run(&scheduler) == 1);
+	ASSERT(strcmp(event_log, "eea") == 0);
+	ASSERT(scheduler.jobs == &third.job);
+	ASSERT(third.job.next == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_protothread_memory_1()
+{
+	// a job is a few words, where a task takes a TCB and a whole stack
+	ASSERT(sizeof(pt_job_t) == 2*sizeof(void*) + 2*sizeof(unsigned int));
+	ASSERT(sizeof(pt_job_t) < sizeof(task_control_block_t));
+
+	printf("protothread job: %u bytes, task: %u bytes + %u byte stack\n",
+		   (unsigned int) sizeof(pt_job_t), (unsigned int) sizeof(task_control_block_t), DEFAULT_STACK_SIZE);
+
+	return true;
+}
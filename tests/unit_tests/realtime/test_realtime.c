@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "timers.h"
+#include "realtime.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+/*
+ * Simulated execution. Each tick, the scheduler picks a task
+ * and that task runs for the whole tick, so preemption happens
+ * at tick boundaries. A real-time job finishes once it has run
+ * for the number of ticks given in execution_ticks for its task,
+ * which may differ from its declared WCET.
+ */
+
+static unsigned int execution_ticks[MAX_TASKS];
+static unsigned int work_left[MAX_TASKS];
+static unsigned int background_ticks;
+
+
+static void reset_simulation()
+{
+	task_table_init(&table);
+	init_timer_system();
+
+	memset(execution_ticks, 0, sizeof(execution_ticks));
+	memset(work_left, 0, sizeof(work_left));
+	background_ticks = 0;
+}
+
+
+static taskid_t add_task(unsigned int period, unsigned int wcet, unsigned int deadline, unsigned int actual_ticks)
+{
+	realtime_params_t params = {period, wcet, deadline};
+	taskid_t id = create_realtime_task(&table, table.root->task_id, dummy_task_function, &params);
+
+	if(id >= 0)
+	{
+		execution_ticks[TASK_ID_INDEX(id)] = actual_ticks;
+		work_left[TASK_ID_INDEX(id)] = actual_ticks;
+	}
+
+	return id;
+}
+
+
+static void run_ticks(int num_ticks)
+{
+	for(int i = 0; i < num_ticks; i++)
+	{
+		schedule_next_task(&table);
+
+		task_control_block_t *task = table.current_task;
+		int index = task - table.tasks;
+
+		timer_tick(1);
+
+		if(task->sched_class == SCHED_CLASS_REALTIME)
+		{
+			if(--work_left[index] == 0)
+			{
+				work_left[index] = execution_ticks[index];
+				complete_realtime_job(&table, task, get_system_ticks());
+			}
+		}
+		else
+		{
+			background_ticks++;
+		}
+
+		realtime_tick(&table, get_system_ticks());
+	}
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_admission_1()
+{
+	taskid_t current_loop;
+	taskid_t position_loop;
+
+	reset_simulation();
+
+	ASSERT(add_task(10, 0, 10, 1) == ERROR_INVALID_RT_PARAMS);
+	ASSERT(add_task(10, 5, 4, 1) == ERROR_INVALID_RT_PARAMS);
+	ASSERT(add_task(10, 2, 11, 1) == ERROR_INVALID_RT_PARAMS);
+	ASSERT(table.num_tasks == 1);
+
+	current_loop = add_task(10, 3, 10, 3);
+	ASSERT(current_loop >= 0);
+	ASSERT(table.rt_utilization == 300);
+
+	// density uses the deadline when it is shorter than the period
+	position_loop = add_task(100, 20, 40, 20);
+	ASSERT(position_loop >= 0);
+	ASSERT(table.rt_utilization == 800);
+
+	// would take the total to 1000, over RT_UTILIZATION_BOUND
+	ASSERT(add_task(20, 4, 20, 4) == ERROR_ADMISSION_FAILED);
+	ASSERT(table.num_tasks == 3);
+
+	// freeing a task returns its share
+	free_task(&table, get_task(&table, current_loop));
+	ASSERT(table.rt_utilization == 500);
+	ASSERT(add_task(20, 4, 20, 4) >= 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_edf_order_1()
+{
+	taskid_t late_id;
+	taskid_t early_id;
+
+	reset_simulation();
+
+	late_id = add_task(20, 1, 20, 1);
+	early_id = add_task(10, 1, 5, 1);
+
+	ASSERT(table.rt_ready_list == get_task(&table, early_id));
+
+	// real-time tasks run before the best-effort root task, earliest deadline first
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == early_id);
+
+	complete_realtime_job(&table, table.current_task, 1);
+	ASSERT(table.current_task->state == BLOCKED);
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == late_id);
+
+	complete_realtime_job(&table, table.current_task, 2);
+	schedule_next_task(&table);
+	ASSERT(table.current_task == table.root);
+
+	// next release of the early task is at tick 10
+	ASSERT(table.rt_next_event == 10);
+
+	return true;
+}
+
+
+/*
+ * A 2-tick current loop every 10 ticks and a 30-tick position
+ * loop every 100 ticks, scheduled alongside a best-effort task.
+ * No deadlines should be missed and the best-effort task should
+ * get all of the remaining time.
+ */
+UNIT_TEST bool test_control_loops_1()
+{
+	taskid_t current_loop;
+	taskid_t position_loop;
+
+	reset_simulation();
+
+	current_loop = add_task(10, 2, 10, 2);
+	position_loop = add_task(100, 30, 100, 30);
+
+	run_ticks(1000);
+
+	ASSERT(get_deadline_misses(&table, current_loop) == 0);
+	ASSERT(get_deadline_misses(&table, position_loop) == 0);
+	ASSERT(get_task(&table, current_loop)->rt.jobs_completed == 100);
+	ASSERT(get_task(&table, position_loop)->rt.jobs_completed == 10);
+	ASSERT(background_ticks == 500);
+
+	printf("\t1000 ticks at 50%% real-time load: 0 misses, %u background ticks\n", background_ticks);
+
+	return true;
+}
+
+
+/*
+ * A task that runs for twice its declared WCET misses the
+ * deadline of every job, and each miss is counted exactly once.
+ */
+UNIT_TEST bool test_deadline_miss_1()
+{
+	taskid_t overrun_id;
+	taskid_t good_id;
+
+	reset_simulation();
+
+	overrun_id = add_task(10, 3, 5, 6);
+	good_id = add_task(50, 5, 50, 5);
+
+	run_ticks(100);
+
+	ASSERT(get_task(&table, overrun_id)->rt.jobs_completed == 10);
+	ASSERT(get_deadline_misses(&table, overrun_id) == 10);
+	ASSERT(get_deadline_misses(&table, good_id) == 0);
+
+	ASSERT(get_deadline_misses(&table, table.root->task_id) == ERROR_TASK_NOT_FOUND);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_overrun_1()
+{
+	taskid_t id;
+	task_control_block_t *task;
+
+	reset_simulation();
+
+	// a job that needs longer than its period is released again on completion
+	id = add_task(10, 5, 10, 15);
+	task = get_task(&table, id);
+
+	run_ticks(15);
+	ASSERT(task->rt.jobs_completed == 1);
+	ASSERT(task->rt.deadline_misses == 1);
+	ASSERT(task->rt.job_active);
+	ASSERT(task->rt.absolute_deadline == 20);
+	ASSERT(task->rt.next_release == 20);
+
+	return true;
+}
@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "semaphore.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+unsigned int read_cycle_counter() { return 0; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_semaphore_count_1()
+{
+	semaphore_t semaphore = SEMAPHORE_INITIALIZER(2);
+
+	task_table_init(&table);
+
+	// the count is taken without blocking while it lasts
+	ASSERT(semaphore_wait(&table, table.root, &semaphore, WAIT_FOREVER, 0) == 0);
+	ASSERT(semaphore_wait(&table, table.root, &semaphore, WAIT_POLL, 0) == 0);
+	ASSERT(semaphore.count == 0);
+	ASSERT(table.root->state == RUNNING);
+
+	// then polling fails instead of blocking
+	ASSERT(semaphore_wait(&table, table.root, &semaphore, WAIT_POLL, 0) == ERROR_TIMED_OUT);
+	ASSERT(table.root->state == RUNNING);
+
+	// posts with nobody waiting add to the count
+	ASSERT(semaphore_post(&table, &semaphore) == 0);
+	ASSERT(semaphore_post(&table, &semaphore) == 0);
+	ASSERT(semaphore.count == 2);
+
+	semaphore.count = SEMAPHORE_MAX_COUNT;
+	ASSERT(semaphore_post(&table, &semaphore) == ERROR_SEMAPHORE_OVERFLOW);
+	ASSERT(semaphore.count == SEMAPHORE_MAX_COUNT);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_semaphore_priority_1()
+{
+	semaphore_t semaphore;
+	task_control_block_t *waiters[4];
+	unsigned int priorities[4] = {20, 4, 20, 7};
+
+	task_table_init(&table);
+	semaphore_init(&semaphore, 0);
+
+	for(int i = 0; i < 4; i++)
+	{
+		waiters[i] = new_task(priorities[i]);
+		ASSERT(semaphore_wait(&table, waiters[i], &semaphore, WAIT_FOREVER, 0) == 0);
+		ASSERT(waiters[i]->state == BLOCKED);
+	}
+
+	// each post goes to the highest priority waiter, equal priorities in the order they came
+	ASSERT(semaphore_post(&table, &semaphore) == 1);
+	ASSERT(waiters[1]->state == READY);
+	ASSERT(waiters[1]->regs[REGISTER_V0] == 0);
+	ASSERT(semaphore.waiters.head == waiters[3]);
+
+	semaphore_post(&table, &semaphore);
+	ASSERT(waiters[3]->state == READY);
+
+	// neither of the last two beats the root task's priority
+	ASSERT(semaphore_post(&table, &semaphore) == 0);
+	ASSERT(waiters[0]->state == READY && waiters[2]->state == BLOCKED);
+
+	semaphore_post(&table, &semaphore);
+	ASSERT(waiters[2]->state == READY);
+
+	// the count went to the waiters rather than being added
+	ASSERT(semaphore.count == 0);
+	ASSERT(semaphore.waiters.head == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_semaphore_timeout_1()
+{
+	semaphore_t semaphore = SEMAPHORE_INITIALIZER(0);
+	task_control_block_t *first, *second;
+
+	task_table_init(&table);
+	first = new_task(DEFAULT_TASK_PRIORITY);
+	second = new_task(DEFAULT_TASK_PRIORITY);
+
+	semaphore_wait(&table, first, &semaphore, 5, 100);
+	semaphore_wait(&table, second, &semaphore, 10, 100);
+
+	wake_sleeping_tasks(&table, 104);
+	ASSERT(first->state == BLOCKED);
+
+	// the first runs out of time and leaves the queue
+	wake_sleeping_tasks(&table, 105);
+	ASSERT(first->state == READY);
+	ASSERT(first->regs[REGISTER_V0] == (uint32_t) ERROR_TIMED_OUT);
+	ASSERT(semaphore.waiters.head == second);
+
+	// the second is posted to in time, which cancels its timeout
+	semaphore_post(&table, &semaphore);
+	ASSERT(second->state == READY);
+	ASSERT(second->regs[REGISTER_V0] == 0);
+	ASSERT(table.sleep_list == NULL_POINTER);
+	ASSERT(semaphore.count == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_semaphore_interrupt_1()
+{
+	semaphore_t semaphore = SEMAPHORE_INITIALIZER(0);
+	task_control_block_t *waiter;
+
+	task_table_init(&table);
+	waiter = new_task(2);
+
+	semaphore_wait(&table, waiter, &semaphore, WAIT_FOREVER, 0);
+
+	// posting from an interrupt readies the waiter but leaves the interrupted task running
+	ASSERT(semaphore_post(&table, &semaphore) == 1);
+	ASSERT(table.current_task == table.root);
+	ASSERT(table.root->state == RUNNING);
+	ASSERT(waiter->state == READY);
+	ASSERT(table.ready_lists[2] == waiter);
+
+	// and the next scheduling point switches to it
+	schedule_next_task(&table);
+	ASSERT(table.current_task == waiter);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_semaphore_exit_1()
+{
+	semaphore_t semaphore = SEMAPHORE_INITIALIZER(0);
+	task_control_block_t *first, *second;
+
+	task_table_init(&table);
+	first = new_task(DEFAULT_TASK_PRIORITY);
+	second = new_task(DEFAULT_TASK_PRIORITY);
+
+	semaphore_wait(&table, first, &semaphore, 20, 0);
+	semaphore_wait(&table, second, &semaphore, WAIT_FOREVER, 0);
+
+	// a waiter that exits leaves both the queue and the sleep list
+	exit_task(&table, first, 0);
+	ASSERT(semaphore.waiters.head == second);
+	ASSERT(table.sleep_list == NULL_POINTER);
+
+	semaphore_post(&table, &semaphore);
+	ASSERT(second->state == READY);
+
+	return true;
+}
@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "syscall_ring.h"
+#include "test.h"
+
+
+
+
+static syscall_ring_t ring;
+
+static unsigned int handled;
+static uint32_t handled_codes[2*SYSCALL_RING_SIZE];
+
+
+// records the order operations run in, and returns the first argument negated
+static int fake_handler(syscall_submission_t *submission)
+{
+	handled_codes[handled++] = submission->code;
+
+	return -(int) submission->args[0];
+}
+
+
+static void submit(uint32_t code, uint32_t arg, uint32_t user_data)
+{
+	syscall_submission_t *submission = &ring.submissions[ring.submission_tail & (SYSCALL_RING_SIZE - 1)];
+
+	submission->code = code;
+	submission->args[0] = arg;
+	submission->user_data = user_data;
+
+	ring.submission_tail++;
+}
+
+
+static void reset_ring()
+{
+	memset(&ring, 0, sizeof(ring));
+	handled = 0;
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_run_syscall_ring_1()
+{
+	reset_ring();
+
+	// nothing queued, nothing run
+	ASSERT(run_syscall_ring(&ring, fake_handler) == 0);
+	ASSERT(handled == 0);
+	ASSERT(ring.completion_tail == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_run_syscall_ring_2()
+{
+	reset_ring();
+
+	submit(9, 1, 100);
+	submit(14, 2, 200);
+	submit(8, 3, 300);
+
+	// operations run in order, each completion carrying its submission's user_data
+	ASSERT(run_syscall_ring(&ring, fake_handler) == 3);
+	ASSERT(handled == 3);
+	ASSERT(handled_codes[0] == 9 && handled_codes[1] == 14 && handled_codes[2] == 8);
+
+	ASSERT(ring.submission_head == 3);
+	ASSERT(ring.completion_tail == 3);
+
+	for(unsigned int i = 0; i < 3; i++)
+	{
+		ASSERT(ring.completions[i].user_data == 100*(i + 1));
+		ASSERT(ring.completions[i].result == -(int) (i + 1));
+	}
+
+	// the task has not taken the completions yet, so the kernel leaves them
+	ASSERT(ring.completion_head == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_run_syscall_ring_3()
+{
+	reset_ring();
+
+	// fill the completion ring with all but two untaken completions
+	for(unsigned int i = 0; i < SYSCALL_RING_SIZE - 2; i++)
+	{
+		submit(9, i, i);
+	}
+
+	ASSERT(run_syscall_ring(&ring, fake_handler) == SYSCALL_RING_SIZE - 2);
+
+	for(unsigned int i = 0; i < 5; i++)
+	{
+		submit(9, i, SYSCALL_RING_SIZE + i);
+	}
+
+	// the enter stops when the completion ring is full and leaves the rest queued
+	ASSERT(run_syscall_ring(&ring, fake_handler) == 2);
+	ASSERT(ring.submission_tail - ring.submission_head == 3);
+	ASSERT(ring.completion_tail - ring.completion_head == SYSCALL_RING_SIZE);
+
+	// once the task takes its completions, the next enter picks up where it stopped
+	ring.completion_head = ring.completion_tail;
+	ASSERT(run_syscall_ring(&ring, fake_handler) == 3);
+	ASSERT(ring.submission_head == ring.submission_tail);
+	ASSERT(ring.completions[ring.completion_head & (SYSCALL_RING_SIZE - 1)].user_data == SYSCALL_RING_SIZE + 2);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_run_syscall_ring_4()
+{
+	reset_ring();
+
+	// indices are free-running, so they wrap past the end of the arrays and past 2^32
+	ring.submission_head = ring.submission_tail = 0xFFFFFFFE;
+	ring.completion_head = ring.completion_tail = 0xFFFFFFFE;
+
+	for(unsigned int i = 0; i < 4; i++)
+	{
+		submit(9, i, i);
+	}
+
+	ASSERT(run_syscall_ring(&ring, fake_handler) == 4);
+	ASSERT(ring.completion_tail == 2);
+	ASSERT(ring.completions[SYSCALL_RING_SIZE - 2].user_data == 0);
+	ASSERT(ring.completions[1].user_data == 3);
+
+	return true;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "syscall_stats.h"
+#include "kernel_data.h"
+#include "test.h"
+
+
+
+
+// set directly by the tests
+static unsigned int cycle_counter;
+unsigned int read_cycle_counter() { return cycle_counter; }
+
+syscall_stats_t syscall_stats;
+kernel_data_page_t kernel_data_page;
+
+
+
+// makes a call from task_id that takes the given cycles and returns result
+static void make_call(int task_id, unsigned int code, unsigned int arg0, unsigned int cycles, int result)
+{
+	kernel_data_page.current_task_id = task_id;
+
+	cycle_counter += 10;
+	SYSCALL_STATS_ENTER(code, arg0, 0, 0);
+	cycle_counter += cycles;
+	SYSCALL_STATS_EXIT(result);
+}
+
+
+static char output[4096];
+static unsigned int output_size;
+
+static void capture_output(const void *data, unsigned int size)
+{
+	if(output_size + size >= sizeof(output))
+	{
+		return;
+	}
+
+	memcpy(&output[output_size], data, size);
+	output_size += size;
+	output[output_size] = '\0';
+}
+
+
+static void reset_output()
+{
+	output_size = 0;
+	output[0] = '\0';
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_syscall_stats_layout_1()
+{
+	// syscall_dispatch.S stores the call in flight at these offsets
+	ASSERT(offsetof(syscall_stats_t, current.code) == SYSCALL_STATS_CODE_OFFSET);
+	ASSERT(offsetof(syscall_stats_t, current.args) == SYSCALL_STATS_ARGS_OFFSET);
+	ASSERT(offsetof(syscall_stats_t, current.start) == SYSCALL_STATS_START_OFFSET);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_syscall_stats_exit_1()
+{
+	syscall_stats_init(&syscall_stats);
+
+	make_call(33, SYSCALL_CODE_WRITE, 3, 100, 16);
+	make_call(33, SYSCALL_CODE_WRITE, 3, 300, 16);
+	make_call(34, SYSCALL_CODE_SEEK, 3, 50, 0);
+
+	// counted per system call
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_WRITE].calls == 2);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_WRITE].total_cycles == 400);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_WRITE].max_cycles == 300);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_SEEK].calls == 1);
+
+	// and per task
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].task_id == 33);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].calls == 2);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].total_cycles == 400);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(34)].calls == 1);
+
+	// the idle task is left out
+	make_call(KERNEL_DATA_IDLE_TASK, SYSCALL_CODE_YIELD, 0, 20, 0);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_YIELD].calls == 0);
+	ASSERT(syscall_stats.strace_tail == 3);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_syscall_stats_exit_2()
+{
+	int reused_id = MAKE_TASK_ID(TASK_ID_INDEX(33), 2);
+
+	syscall_stats_init(&syscall_stats);
+
+	make_call(33, SYSCALL_CODE_READ, 0, 100, 0);
+
+	// a later task in the same slot starts its own counts
+	make_call(reused_id, SYSCALL_CODE_READ, 0, 40, 0);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].task_id == reused_id);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].calls == 1);
+	ASSERT(syscall_stats.tasks[TASK_ID_INDEX(33)].total_cycles == 40);
+
+	// a reserved code is rejected without counters, but still traced
+	make_call(33, SYSCALL_CODE_DUP, 0, 5, ERROR_INVALID_SYSCALL);
+	make_call(33, 1000, 0, 5, ERROR_INVALID_SYSCALL);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_DUP].calls == 0);
+	ASSERT(syscall_stats.strace_tail == 4);
+	ASSERT(syscall_stats.strace[3].code == 1000);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_syscall_strace_flush_1()
+{
+	syscall_stats_init(&syscall_stats);
+
+	make_call(33, SYSCALL_CODE_WRITE, 3, 812, 16);
+	make_call(33, 1000, 7, 5, ERROR_INVALID_SYSCALL);
+
+	// one record at a time, decoded into a line
+	reset_output();
+	ASSERT(syscall_strace_flush(&syscall_stats, 1, capture_output) == 1);
+	ASSERT(!strcmp(output, "[task 33] write(0x3, 0, 0) = 16 <812 cycles>\r\n"));
+
+	reset_output();
+	ASSERT(syscall_strace_flush(&syscall_stats, 1, capture_output) == 1);
+	ASSERT(!strcmp(output, "[task 33] syscall_1000(0x7, 0, 0) = -17 <5 cycles>\r\n"));
+
+	ASSERT(syscall_strace_flush(&syscall_stats, 1, capture_output) == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_syscall_strace_flush_2()
+{
+	syscall_stats_init(&syscall_stats);
+
+	// calls past a full ring are dropped and counted
+	for(unsigned int i = 0; i < STRACE_BUFFER_SIZE + 3; i++)
+	{
+		make_call(33, SYSCALL_CODE_SEEK, i, 1, 0);
+	}
+
+	ASSERT(syscall_stats.strace_dropped == 3);
+	ASSERT(syscall_stats.syscalls[SYSCALL_CODE_SEEK].calls == STRACE_BUFFER_SIZE + 3);
+
+	// and reported after the records queued before them
+	reset_output();
+	ASSERT(syscall_strace_flush(&syscall_stats, STRACE_BUFFER_SIZE - 1, capture_output) == STRACE_BUFFER_SIZE - 1);
+	ASSERT(strstr(output, "dropped") == NULL);
+
+	reset_output();
+	ASSERT(syscall_strace_flush(&syscall_stats, STRACE_BUFFER_SIZE, capture_output) == 1);
+	ASSERT(strstr(output, "[strace] 3 records dropped\r\n") != NULL);
+	ASSERT(syscall_stats.strace_dropped == 0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_syscall_stats_dump_1()
+{
+	syscall_stats_init(&syscall_stats);
+
+	make_call(33, SYSCALL_CODE_WRITE, 3, 100, 16);
+	make_call(33, SYSCALL_CODE_WRITE, 3, 300, 16);
+
+	reset_output();
+	syscall_stats_dump(&syscall_stats, capture_output);
+
+	// only system calls and tasks that made calls are listed
+	ASSERT(strstr(output, "write") != NULL);
+	ASSERT(strstr(output, "seek") == NULL);
+	ASSERT(strstr(output, "task 33") != NULL);
+	ASSERT(strstr(output, "       400        200        300\r\n") != NULL);
+
+	return true;
+}
@@ -0,0 +1,935 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "task.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+
+
+// simulated cycle counter, advanced by the tests
+static unsigned int cycle_count;
+
+unsigned int read_cycle_counter() { return cycle_count; }
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+#define BENCHMARK_ITERATIONS 1000000
+
+
+/*
+ * Task lookup as it was done before task IDs carried their slot
+ * index. Kept here as the baseline for the lookup benchmark.
+ */
+static task_control_block_t *linear_get_task(task_table_t *task_table, int task_id)
+{
+	task_control_block_t *task = NULL_POINTER;
+
+	for(int i = 0; i < MAX_TASKS; i++)
+	{
+		if(!IS_TASK_FREE(task_table, i) && task_id == task_table->tasks[i].task_id)
+			task = &task_table->tasks[i];
+	}
+
+	return task;
+}
+
+
+static double time_get_task(task_table_t *task_table, task_control_block_t *(*lookup)(task_table_t*, int), taskid_t task_id, int iterations)
+{
+	struct timespec start;
+	struct timespec end;
+	task_control_block_t *volatile found;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(int i = 0; i < iterations; i++)
+	{
+		found = lookup(task_table, task_id);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed_ns = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec);
+	return elapsed_ns/iterations;
+}
+
+
+static double time_schedule_next_task(task_table_t *task_table, int iterations)
+{
+	struct timespec start;
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(int i = 0; i < iterations; i++)
+	{
+		schedule_next_task(task_table);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double elapsed_ns = (end.tv_sec - start.tv_sec)*1e9 + (end.tv_nsec - start.tv_nsec);
+	return elapsed_ns/iterations;
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+UNIT_TEST bool test_task_table_init_1()
+{
+	task_table_init(&table);
+
+	ASSERT(table.num_tasks == 1);
+	ASSERT(table.current_task == &table.tasks[0]);
+	ASSERT(table.root == &table.tasks[0]);
+	ASSERT(table.tasks[0].state == RUNNING);
+	ASSERT(table.tasks[0].priority == DEFAULT_TASK_PRIORITY);
+	ASSERT(table.ready_bitmap == 0);
+	ASSERT(!IS_TASK_FREE(&table, 0));
+	ASSERT(IS_TASK_FREE(&table, 1));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_create_task_1()
+{
+	taskid_t id;
+	task_control_block_t *task;
+
+	task_table_init(&table);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, 3, 0);
+	ASSERT(id >= 0);
+
+	task = get_task(&table, id);
+	ASSERT(task != NULL_POINTER);
+	ASSERT(task->state == CREATED);
+	ASSERT(task->priority == 3);
+	ASSERT(task->parent == table.root);
+	ASSERT(table.root->first_child == task);
+	ASSERT(table.ready_bitmap == PRIORITY_MASK(3));
+	ASSERT(table.ready_lists[3] == task);
+	ASSERT(table.num_tasks == 2);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_create_task_2()
+{
+	taskid_t id;
+
+	task_table_init(&table);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, NUM_PRIORITIES, 0);
+	ASSERT(id == ERROR_INVALID_PRIORITY);
+
+	id = create_task(&table, 1000, dummy_task_function, 0, 0);
+	ASSERT(id == ERROR_TASK_NOT_FOUND);
+
+	ASSERT(table.num_tasks == 1);
+	ASSERT(table.ready_bitmap == 0);
+	ASSERT(IS_TASK_FREE(&table, 1));
+
+	for(int i = 1; i < MAX_TASKS; i++)
+	{
+		id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+		ASSERT(id >= 0);
+	}
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	ASSERT(id == ERROR_TASK_TABLE_FULL);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_schedule_priority_1()
+{
+	taskid_t low_id;
+	taskid_t high_id;
+
+	task_table_init(&table);
+
+	low_id = create_task(&table, table.root->task_id, dummy_task_function, 20, 0);
+	high_id = create_task(&table, table.root->task_id, dummy_task_function, 5, 0);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == high_id);
+	ASSERT(table.current_task->state == RUNNING);
+	ASSERT(current_task_register_base == table.current_task->regs);
+
+	// root task went back onto its ready list
+	ASSERT(table.root->state == READY);
+	ASSERT(table.ready_bitmap == (PRIORITY_MASK(20) | PRIORITY_MASK(DEFAULT_TASK_PRIORITY)));
+
+	// high priority task keeps the CPU while it is runnable
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == high_id);
+
+	set_task_blocked(&table, table.current_task);
+	schedule_next_task(&table);
+	ASSERT(table.current_task == table.root);
+
+	set_task_blocked(&table, table.current_task);
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == low_id);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_schedule_round_robin_1()
+{
+	taskid_t ids[3];
+
+	task_table_init(&table);
+
+	for(int i = 0; i < 3; i++)
+	{
+		ids[i] = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	}
+
+	for(int round = 0; round < 3; round++)
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			schedule_next_task(&table);
+			ASSERT(table.current_task->task_id == ids[i]);
+		}
+
+		schedule_next_task(&table);
+		ASSERT(table.current_task == table.root);
+	}
+
+	return true;
+}
+
+
+UNIT_TEST bool test_schedule_blocked_1()
+{
+	taskid_t id;
+	task_control_block_t *task;
+
+	task_table_init(&table);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	task = get_task(&table, id);
+
+	set_task_blocked(&table, task);
+	ASSERT(task->state == BLOCKED);
+	ASSERT(table.ready_bitmap == 0);
+
+	// blocked task is never picked
+	for(int i = 0; i < 4; i++)
+	{
+		schedule_next_task(&table);
+		ASSERT(table.current_task == table.root);
+	}
+
+	set_task_ready(&table, task);
+	ASSERT(task->state == READY);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task == task);
+
+	return true;
+}
+
+
+/*
+ * Measures the cost of schedule_next_task with two runnable
+ * tasks and all other task slots filled with blocked tasks.
+ * The old implementation walked every blocked task on each
+ * switch, so this is its worst case. With the ready bitmap
+ * the cost should stay flat as the number of tasks grows.
+ */
+UNIT_TEST bool test_schedule_benchmark_1()
+{
+	int task_counts[] = {2, 4, 8, 16, MAX_TASKS};
+	int num_counts = sizeof(task_counts)/sizeof(int);
+	double ns_per_switch[sizeof(task_counts)/sizeof(int)];
+
+	printf("\tschedule_next_task cost (2 runnable tasks, rest blocked):\n");
+
+	for(int i = 0; i < num_counts; i++)
+	{
+		task_table_init(&table);
+
+		for(int j = 1; j < task_counts[i]; j++)
+		{
+			taskid_t id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+			ASSERT(id >= 0);
+
+			// leave the first created task runnable along with the root
+			if(j > 1)
+			{
+				set_task_blocked(&table, get_task(&table, id));
+			}
+		}
+
+		ns_per_switch[i] = time_schedule_next_task(&table, BENCHMARK_ITERATIONS);
+		printf("\t\t%2d tasks: %6.2f ns/switch\n", task_counts[i], ns_per_switch[i]);
+	}
+
+	// generous bound so the test is not sensitive to host noise
+	ASSERT(ns_per_switch[num_counts - 1] < 3*ns_per_switch[0] + 5.0);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_task_id_1()
+{
+	taskid_t id;
+
+	task_table_init(&table);
+	ASSERT(table.root->task_id == MAKE_TASK_ID(0, 0));
+	ASSERT(get_task(&table, table.root->task_id) == table.root);
+
+	for(int i = 1; i < MAX_TASKS; i++)
+	{
+		id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+		ASSERT(id >= 0);
+		ASSERT(id != TASK_ID_NONE);
+		ASSERT(TASK_ID_INDEX(id) == i);
+		ASSERT(get_task(&table, id) == &table.tasks[i]);
+	}
+
+	ASSERT(get_task(&table, TASK_ID_NONE) == NULL_POINTER);
+	ASSERT(get_task(&table, MAKE_TASK_ID(3, 7)) == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_task_id_stale_1()
+{
+	taskid_t old_id;
+	taskid_t new_id;
+
+	task_table_init(&table);
+
+	old_id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	ASSERT(table.root->num_children == 1);
+
+	free_task(&table, get_task(&table, old_id));
+	ASSERT(get_task(&table, old_id) == NULL_POINTER);
+	ASSERT(IS_TASK_FREE(&table, TASK_ID_INDEX(old_id)));
+	ASSERT(table.root->num_children == 0);
+	ASSERT(table.num_tasks == 1);
+	ASSERT(table.ready_bitmap == 0);
+
+	// slot is reused, but the old ID must not find the new task
+	new_id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	ASSERT(TASK_ID_INDEX(new_id) == TASK_ID_INDEX(old_id));
+	ASSERT(new_id != old_id);
+	ASSERT(get_task(&table, old_id) == NULL_POINTER);
+	ASSERT(get_task(&table, new_id) == &table.tasks[TASK_ID_INDEX(new_id)]);
+
+	ASSERT(set_task_register_value(&table, old_id, REGISTER_V0, 5) == ERROR_TASK_NOT_FOUND);
+	ASSERT(set_task_register_value(&table, new_id, REGISTER_V0, 5) == 0);
+	ASSERT(get_task(&table, new_id)->regs[REGISTER_V0] == 5);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_task_frame_1()
+{
+	taskid_t id;
+	task_control_block_t *task;
+
+	task_table_init(&table);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	task = get_task(&table, id);
+
+	// new tasks have never entered the kernel, so every register is loaded when they first run
+	ASSERT(task->regs[REGISTER_FRAME] == FRAME_TYPE_FULL);
+	ASSERT(table.root->regs[REGISTER_FRAME] == FRAME_TYPE_FULL);
+	ASSERT(task->regs[REGISTER_PC] == (uint32_t)(uintptr_t) dummy_task_function);
+
+	// syscall return values are written to v0, which both frame types restore
+	task->regs[REGISTER_FRAME] = FRAME_TYPE_VOLUNTARY;
+	ASSERT(set_task_register_value(&table, id, REGISTER_V0, 7) == 0);
+	ASSERT(task->regs[REGISTER_V0] == 7);
+	ASSERT(task->regs[REGISTER_FRAME] == FRAME_TYPE_VOLUNTARY);
+
+	ASSERT(FRAME_BYTE_OFFSET == REGISTER_FRAME*BYTES_PER_REGISTER);
+	ASSERT(PC_BYTE_OFFSET == REGISTER_PC*BYTES_PER_REGISTER);
+
+	return true;
+}
+
+
+/*
+ * Compares lookup cost for the task in the first and last
+ * slots of a full task table, for both the indexed lookup
+ * and the old linear scan of every slot.
+ */
+UNIT_TEST bool test_get_task_benchmark_1()
+{
+	taskid_t first_id;
+	taskid_t last_id;
+	double indexed_first, indexed_last, linear_first, linear_last;
+
+	task_table_init(&table);
+	first_id = table.root->task_id;
+	last_id = first_id;
+
+	for(int i = 1; i < MAX_TASKS; i++)
+	{
+		last_id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+		ASSERT(last_id >= 0);
+	}
+
+	indexed_first = time_get_task(&table, get_task, first_id, BENCHMARK_ITERATIONS);
+	indexed_last = time_get_task(&table, get_task, last_id, BENCHMARK_ITERATIONS);
+	linear_first = time_get_task(&table, linear_get_task, first_id, BENCHMARK_ITERATIONS);
+	linear_last = time_get_task(&table, linear_get_task, last_id, BENCHMARK_ITERATIONS);
+
+	printf("\tget_task cost with %d tasks:\n", MAX_TASKS);
+	printf("\t\tindexed: first slot %6.2f ns, last slot %6.2f ns\n", indexed_first, indexed_last);
+	printf("\t\tlinear:  first slot %6.2f ns, last slot %6.2f ns\n", linear_first, linear_last);
+
+	ASSERT(indexed_last < 3*indexed_first + 5.0);
+
+	return true;
+}
+
+
+static bool stacks_overlap(task_stack_t *a, task_stack_t *b)
+{
+	uintptr_t a_base = (uintptr_t) a->top - a->size;
+	uintptr_t b_base = (uintptr_t) b->top - b->size;
+
+	return a_base < (uintptr_t) b->top && b_base < (uintptr_t) a->top;
+}
+
+
+UNIT_TEST bool test_stack_alloc_1()
+{
+	unsigned int sizes[] = {512, 4096, 0, 100};
+	unsigned int expected[] = {512, 4096, DEFAULT_STACK_SIZE, MIN_STACK_SIZE};
+	task_control_block_t *tasks[4];
+	unsigned int free_before;
+
+	task_table_init(&table);
+	free_before = table.task_stacks.free_bytes;
+
+	ASSERT(table.root->stack.size == MAIN_STACK_SIZE);
+	ASSERT(table.root->stack.top == (void*) &user_stack_space[USER_STACK_SPACE_WORDS]);
+	ASSERT(free_before == sizeof(user_stack_space) - MAIN_STACK_SIZE);
+
+	for(int i = 0; i < 4; i++)
+	{
+		taskid_t id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, sizes[i]);
+		ASSERT(id >= 0);
+
+		tasks[i] = get_task(&table, id);
+		ASSERT(tasks[i]->stack.size == expected[i]);
+		ASSERT(tasks[i]->regs[REGISTER_SP] == (uint32_t)(uintptr_t) tasks[i]->stack.top);
+		ASSERT(((uintptr_t) tasks[i]->stack.top % STACK_ALIGNMENT) == 0);
+		ASSERT((uintptr_t) tasks[i]->stack.top - tasks[i]->stack.size >= (uintptr_t) user_stack_space);
+		ASSERT(!stacks_overlap(&tasks[i]->stack, &table.root->stack));
+
+		for(int j = 0; j < i; j++)
+		{
+			ASSERT(!stacks_overlap(&tasks[i]->stack, &tasks[j]->stack));
+		}
+	}
+
+	ASSERT(table.task_stacks.free_bytes == free_before - 512 - 4096 - DEFAULT_STACK_SIZE - MIN_STACK_SIZE);
+
+	// a stack larger than the free space fails without using up a task slot
+	ASSERT(create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, sizeof(user_stack_space)) == ERROR_NO_STACK_SPACE);
+	ASSERT(table.num_tasks == 5);
+	ASSERT(IS_TASK_FREE(&table, 5));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_stack_free_1()
+{
+	taskid_t ids[3];
+	unsigned int free_before;
+
+	task_table_init(&table);
+	free_before = table.task_stacks.free_bytes;
+
+	for(int i = 0; i < 3; i++)
+	{
+		ids[i] = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 2048);
+	}
+
+	// freeing the middle stack leaves a hole that a smaller stack fits into
+	void *hole_top = get_task(&table, ids[1])->stack.top;
+	free_task(&table, get_task(&table, ids[1]));
+	ASSERT(table.task_stacks.num_free_regions == 2);
+
+	ids[1] = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 1024);
+	ASSERT(get_task(&table, ids[1])->stack.top == hole_top);
+
+	// freed stacks merge back into a single region
+	for(int i = 0; i < 3; i++)
+	{
+		free_task(&table, get_task(&table, ids[i]));
+	}
+
+	ASSERT(table.task_stacks.num_free_regions == 1);
+	ASSERT(table.task_stacks.free_bytes == free_before);
+	ASSERT(table.task_stacks.free_regions[0].size == free_before);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_stack_high_water_1()
+{
+	taskid_t id;
+	task_control_block_t *task;
+	uint32_t *top;
+
+	task_table_init(&table);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 1024);
+	task = get_task(&table, id);
+	top = (uint32_t*) task->stack.top;
+
+	ASSERT(get_stack_high_water_mark(&table, id) == 0);
+	ASSERT(get_stack_high_water_mark(&table, table.root->task_id) == 0);
+
+	// simulate the task pushing 25 words, then popping most of them
+	for(int i = 1; i <= 25; i++)
+	{
+		top[-i] = i;
+	}
+
+	ASSERT(get_stack_high_water_mark(&table, id) == 100);
+
+	// the mark only records the deepest point
+	top[-1] = STACK_PAINT_WORD;
+	ASSERT(get_stack_high_water_mark(&table, id) == 100);
+
+	ASSERT(get_stack_high_water_mark(&table, TASK_ID_NONE) == ERROR_TASK_NOT_FOUND);
+
+	return true;
+}
+
+
+/*
+ * The old fixed partitioning halved the stack space at every
+ * level of its tree, so the first tasks created got most of
+ * the space whether they needed it or not. With sized stacks
+ * every task slot can be filled using exactly the stack space
+ * the tasks ask for, here under 16 KiB for all of them.
+ */
+UNIT_TEST bool test_stack_capacity_1()
+{
+	task_table_init(&table);
+
+	for(int i = 1; i < MAX_TASKS; i++)
+	{
+		ASSERT(create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 512) >= 0);
+	}
+
+	printf("\t%d tasks with 512 byte stacks use %u bytes of stack space\n",
+		MAX_TASKS - 1, (unsigned int)(sizeof(user_stack_space) - MAIN_STACK_SIZE - table.task_stacks.free_bytes));
+
+	ASSERT(table.num_tasks == MAX_TASKS);
+	ASSERT(sizeof(user_stack_space) - MAIN_STACK_SIZE - table.task_stacks.free_bytes == (MAX_TASKS - 1)*512);
+
+	return true;
+}
+
+
+
+UNIT_TEST bool test_task_stats_1()
+{
+	task_stats_t stats;
+
+	cycle_count = 1000;
+	task_table_init(&table);
+
+	int id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	ASSERT(id >= 0);
+
+	// root runs for 5000 cycles while the new task waits, then yields
+	cycle_count += 5000;
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == id);
+
+	ASSERT(get_task_stats(&table, table.root->task_id, &stats) == 0);
+	ASSERT(stats.run_cycles == 5000);
+	ASSERT(stats.num_switches == 0);
+
+	ASSERT(get_task_stats(&table, id, &stats) == 0);
+	ASSERT(stats.num_switches == 1);
+	ASSERT(stats.wait_histogram[WAIT_HISTOGRAM_BUCKET(5000)] == 1);
+
+	// the current task's run time counts up to now
+	cycle_count += 300;
+	ASSERT(get_task_stats(&table, id, &stats) == 0);
+	ASSERT(stats.run_cycles == 300);
+
+	// root waited 300 cycles to run again
+	schedule_next_task(&table);
+	ASSERT(table.current_task == table.root);
+	ASSERT(get_task_stats(&table, table.root->task_id, &stats) == 0);
+	ASSERT(stats.num_switches == 1);
+	ASSERT(stats.wait_histogram[WAIT_HISTOGRAM_BUCKET(300)] == 1);
+
+	ASSERT(get_task_stats(&table, TASK_ID_NONE, &stats) == ERROR_TASK_NOT_FOUND);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_wait_histogram_bucket_1()
+{
+	// bucket 0 holds everything below two units, the last bucket everything past its start
+	ASSERT(WAIT_HISTOGRAM_BUCKET(0) == 0);
+	ASSERT(WAIT_HISTOGRAM_BUCKET((2 << WAIT_HISTOGRAM_SHIFT) - 1) == 0);
+	ASSERT(WAIT_HISTOGRAM_BUCKET(2 << WAIT_HISTOGRAM_SHIFT) == 1);
+	ASSERT(WAIT_HISTOGRAM_BUCKET(5000) == 6);
+	ASSERT(WAIT_HISTOGRAM_BUCKET(0xFFFFFFFFu) == WAIT_HISTOGRAM_BUCKETS - 1);
+
+	return true;
+}
+
+
+
+UNIT_TEST bool test_task_children_1()
+{
+	task_control_block_t *a, *b, *c, *grandchild;
+
+	task_table_init(&table);
+
+	a = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	b = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	c = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	grandchild = get_task(&table, create_task(&table, b->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+
+	// children are kept newest first
+	ASSERT(table.root->num_children == 3);
+	ASSERT(table.root->first_child == c);
+	ASSERT(c->next_sibling == b && b->next_sibling == a && a->next_sibling == NULL_POINTER);
+	ASSERT(a->previous_sibling == b && b->previous_sibling == c && c->previous_sibling == NULL_POINTER);
+	ASSERT(b->first_child == grandchild && grandchild->parent == b);
+
+	// removing from the middle of the list
+	free_task(&table, get_task(&table, b->task_id));
+	ASSERT(c->next_sibling == a && a->previous_sibling == c);
+
+	// the grandchild is handed to the root task
+	ASSERT(grandchild->parent == table.root);
+	ASSERT(table.root->first_child == grandchild);
+	ASSERT(grandchild->next_sibling == c && c->previous_sibling == grandchild);
+	ASSERT(table.root->num_children == 3);
+
+	// removing the head of the list
+	free_task(&table, grandchild);
+	ASSERT(table.root->first_child == c);
+	ASSERT(c->previous_sibling == NULL_POINTER);
+	ASSERT(table.root->num_children == 2);
+
+	printf("\ttask control block is %u bytes\n", (unsigned int) sizeof(task_control_block_t));
+
+	return true;
+}
+
+
+
+UNIT_TEST bool test_exit_wait_1()
+{
+	taskid_t id;
+	int status = 0;
+
+	task_table_init(&table);
+
+	ASSERT(wait_task(&table, WAIT_ANY_CHILD, &status) == ERROR_NO_CHILDREN);
+
+	id = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	exit_task(&table, get_task(&table, id), 7);
+
+	// the zombie keeps its slot and ID until it is reaped
+	ASSERT(get_task(&table, id)->state == TERMINATED);
+	ASSERT(table.root->first_child == NULL_POINTER);
+	ASSERT(table.root->first_zombie == get_task(&table, id));
+	ASSERT(table.ready_bitmap == 0);
+	ASSERT(table.num_tasks == 2);
+
+	ASSERT(wait_task(&table, WAIT_ANY_CHILD, &status) == id);
+	ASSERT(status == 7);
+	ASSERT(get_task(&table, id) == NULL_POINTER);
+	ASSERT(table.root->num_children == 0);
+	ASSERT(table.num_tasks == 1);
+	ASSERT(table.task_stacks.num_free_regions == 1);
+
+	// only children can be waited for
+	ASSERT(wait_task(&table, id, &status) == ERROR_TASK_NOT_FOUND);
+	ASSERT(table.root->state == RUNNING);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_wait_blocks_1()
+{
+	taskid_t first, second;
+	int status = 0;
+
+	task_table_init(&table);
+
+	first = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+	second = create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0);
+
+	// root waits for the second child, so the first one exiting does not wake it
+	wait_task(&table, second, &status);
+	ASSERT(table.root->state == BLOCKED);
+	ASSERT(table.root->blocked_on == &table.root->child_exit_queue);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == first);
+	exit_task(&table, table.current_task, 1);
+	ASSERT(table.root->state == BLOCKED);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task->task_id == second);
+	exit_task(&table, table.current_task, 2);
+
+	// reaped on the root task's behalf, with the ID as its return value
+	ASSERT(table.root->state == READY);
+	ASSERT(table.root->blocked_on == NULL_POINTER);
+	ASSERT(table.root->regs[REGISTER_V0] == second);
+	ASSERT(status == 2);
+	ASSERT(get_task(&table, second) == NULL_POINTER);
+
+	schedule_next_task(&table);
+	ASSERT(table.current_task == table.root);
+
+	// the first child is still a zombie
+	ASSERT(wait_task(&table, WAIT_ANY_CHILD, &status) == first);
+	ASSERT(status == 1);
+	ASSERT(table.num_tasks == 1);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_exit_reparent_1()
+{
+	task_control_block_t *child, *grandchild, *zombie;
+	int status = 0;
+
+	task_table_init(&table);
+
+	child = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	grandchild = get_task(&table, create_task(&table, child->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	zombie = get_task(&table, create_task(&table, child->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+
+	taskid_t child_id = child->task_id;
+	taskid_t zombie_id = zombie->task_id;
+
+	exit_task(&table, zombie, 5);
+	exit_task(&table, child, 0);
+
+	// both the living and the zombie grandchild now belong to the root task
+	ASSERT(grandchild->parent == table.root);
+	ASSERT(zombie->parent == table.root);
+	ASSERT(table.root->first_child == grandchild);
+	ASSERT(table.root->num_children == 3);
+
+	ASSERT(wait_task(&table, zombie_id, &status) == zombie_id);
+	ASSERT(status == 5);
+	ASSERT(wait_task(&table, WAIT_ANY_CHILD, NULL_POINTER) == child_id);
+	ASSERT(table.root->num_children == 1);
+	ASSERT(table.root->first_zombie == NULL_POINTER);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_sleep_order_1()
+{
+	task_control_block_t *tasks[4];
+	unsigned int wake_ticks[4] = {30, 10, 20, 10};
+
+	task_table_init(&table);
+
+	for(int i = 0; i < 4; i++)
+	{
+		tasks[i] = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+		ASSERT(sleep_task_until(&table, tasks[i], wake_ticks[i], 0) == 1);
+		ASSERT(tasks[i]->state == BLOCKED);
+		ASSERT(IS_TASK_SLEEPING(&table, tasks[i]));
+		ASSERT(tasks[i]->blocked_on == NULL_POINTER);
+	}
+
+	// sorted by wakeup, equal wakeups in the order they went to sleep
+	ASSERT(table.sleep_list == tasks[1]);
+	ASSERT(tasks[1]->next_sleeper == tasks[3]);
+	ASSERT(tasks[3]->next_sleeper == tasks[2]);
+	ASSERT(tasks[2]->next_sleeper == tasks[0]);
+	ASSERT(tasks[0]->next_sleeper == NULL_POINTER);
+	ASSERT(table.sleep_wake_tick == 10);
+	ASSERT(tasks[3]->sleep_delta == 0 && tasks[2]->sleep_delta == 10 && tasks[0]->sleep_delta == 10);
+
+	wake_sleeping_tasks(&table, 9);
+	ASSERT(table.sleep_list == tasks[1]);
+
+	wake_sleeping_tasks(&table, 10);
+	ASSERT(tasks[1]->state == READY && tasks[3]->state == READY);
+	ASSERT(tasks[1]->blocked_on == NULL_POINTER);
+	ASSERT(tasks[1]->regs[REGISTER_V0] == 10);
+	ASSERT(table.sleep_list == tasks[2]);
+	ASSERT(table.sleep_wake_tick == 20);
+
+	// ticks skipped by the idle task wake everything that was due
+	wake_sleeping_tasks(&table, 35);
+	ASSERT(tasks[2]->state == READY && tasks[0]->state == READY);
+	ASSERT(tasks[0]->regs[REGISTER_V0] == 35);
+	ASSERT(table.sleep_list == NULL_POINTER);
+	ASSERT(!IS_TASK_SLEEPING(&table, tasks[0]));
+
+	// a wakeup that is not in the future does not block
+	ASSERT(sleep_task_until(&table, table.root, 35, 35) == 0);
+	ASSERT(sleep_task_until(&table, table.root, 30, 35) == 0);
+	ASSERT(table.root->state == RUNNING);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_sleep_remove_1()
+{
+	task_control_block_t *tasks[3];
+
+	task_table_init(&table);
+
+	for(int i = 0; i < 3; i++)
+	{
+		tasks[i] = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+		sleep_task_until(&table, tasks[i], 10*(i + 1), 0);
+	}
+
+	// the ticks of a task leaving the middle are handed to the next one
+	exit_task(&table, tasks[1], 0);
+	ASSERT(tasks[0]->next_sleeper == tasks[2]);
+	ASSERT(tasks[2]->sleep_delta == 20);
+
+	// and leaving the head moves the head's wakeup
+	exit_task(&table, tasks[0], 0);
+	ASSERT(table.sleep_list == tasks[2]);
+	ASSERT(table.sleep_wake_tick == 30);
+	ASSERT(tasks[2]->sleep_delta == 0);
+
+	wake_sleeping_tasks(&table, 29);
+	ASSERT(tasks[2]->state == BLOCKED);
+	wake_sleeping_tasks(&table, 30);
+	ASSERT(tasks[2]->state == READY);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_sleep_wrap_1()
+{
+	task_control_block_t *first, *second;
+	unsigned int now = 0xFFFFFFF0;
+
+	task_table_init(&table);
+
+	first = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	second = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+
+	// wakes after the tick count wraps, so is queued after one that does not
+	sleep_task_until(&table, first, now + 0x20, now);
+	sleep_task_until(&table, second, now + 0x08, now);
+	ASSERT(table.sleep_list == second);
+	ASSERT(first->sleep_delta == 0x18);
+
+	wake_sleeping_tasks(&table, now + 0x08);
+	ASSERT(second->state == READY && first->state == BLOCKED);
+
+	wake_sleeping_tasks(&table, 0x0F);
+	ASSERT(first->state == BLOCKED);
+	wake_sleeping_tasks(&table, 0x10);
+	ASSERT(first->state == READY);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_wait_timeout_1()
+{
+	task_control_block_t *first, *second;
+	wait_queue_t queue;
+
+	task_table_init(&table);
+	wait_queue_init(&queue);
+
+	first = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+	second = get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, DEFAULT_TASK_PRIORITY, 0));
+
+	// both wait on the queue and in the sleep list at once
+	wait_queue_block(&table, &queue, first);
+	set_task_timeout(&table, first, 10, 0);
+	wait_queue_block(&table, &queue, second);
+	set_task_timeout(&table, second, 20, 0);
+	ASSERT(queue.head == first && first->next_task == second);
+	ASSERT(table.sleep_list == first && first->next_sleeper == second);
+
+	// waking first cancels its timeout
+	ASSERT(wait_queue_wake_one(&table, &queue) == first);
+	ASSERT(!IS_TASK_SLEEPING(&table, first));
+	ASSERT(table.sleep_list == second);
+	ASSERT(table.sleep_wake_tick == 20);
+
+	// second runs out of time and leaves the queue
+	wake_sleeping_tasks(&table, 20);
+	ASSERT(second->state == READY);
+	ASSERT(second->regs[REGISTER_V0] == (uint32_t) ERROR_TIMED_OUT);
+	ASSERT(second->blocked_on == NULL_POINTER);
+	ASSERT(queue.head == NULL_POINTER && queue.tail == NULL_POINTER);
+
+	// waiting forever never enters the sleep list
+	wait_queue_block(&table, &queue, first);
+	set_task_timeout(&table, first, WAIT_FOREVER, 20);
+	ASSERT(table.sleep_list == NULL_POINTER);
+
+	return true;
+}
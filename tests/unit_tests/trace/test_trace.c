@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "task.h"
+#include "trace.h"
+#include "test.h"
+
+
+
+
+// symbols normally provided by the linker script and the userspace startup code
+
+#define USER_STACK_SPACE_WORDS (16*1024)
+
+/*
+ * User stack space runs from _user_heap_end up to _user_stack,
+ * so both symbols are placed on the same array.
+ */
+uint32_t user_stack_space[USER_STACK_SPACE_WORDS] __attribute__((aligned(8)));
+__asm__(".globl _user_heap_end\n.set _user_heap_end, user_stack_space\n"
+		".globl _user_stack\n.set _user_stack, user_stack_space + 4*16*1024");
+uint32_t *current_task_register_base;
+
+void _exit_main(int status) {}
+void _exit_task(int status) {}
+
+// counts up by one on every read, so each record gets its own timestamp
+static unsigned int cycle_counter;
+unsigned int read_cycle_counter() { return cycle_counter++; }
+unsigned int get_cycle_counter_frequency() { return 40000000; }
+
+trace_buffer_t trace_buffer;
+
+
+static task_table_t table;
+
+static void dummy_task_function(void) {}
+
+
+
+static task_control_block_t *new_task(unsigned int priority)
+{
+	return get_task(&table, create_task(&table, table.root->task_id, dummy_task_function, priority, 0));
+}
+
+
+
+/**************
+ * Unit Tests *
+ **************/
+
+
+
+static unsigned int dumped_size;
+static const void *dumped_data;
+
+static void capture_dump(const void *data, unsigned int size)
+{
+	dumped_data = data;
+	dumped_size += size;
+}
+
+
+static trace_record_t *last_record()
+{
+	return &trace_buffer.records[(trace_buffer.next - 1) & (TRACE_BUFFER_SIZE - 1)];
+}
+
+
+
+UNIT_TEST bool test_trace_init_1()
+{
+	trace_buffer.next = 5;
+	trace_init(&trace_buffer);
+
+	// the header describes the buffer for the decoder
+	ASSERT(trace_buffer.magic == TRACE_MAGIC);
+	ASSERT(!memcmp(&trace_buffer.magic, "MTRC", 4));
+	ASSERT(trace_buffer.version == TRACE_VERSION);
+	ASSERT(trace_buffer.num_records == TRACE_BUFFER_SIZE);
+	ASSERT(trace_buffer.counter_frequency == 40000000);
+	ASSERT(trace_buffer.next == 0);
+
+	// the dump is the whole buffer, header first
+	dumped_size = 0;
+	trace_dump(&trace_buffer, capture_dump);
+	ASSERT(dumped_data == &trace_buffer);
+	ASSERT(dumped_size == 4*5 + 8*TRACE_BUFFER_SIZE);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_trace_record_1()
+{
+	unsigned int timestamp;
+
+	trace_init(&trace_buffer);
+	timestamp = cycle_counter;
+
+	TRACE(TRACE_EVENT_SYSCALL_ENTER, 12);
+	trace_event(TRACE_EVENT_SYSCALL_EXIT, 0);
+
+	ASSERT(trace_buffer.next == 2);
+	ASSERT(trace_buffer.records[0].timestamp == timestamp);
+	ASSERT(trace_buffer.records[0].info == ((TRACE_EVENT_SYSCALL_ENTER << TRACE_EVENT_SHIFT) | 12));
+	ASSERT(trace_buffer.records[1].timestamp == timestamp + 1);
+	ASSERT(trace_buffer.records[1].info == (TRACE_EVENT_SYSCALL_EXIT << TRACE_EVENT_SHIFT));
+
+	// data too wide for a record is cut down rather than spilling into the event
+	TRACE(TRACE_EVENT_TIMER_EXPIRY, 0xABCDEF12);
+	ASSERT(last_record()->info == ((TRACE_EVENT_TIMER_EXPIRY << TRACE_EVENT_SHIFT) | 0xCDEF12));
+
+	return true;
+}
+
+
+UNIT_TEST bool test_trace_wrap_1()
+{
+	trace_init(&trace_buffer);
+
+	for(unsigned int i = 0; i < TRACE_BUFFER_SIZE + 3; i++)
+	{
+		TRACE(TRACE_EVENT_TIMER_EXPIRY, i);
+	}
+
+	// the oldest records are overwritten and the count keeps running
+	ASSERT(trace_buffer.next == TRACE_BUFFER_SIZE + 3);
+	ASSERT((trace_buffer.records[0].info & TRACE_DATA_MASK) == TRACE_BUFFER_SIZE);
+	ASSERT((trace_buffer.records[2].info & TRACE_DATA_MASK) == TRACE_BUFFER_SIZE + 2);
+	ASSERT((trace_buffer.records[3].info & TRACE_DATA_MASK) == 3);
+
+	return true;
+}
+
+
+UNIT_TEST bool test_trace_switch_1()
+{
+	task_control_block_t *task;
+
+	task_table_init(&table);
+	trace_init(&trace_buffer);
+	task = new_task(0);
+
+	// a switch records the task switched in
+	schedule_next_task(&table);
+	ASSERT(table.current_task == task);
+	ASSERT(trace_buffer.next == 1);
+	ASSERT(last_record()->info == ((TRACE_EVENT_SWITCH << TRACE_EVENT_SHIFT) | task->task_id));
+
+	// and the idle task when nothing is ready
+	set_task_blocked(&table, table.root);
+	task->state = BLOCKED;
+	schedule_next_task(&table);
+	ASSERT(table.current_task == &table.idle_task);
+	ASSERT(last_record()->info == ((TRACE_EVENT_SWITCH << TRACE_EVENT_SHIFT) | TRACE_IDLE_TASK));
+
+	return true;
+}